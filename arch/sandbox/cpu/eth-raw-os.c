@@ -20,6 +20,7 @@
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <arpa/inet.h>
@@ -269,18 +270,20 @@ int sandbox_eth_raw_os_send(void *packet, int length,
 	return 0;
 }
 
-int sandbox_eth_raw_os_recv(void *packet, int *length,
-			    const struct eth_sandbox_raw_priv *priv)
+static int _raw_recv(struct iovec *iov, int iovlen, int *length,
+		     const struct eth_sandbox_raw_priv *priv)
 {
+	struct msghdr msg;
 	int retval;
-	int saddr_size;
 
 	if (priv->sd < 0 || !priv->device)
 		return -EINVAL;
-	saddr_size = sizeof(struct sockaddr);
-	retval = recvfrom(priv->sd, packet, 1536, 0,
-			  (struct sockaddr *)priv->device,
-			  (socklen_t *)&saddr_size);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = priv->device;
+	msg.msg_namelen = sizeof(struct sockaddr);
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iovlen;
+	retval = recvmsg(priv->sd, &msg, 0);
 	*length = 0;
 	if (retval >= 0) {
 		*length = retval;
@@ -292,6 +295,34 @@ int sandbox_eth_raw_os_recv(void *packet, int *length,
 	return -errno;
 }
 
+int sandbox_eth_raw_os_recv(void *packet, int *length,
+			    const struct eth_sandbox_raw_priv *priv)
+{
+	struct iovec iov = {
+		.iov_base = packet,
+		.iov_len = 1536,
+	};
+
+	return _raw_recv(&iov, 1, length, priv);
+}
+
+int sandbox_eth_raw_os_recv_split(void *packet, int hdr_len, void *data,
+				  int data_len, int *length,
+				  const struct eth_sandbox_raw_priv *priv)
+{
+	struct iovec iov[3];
+
+	/* The rest of the frame follows the header in the packet */
+	iov[0].iov_base = packet;
+	iov[0].iov_len = hdr_len;
+	iov[1].iov_base = data;
+	iov[1].iov_len = data_len;
+	iov[2].iov_base = packet + hdr_len;
+	iov[2].iov_len = 1536 - hdr_len - data_len;
+
+	return _raw_recv(iov, 3, length, priv);
+}
+
 void sandbox_eth_raw_os_stop(struct eth_sandbox_raw_priv *priv)
 {
 	free(priv->device);
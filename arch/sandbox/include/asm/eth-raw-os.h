@@ -68,6 +68,18 @@ int sandbox_eth_raw_os_send(void *packet, int length,
 			    struct eth_sandbox_raw_priv *priv);
 int sandbox_eth_raw_os_recv(void *packet, int *length,
 			    const struct eth_sandbox_raw_priv *priv);
+
+/*
+ * Receive a frame with the data of a download straight to its destination.
+ * packet - gets the first hdr_len bytes, then anything after the data
+ * data - gets the next data_len bytes
+ * length - returns the length of the frame, or 0 if none was received
+ *
+ * returns - 0 if OK, negative if error
+ */
+int sandbox_eth_raw_os_recv_split(void *packet, int hdr_len, void *data,
+				  int data_len, int *length,
+				  const struct eth_sandbox_raw_priv *priv);
 void sandbox_eth_raw_os_stop(struct eth_sandbox_raw_priv *priv);
 
 #endif /* __ETH_RAW_OS_H */
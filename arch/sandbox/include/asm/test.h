@@ -243,6 +243,16 @@ uint sandbox_spi_get_speed(struct udevice *dev);
  */
 uint sandbox_spi_get_mode(struct udevice *dev);
 
+/**
+ * sandbox_spi_get_dirmap_stats() - Get the direct mapping reads of a spi bus
+ *
+ * @dev: Device to check
+ * @readsp: Returns the number of reads inside the mapped window
+ * @fallbacksp: Returns the number of reads beyond the window
+ */
+void sandbox_spi_get_dirmap_stats(struct udevice *dev, uint *readsp,
+				  uint *fallbacksp);
+
 /**
  * sandbox_get_pch_spi_protect() - Get the PCI SPI protection status
  *
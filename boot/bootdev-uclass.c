@@ -12,11 +12,13 @@
 #include <bootmeth.h>
 #include <bootstd.h>
 #include <fs.h>
+#include <init.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
 #include <sort.h>
 #include <spl.h>
+#include <uthread.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
@@ -807,17 +809,141 @@ static int bootdev_hunt_drv(struct bootdev_hunter *info, uint seq, bool show)
 	return 0;
 }
 
+/**
+ * struct bootdev_hunt_job - a hunter running in its own thread
+ *
+ * @info: Hunter to run
+ * @seq: Sequence number of the hunter
+ * @show: true to show the hunter as it is used
+ * @ret: Result of bootdev_hunt_drv()
+ */
+struct bootdev_hunt_job {
+	struct bootdev_hunter *info;
+	uint seq;
+	bool show;
+	int ret;
+};
+
+static void bootdev_hunt_thread(void *arg)
+{
+	struct bootdev_hunt_job *job = arg;
+
+	job->ret = bootdev_hunt_drv(job->info, job->seq, job->show);
+	log_debug("bootdev_hunt_drv() return %d\n", job->ret);
+}
+
+/**
+ * bootdev_hunt_parallel() - Run a set of hunters in parallel
+ *
+ * Hunters marked as serial are run first, one after the other. Each of the
+ * others then gets a thread, so that the time they spend waiting for the
+ * hardware overlaps.
+ *
+ * @start: First hunter in the linker list
+ * @n_ent: Number of hunters in the linker list
+ * @mask: Bitmask of hunters to run, by sequence number
+ * @show: true to show each hunter as it is used
+ * Returns: 0 if OK, else the last error (other than -ENOENT) from a hunter
+ */
+static int bootdev_hunt_parallel(struct bootdev_hunter *start, int n_ent,
+				 uint mask, bool show)
+{
+	struct bootdev_hunt_job *jobs;
+	uint grp_id;
+	int result;
+	int i;
+
+	jobs = calloc(n_ent, sizeof(*jobs));
+	if (!jobs)
+		return log_msg_ret("job", -ENOMEM);
+
+	/* enumerate PCI now, rather than from several hunters at once */
+	if (IS_ENABLED(CONFIG_PCI)) {
+		int ret = pci_init();
+
+		if (ret)
+			log_warning("Failed to init PCI (%dE)\n", ret);
+	}
+
+	for (i = 0; i < n_ent; i++) {
+		jobs[i].info = start + i;
+		jobs[i].seq = i;
+		jobs[i].show = show;
+		if ((mask & BIT(i)) && jobs[i].info->serial)
+			bootdev_hunt_thread(&jobs[i]);
+	}
+
+	grp_id = uthread_grp_new_id();
+	for (i = 0; i < n_ent; i++) {
+		if (!(mask & BIT(i)) || jobs[i].info->serial)
+			continue;
+		/* run the hunter here if there is no memory for a thread */
+		if (uthread_create(NULL, bootdev_hunt_thread, &jobs[i], 0,
+				   grp_id))
+			bootdev_hunt_thread(&jobs[i]);
+	}
+	while (!uthread_grp_done(grp_id))
+		uthread_schedule();
+
+	result = 0;
+	for (i = 0; i < n_ent; i++) {
+		if ((mask & BIT(i)) && jobs[i].ret && jobs[i].ret != -ENOENT)
+			result = jobs[i].ret;
+	}
+	free(jobs);
+
+	return result;
+}
+
+/**
+ * bootdev_hunt_run() - Run a set of hunters
+ *
+ * @mask: Bitmask of hunters to run, by sequence number
+ * @show: true to show each hunter as it is used
+ * Returns: 0 if OK, else the last error (other than -ENOENT) from a hunter
+ */
+static int bootdev_hunt_run(uint mask, bool show)
+{
+	struct bootdev_hunter *start;
+	struct bootstd_priv *std;
+	int n_ent, i;
+	int result;
+
+	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
+	n_ent = ll_entry_count(struct bootdev_hunter, bootdev_hunter);
+	result = 0;
+
+	/* only bother with threads if several hunters are left to run */
+	if (CONFIG_IS_ENABLED(UTHREAD) && !bootstd_get_priv(&std) &&
+	    std->hunt_parallel && hweight32(mask & ~std->hunters_used) > 1)
+		return bootdev_hunt_parallel(start, n_ent,
+					     mask & ~std->hunters_used, show);
+
+	for (i = 0; i < n_ent; i++) {
+		int ret;
+
+		if (!(mask & BIT(i)))
+			continue;
+		ret = bootdev_hunt_drv(start + i, i, show);
+		log_debug("bootdev_hunt_drv() return %d\n", ret);
+		if (ret && ret != -ENOENT)
+			result = ret;
+	}
+
+	return result;
+}
+
 int bootdev_hunt(const char *spec, bool show)
 {
 	struct bootdev_hunter *start;
 	const char *end;
 	int n_ent, i;
-	int result;
 	size_t len;
+	uint mask;
 
 	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
 	n_ent = ll_entry_count(struct bootdev_hunter, bootdev_hunter);
-	result = 0;
+	mask = 0;
 
 	len = SIZE_MAX;
 	if (spec) {
@@ -828,7 +954,6 @@ int bootdev_hunt(const char *spec, bool show)
 	for (i = 0; i < n_ent; i++) {
 		struct bootdev_hunter *info = start + i;
 		const char *name = uclass_get_name(info->uclass);
-		int ret;
 
 		log_debug("looking at %.*s for %s\n",
 			  (int)max(strlen(name), len), spec, name);
@@ -837,12 +962,10 @@ int bootdev_hunt(const char *spec, bool show)
 			    (strcmp("dhcp", spec) && strcmp("pxe", spec)))
 				continue;
 		}
-		ret = bootdev_hunt_drv(info, i, show);
-		if (ret)
-			result = ret;
+		mask |= BIT(i);
 	}
 
-	return result;
+	return bootdev_hunt_run(mask, show);
 }
 
 int bootdev_unhunt(enum uclass_id id)
@@ -872,33 +995,52 @@ int bootdev_unhunt(enum uclass_id id)
 	return -ENOENT;
 }
 
-int bootdev_hunt_prio(enum bootdev_prio_t prio, bool show)
+/**
+ * bootdev_hunt_range() - Hunt for bootdevs with priorities in a given range
+ *
+ * @min_prio: Lowest priority value (i.e. most preferred) to hunt for
+ * @max_prio: Highest priority value to hunt for
+ * @show: true to show each hunter as it is used
+ * Returns: 0 if OK, -ve on error
+ */
+static int bootdev_hunt_range(enum bootdev_prio_t min_prio,
+			      enum bootdev_prio_t max_prio, bool show)
 {
 	struct bootdev_hunter *start;
 	int n_ent, i;
 	int result;
+	uint mask;
 
 	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
 	n_ent = ll_entry_count(struct bootdev_hunter, bootdev_hunter);
-	result = 0;
+	mask = 0;
 
-	log_debug("Hunting for priority %d\n", prio);
 	for (i = 0; i < n_ent; i++) {
 		struct bootdev_hunter *info = start + i;
-		int ret;
 
-		if (prio != info->prio)
-			continue;
-		ret = bootdev_hunt_drv(info, i, show);
-		log_debug("bootdev_hunt_drv() return %d\n", ret);
-		if (ret && ret != -ENOENT)
-			result = ret;
+		if (info->prio >= min_prio && info->prio <= max_prio)
+			mask |= BIT(i);
 	}
+	result = bootdev_hunt_run(mask, show);
 	log_debug("exit %d\n", result);
 
 	return result;
 }
 
+int bootdev_hunt_prio(enum bootdev_prio_t prio, bool show)
+{
+	log_debug("Hunting for priority %d\n", prio);
+
+	return bootdev_hunt_range(prio, prio, show);
+}
+
+int bootdev_hunt_upto(enum bootdev_prio_t prio, bool show)
+{
+	log_debug("Hunting up to priority %d\n", prio);
+
+	return bootdev_hunt_range(BOOTDEVP_1_PRE_SCAN, prio, show);
+}
+
 void bootdev_list_hunters(struct bootstd_priv *std)
 {
 	struct bootdev_hunter *orig, *start;
@@ -166,6 +166,7 @@ static int bootstd_probe(struct udevice *dev)
 	struct bootstd_priv *std = dev_get_priv(dev);
 
 	alist_init_struct(&std->bootflows, struct bootflow);
+	std->hunt_parallel = CONFIG_IS_ENABLED(BOOTDEV_HUNT_PARALLEL);
 
 	return 0;
 }
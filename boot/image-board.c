@@ -12,6 +12,7 @@
 #include <bootstage.h>
 #include <cpu_func.h>
 #include <display_options.h>
+#include <dma.h>
 #include <env.h>
 #include <fpga.h>
 #include <image.h>
@@ -167,6 +168,11 @@ void memmove_wd(void *to, void *from, size_t len, ulong chunksz)
 	if (to == from)
 		return;
 
+	/* anything the DMA engine does not take is copied in chunks below */
+	if ((to >= from + len || from >= to + len) &&
+	    !dma_bulk_copy_try(to, from, len))
+		return;
+
 	if (IS_ENABLED(CONFIG_HW_WATCHDOG) || IS_ENABLED(CONFIG_WATCHDOG)) {
 		if (to > from) {
 			from += len;
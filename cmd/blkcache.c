@@ -18,26 +18,38 @@ static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "evictions: %u\n"
 	       "entries: %u\n"
+	       "size: %lu\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max size/device: %lu\n",
+	       stats.hits, stats.misses, stats.evictions, stats.entries,
+	       stats.size, stats.max_blocks_per_entry, stats.max_size);
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+	struct blk_readahead_stats ra_stats;
+
+	blk_readahead_stats(&ra_stats);
+	printf("readahead requests: %u\n"
+	       "readahead merged: %u\n"
+	       "readahead reads: %u\n",
+	       ra_stats.requests, ra_stats.merged, ra_stats.reads);
+#endif
 	return 0;
 }
 
 static int blkc_configure(struct cmd_tbl *cmdtp, int flag,
 			  int argc, char *const argv[])
 {
-	unsigned blocks_per_entry, max_entries;
+	unsigned blocks_per_entry;
+	unsigned long max_size;
 	if (argc != 3)
 		return CMD_RET_USAGE;
 
 	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
-	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	max_size = simple_strtoul(argv[2], 0, 0);
+	blkcache_configure(blocks_per_entry, max_size);
+	printf("changed to max of %lu bytes per device, %u blocks per entry\n",
+	       max_size, blocks_per_entry);
 	return 0;
 }
 
@@ -70,6 +82,6 @@ U_BOOT_CMD(
 	blkcache, 4, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure <blocks> <entries> "
-	"- set max blocks per entry and max cache entries\n"
+	"blkcache configure <blocks> <size> "
+	"- set max blocks per entry and max bytes cached per device\n"
 );
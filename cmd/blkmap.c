@@ -9,6 +9,7 @@
 #include <command.h>
 #include <env.h>
 #include <malloc.h>
+#include <part.h>
 #include <dm/device.h>
 
 static int blkmap_curr_dev;
@@ -86,9 +87,53 @@ static int do_blkmap_map_mem(struct map_ctx *ctx, int argc, char *const argv[])
 	return CMD_RET_SUCCESS;
 }
 
+static int do_blkmap_map_zero(struct map_ctx *ctx, int argc, char *const argv[])
+{
+	int err;
+
+	err = blkmap_map_zero(ctx->dev, ctx->blknr, ctx->blkcnt);
+	if (err) {
+		printf("Unable to map zeroes at block 0x" LBAF ": %d\n",
+		       ctx->blknr, err);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("Block 0x" LBAF "+0x" LBAF " mapped to zeroes\n",
+	       ctx->blknr, ctx->blkcnt);
+	return CMD_RET_SUCCESS;
+}
+
+static int do_blkmap_map_file(struct map_ctx *ctx, int argc, char *const argv[])
+{
+	struct disk_partition info;
+	struct blk_desc *desc;
+	int err, part;
+
+	if (argc < 4)
+		return CMD_RET_USAGE;
+
+	part = blk_get_device_part_str(argv[1], argv[2], &desc, &info, 1);
+	if (part < 0)
+		return CMD_RET_FAILURE;
+
+	err = blkmap_map_file(ctx->dev, ctx->blknr, ctx->blkcnt, desc, part,
+			      argv[3]);
+	if (err) {
+		printf("Unable to map \"%s\" at block 0x" LBAF ": %d\n",
+		       argv[3], ctx->blknr, err);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("Block 0x" LBAF "+0x" LBAF " mapped to \"%s\" on \"%s %s\"\n",
+	       ctx->blknr, ctx->blkcnt, argv[3], argv[1], argv[2]);
+	return CMD_RET_SUCCESS;
+}
+
 static struct map_handler map_handlers[] = {
 	{ .name = "linear", .fn = do_blkmap_map_linear },
 	{ .name = "mem", .fn = do_blkmap_map_mem },
+	{ .name = "zero", .fn = do_blkmap_map_zero },
+	{ .name = "file", .fn = do_blkmap_map_file },
 
 	{ .name = NULL }
 };
@@ -227,7 +272,10 @@ U_BOOT_CMD_WITH_SUBCMDS(
 	"blkmap create <label> - create device\n"
 	"blkmap destroy <label> - destroy device\n"
 	"blkmap map <label> <blk#> <cnt> linear <interface> <dev> <blk#> - device mapping\n"
-	"blkmap map <label> <blk#> <cnt> mem <addr> [preserve] - memory mapping\n",
+	"blkmap map <label> <blk#> <cnt> mem <addr> [preserve] - memory mapping\n"
+	"blkmap map <label> <blk#> <cnt> zero - sparse mapping reading as zeroes\n"
+	"blkmap map <label> <blk#> <cnt> file <interface> <dev[:part]> <path>\n"
+	"    - read-only file mapping\n",
 	U_BOOT_SUBCMD_MKENT(info, 2, 1, do_blkmap_common),
 	U_BOOT_SUBCMD_MKENT(part, 2, 1, do_blkmap_common),
 	U_BOOT_SUBCMD_MKENT(dev, 4, 1, do_blkmap_common),
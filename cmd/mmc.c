@@ -157,7 +157,7 @@ static struct mmc *__init_mmc_device(int dev, bool force_init,
 
 #ifdef CONFIG_BLOCK_CACHE
 	struct blk_desc *bd = mmc_get_blk_desc(mmc);
-	blkcache_invalidate(bd->uclass_id, bd->devnum);
+	blkcache_invalidate(bd);
 #endif
 
 	return mmc;
@@ -11,6 +11,7 @@
 
 #include <config.h>
 #include <api.h>
+#include <bootdev.h>
 #include <bootstage.h>
 #include <cpu_func.h>
 #include <cyclic.h>
@@ -505,6 +506,16 @@ static int initr_boot_led_on(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BOOTDEV_HUNT_R)
+static int initr_bootdev_hunt(void)
+{
+	/* network bootdevs are left until they are needed */
+	bootdev_hunt_upto(BOOTDEVP_5_SCAN_SLOW, false);
+
+	return 0;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(NET) || CONFIG_IS_ENABLED(NET_LWIP)
 static int initr_net(void)
 {
@@ -774,6 +785,9 @@ static void initcall_run_r(void)
 #if CONFIG_IS_ENABLED(PCI_ENDPOINT)
 	INITCALL(pci_ep_init);
 #endif
+#if CONFIG_IS_ENABLED(BOOTDEV_HUNT_R)
+	INITCALL(initr_bootdev_hunt);
+#endif
 #if CONFIG_IS_ENABLED(NET) || CONFIG_IS_ENABLED(NET_LWIP)
 	WATCHDOG_RESET();
 	INITCALL(initr_net);
@@ -4,6 +4,7 @@
  * Written by Simon Glass <sjg@chromium.org>
  */
 
+#include <dma.h>
 #include <errno.h>
 #include <fpga.h>
 #include <gzip.h>
@@ -353,7 +354,7 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 		}
 		length = loadEnd - CONFIG_SYS_LOAD_ADDR;
 	} else {
-		memcpy(load_ptr, src, length);
+		dma_bulk_copy(load_ptr, src, length);
 	}
 
 	if (image_info) {
@@ -99,7 +99,7 @@ struct us_data {
 	struct scsi_cmd	*srb;			/* current srb */
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
-	unsigned short	max_xfer_blk;		/* maximum transfer blocks */
+	unsigned short	max_xfer_blk;		/* maximum transfer, in sectors */
 	bool		cmd12;			/* use 12-byte commands (RBC/UFI) */
 };
 
@@ -971,9 +971,18 @@ static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 	 * Windows 7 limiting transfers to 128 sectors for both USB2 and USB3
 	 * and Apple Mac OS X 10.11 limiting transfers to 256 sectors for USB2
 	 * and 2048 for USB3 devices.
+	 *
+	 * SuperSpeed devices are not known to have this problem and 120 KB
+	 * per command leaves most of their bandwidth unused, since each
+	 * command waits for the status of the one before. Use 2048 sectors
+	 * for them, as Linux and Mac OS X do. In either case the host
+	 * controller may impose a lower limit.
 	 */
 	unsigned short blk = 240;
 
+	if (udev->speed >= USB_SPEED_SUPER)
+		blk = 2048;
+
 #if CONFIG_IS_ENABLED(DM_USB)
 	size_t size;
 	int ret;
@@ -986,6 +995,22 @@ static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 	us->max_xfer_blk = blk;
 }
 
+/*
+ * Get the maximum number of blocks in one transfer. The limit is kept in
+ * 512-byte sectors, so devices with larger blocks get fewer of them.
+ */
+static unsigned short usb_stor_max_xfer_blks(struct us_data *us,
+					     struct blk_desc *block_dev)
+{
+	ulong blks;
+
+	if (!block_dev->blksz)
+		return us->max_xfer_blk;
+	blks = us->max_xfer_blk * 512UL / block_dev->blksz;
+
+	return max(blks, 1UL);
+}
+
 static int usb_inquiry(struct scsi_cmd *srb, struct us_data *ss)
 {
 	int retry, i;
@@ -1151,6 +1176,7 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	struct us_data *ss;
 	int retry;
 	struct scsi_cmd *srb = &usb_ccb;
+	unsigned short max_blks;
 #if CONFIG_IS_ENABLED(BLK)
 	struct blk_desc *block_dev;
 #endif
@@ -1171,6 +1197,7 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+	max_blks = usb_stor_max_xfer_blks(ss, block_dev);
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	usb_lock_async(udev, 1);
@@ -1186,12 +1213,12 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 		/* XXX need some comment here */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > ss->max_xfer_blk)
-			smallblks = ss->max_xfer_blk;
+		if (blks > max_blks)
+			smallblks = max_blks;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == ss->max_xfer_blk)
+		if (smallblks == max_blks)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1214,7 +1241,7 @@ retry_it:
 
 	usb_lock_async(udev, 0);
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= ss->max_xfer_blk)
+	if (blkcnt >= max_blks)
 		debug("\n");
 	return blkcnt;
 }
@@ -1234,6 +1261,7 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	struct us_data *ss;
 	int retry;
 	struct scsi_cmd *srb = &usb_ccb;
+	unsigned short max_blks;
 #if CONFIG_IS_ENABLED(BLK)
 	struct blk_desc *block_dev;
 #endif
@@ -1255,6 +1283,7 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+	max_blks = usb_stor_max_xfer_blks(ss, block_dev);
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	usb_lock_async(udev, 1);
@@ -1273,12 +1302,12 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 		 */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > ss->max_xfer_blk)
-			smallblks = ss->max_xfer_blk;
+		if (blks > max_blks)
+			smallblks = max_blks;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == ss->max_xfer_blk)
+		if (smallblks == max_blks)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1301,7 +1330,7 @@ retry_it:
 
 	usb_lock_async(udev, 0);
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= ss->max_xfer_blk)
+	if (blkcnt >= max_blks)
 		debug("\n");
 	return blkcnt;
 
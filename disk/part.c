@@ -282,7 +282,7 @@ void part_init(struct blk_desc *desc)
 	const int n_ents = ll_entry_count(struct part_driver, part_driver);
 	struct part_driver *entry;
 
-	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blkcache_invalidate(desc);
 
 	if (desc->part_type != PART_TYPE_UNKNOWN) {
 		for (entry = drv; entry != drv + n_ents; entry++) {
@@ -10,6 +10,7 @@
  */
 #include <blk.h>
 #include <cpu_func.h>
+#include <cyclic.h>
 #include <log.h>
 #include <time.h>
 #include <linux/bitops.h>
@@ -440,6 +441,7 @@ static int wait_spinup(void __iomem *port_mmio)
 		tf_data = readl(port_mmio + PORT_TFDATA);
 		if (!(tf_data & ATA_BUSY))
 			return 0;
+		schedule();
 	} while (get_timer(start) < WAIT_MS_SPINUP);
 
 	return -ETIMEDOUT;
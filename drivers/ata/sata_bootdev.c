@@ -58,4 +58,6 @@ BOOTDEV_HUNTER(sata_bootdev_hunter) = {
 	.uclass		= UCLASS_AHCI,
 	.hunt		= sata_bootdev_hunt,
 	.drv		= DM_DRIVER_REF(sata_bootdev),
+	/* sata_rescan() removes the AHCI devices, which SCSI may be using */
+	.serial		= true,
 };
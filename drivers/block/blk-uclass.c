@@ -434,14 +434,18 @@ long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
 	const struct blk_ops *ops = blk_get_ops(dev);
 	ulong blks_read;
+	long ra_read;
 
 	if (!ops->read)
 		return -ENOSYS;
 
-	if (blkcache_read(desc->uclass_id, desc->devnum,
-			  start, blkcnt, desc->blksz, buf))
+	if (blkcache_read(desc, start, blkcnt, buf))
 		return blkcnt;
 
+	ra_read = blk_readahead_read(desc, start, blkcnt, buf);
+	if (ra_read != -ENOENT)
+		return ra_read;
+
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
 		int ret;
@@ -461,8 +465,7 @@ long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 	}
 
 	if (blks_read == blkcnt)
-		blkcache_fill(desc->uclass_id, desc->devnum, start, blkcnt,
-			      desc->blksz, buf);
+		blkcache_fill(desc, start, blkcnt, buf);
 
 	return blks_read;
 }
@@ -477,7 +480,8 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 	if (!ops->write)
 		return -ENOSYS;
 
-	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blkcache_invalidate(desc);
+	blk_readahead_invalidate(desc);
 
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
@@ -509,11 +513,100 @@ long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 	if (!ops->erase)
 		return -ENOSYS;
 
-	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blkcache_invalidate(desc);
+	blk_readahead_invalidate(desc);
 
 	return ops->erase(dev, start, blkcnt);
 }
 
+static int blk_submit(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		      void *buf, bool write, struct blk_req *req)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	int ret;
+
+	memset(req, '\0', sizeof(*req));
+	req->dev = dev;
+	req->start = start;
+	req->blkcnt = blkcnt;
+	req->buffer = buf;
+	req->write = write;
+
+	/* bounce buffers cannot outlive the call, so use the sync path */
+	if (ops->submit && ops->poll && blkcnt &&
+	    !(IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb)) {
+		if (write) {
+			blkcache_invalidate(desc);
+			blk_readahead_invalidate(desc);
+		} else if (blkcache_read(desc, start, blkcnt, buf)) {
+			req->result = blkcnt;
+			req->done = true;
+			return 0;
+		}
+
+		ret = ops->submit(dev, req);
+		if (ret != -ENOSYS)
+			return ret;
+	}
+
+	if (write)
+		req->result = blk_write(dev, start, blkcnt, buf);
+	else
+		req->result = blk_read(dev, start, blkcnt, buf);
+	req->done = true;
+
+	return req->result < 0 ? req->result : 0;
+}
+
+int blk_submit_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		    void *buffer, struct blk_req *req)
+{
+	if (!blk_get_ops(dev)->read)
+		return -ENOSYS;
+
+	return blk_submit(dev, start, blkcnt, buffer, false, req);
+}
+
+int blk_submit_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		     const void *buffer, struct blk_req *req)
+{
+	if (!blk_get_ops(dev)->write)
+		return -ENOSYS;
+
+	return blk_submit(dev, start, blkcnt, (void *)buffer, true, req);
+}
+
+int blk_poll(struct blk_req *req)
+{
+	struct udevice *dev = req->dev;
+	int ret;
+
+	if (req->done)
+		return 0;
+
+	ret = blk_get_ops(dev)->poll(dev, req);
+	if (ret == -EBUSY)
+		return ret;
+	if (ret)
+		req->result = ret;
+	req->done = true;
+
+	if (!req->write && req->result == req->blkcnt)
+		blkcache_fill(dev_get_uclass_plat(dev), req->start,
+			      req->blkcnt, req->buffer);
+
+	return 0;
+}
+
+long blk_wait(struct blk_req *req)
+{
+	while (blk_poll(req) == -EBUSY)
+		;
+
+	return req->result;
+}
+
 ulong blk_dread(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
 		void *buffer)
 {
@@ -865,9 +958,18 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	blkcache_invalidate(dev_get_uclass_plat(dev));
+	blk_readahead_stop(dev_get_uclass_plat(dev));
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_plat_auto	= sizeof(struct blk_desc),
 };
@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sequential readahead for block devices
+ *
+ * While a file is read through fs_read(), filesystems ask for it in extent- or
+ * cluster-sized pieces, each of which pays the command overhead of the device.
+ * Once the reads are seen to be sequential, a whole window of blocks is read
+ * in one go and the following reads are served from it. The window doubles
+ * each time it is used, up to CONFIG_BLOCK_READAHEAD_MAX bytes. There are two
+ * windows, so the next one can be in flight (see blk_submit_read()) while the
+ * filesystem consumes the current one. Their buffers are allocated when first
+ * filled and grow with the window, so short reads do not cost the full amount.
+ */
+
+#define LOG_CATEGORY UCLASS_BLK
+
+#include <blk.h>
+#include <errno.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <linux/kernel.h>
+#include <linux/sizes.h>
+
+/* Size of the first window, in bytes */
+#define BLK_READAHEAD_INITIAL	SZ_128K
+
+/**
+ * struct blk_ra_buf - a readahead window
+ *
+ * @start:	First block held
+ * @blkcnt:	Number of blocks held, 0 if the window is empty
+ * @busy:	true while @req may still be in flight
+ * @req:	Request filling the window
+ * @size:	Size of @data, in blocks
+ * @data:	Buffer holding the window, NULL until it is first filled
+ */
+struct blk_ra_buf {
+	lbaint_t start;
+	lbaint_t blkcnt;
+	bool busy;
+	struct blk_req req;
+	lbaint_t size;
+	char *data;
+};
+
+/**
+ * struct blk_readahead - readahead state for a block device
+ *
+ * @next:	Block following the last one read by the caller
+ * @win:	Size of the next window, in blocks
+ * @initial:	Size of the first window, in blocks
+ * @max:	Maximum size of a window, in blocks
+ * @active:	true while reads are issued on behalf of the readahead, so
+ *		that blk_read() does not come back here
+ * @buf:	Readahead windows
+ */
+struct blk_readahead {
+	lbaint_t next;
+	lbaint_t win;
+	lbaint_t initial;
+	lbaint_t max;
+	bool active;
+	struct blk_ra_buf buf[2];
+};
+
+static struct blk_readahead_stats ra_stats;
+
+static bool ra_buf_holds(struct blk_ra_buf *rab, lbaint_t blk)
+{
+	return rab->blkcnt && blk >= rab->start &&
+		blk < rab->start + rab->blkcnt;
+}
+
+/* Wait for a window to be filled, emptying it if the read failed */
+static int ra_buf_wait(struct blk_readahead *ra, struct blk_ra_buf *rab)
+{
+	long ret;
+
+	if (!rab->busy)
+		return 0;
+
+	ra->active = true;
+	ret = blk_wait(&rab->req);
+	ra->active = false;
+	rab->busy = false;
+	if (ret != rab->blkcnt) {
+		log_debug("readahead of " LBAFU " blocks failed (%ld)\n",
+			  rab->blkcnt, ret);
+		rab->blkcnt = 0;
+		return ret < 0 ? ret : -EIO;
+	}
+
+	return 0;
+}
+
+/*
+ * Make the buffer of an idle window large enough for @blkcnt blocks. If that
+ * fails, the buffer is kept and the number of blocks it can hold is returned.
+ */
+static lbaint_t ra_buf_grow(struct blk_desc *desc, struct blk_ra_buf *rab,
+			    lbaint_t blkcnt)
+{
+	char *data;
+
+	if (blkcnt <= rab->size)
+		return blkcnt;
+
+	data = malloc_cache_aligned(blkcnt * desc->blksz);
+	if (!data) {
+		log_debug("No memory for readahead of " LBAFU " blocks\n",
+			  blkcnt);
+		return rab->size;
+	}
+	free(rab->data);
+	rab->data = data;
+	rab->size = blkcnt;
+
+	return blkcnt;
+}
+
+/* Start reading a window of blocks into @rab */
+static int ra_buf_fill(struct blk_desc *desc, struct blk_readahead *ra,
+		       struct blk_ra_buf *rab, lbaint_t start, lbaint_t blkcnt)
+{
+	int ret;
+
+	if (start >= desc->lba)
+		return -ENOSPC;
+	blkcnt = min(blkcnt, desc->lba - start);
+	rab->blkcnt = 0;
+	blkcnt = ra_buf_grow(desc, rab, blkcnt);
+	if (!blkcnt)
+		return -ENOMEM;
+
+	ra->active = true;
+	ret = blk_submit_read(desc->bdev, start, blkcnt, rab->data, &rab->req);
+	ra->active = false;
+	if (ret) {
+		rab->blkcnt = 0;
+		return ret;
+	}
+	rab->start = start;
+	rab->blkcnt = blkcnt;
+	rab->busy = true;
+	ra_stats.reads++;
+	ra->win = min(ra->win * 2, ra->max);
+
+	return 0;
+}
+
+static void ra_drop(struct blk_readahead *ra)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ra->buf); i++) {
+		ra_buf_wait(ra, &ra->buf[i]);
+		ra->buf[i].blkcnt = 0;
+	}
+}
+
+/* Read the window after the latest one, once the other has been used up */
+static void ra_prefetch(struct blk_desc *desc, struct blk_readahead *ra)
+{
+	struct blk_ra_buf *last = &ra->buf[0], *other = &ra->buf[1];
+
+	if (!last->blkcnt || (other->blkcnt && other->start > last->start))
+		swap(last, other);
+	if (!last->blkcnt || other->busy)
+		return;
+	if (other->blkcnt && other->start + other->blkcnt > ra->next)
+		return;
+
+	ra_buf_fill(desc, ra, other, last->start + last->blkcnt, ra->win);
+}
+
+/* Find the window holding a block, waiting for it to be filled */
+static struct blk_ra_buf *ra_find(struct blk_readahead *ra, lbaint_t blk)
+{
+	struct blk_ra_buf *rab;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ra->buf); i++) {
+		rab = &ra->buf[i];
+		if (ra_buf_holds(rab, blk) && !ra_buf_wait(ra, rab) &&
+		    ra_buf_holds(rab, blk))
+			return rab;
+	}
+
+	return NULL;
+}
+
+/* Read blocks which are not in either window */
+static long ra_miss(struct blk_desc *desc, struct blk_readahead *ra, bool seq,
+		    lbaint_t start, lbaint_t blkcnt, void *buffer)
+{
+	struct blk_ra_buf *rab = &ra->buf[0];
+
+	ra_drop(ra);
+	if (!seq) {
+		/* random access, so start again with a small window */
+		ra->win = ra->initial;
+		return -ENOENT;
+	}
+
+	/* large reads go straight to the caller, with the next window queued */
+	if (blkcnt >= ra->win) {
+		ra_buf_fill(desc, ra, rab, start + blkcnt, ra->win);
+		return -ENOENT;
+	}
+
+	if (ra_buf_fill(desc, ra, rab, start, ra->win) ||
+	    ra_buf_wait(ra, rab) || rab->blkcnt < blkcnt)
+		return -ENOENT;
+	memcpy(buffer, rab->data, blkcnt * desc->blksz);
+	ra_prefetch(desc, ra);
+
+	return blkcnt;
+}
+
+long blk_readahead_read(struct blk_desc *desc, lbaint_t start,
+			lbaint_t blkcnt, void *buffer)
+{
+	struct blk_readahead *ra = desc->ra;
+	struct blk_ra_buf *rab;
+	lbaint_t done, count;
+	bool seq;
+	long ret;
+
+	if (!ra || ra->active || !blkcnt)
+		return -ENOENT;
+
+	ra_stats.requests++;
+	seq = start == ra->next;
+	ra->next = start + blkcnt;
+
+	/* copy what the windows hold, which may span both of them */
+	for (done = 0; done < blkcnt; done += count) {
+		rab = ra_find(ra, start + done);
+		if (!rab)
+			break;
+		count = min(blkcnt - done, rab->start + rab->blkcnt -
+			    (start + done));
+		memcpy(buffer + done * desc->blksz,
+		       rab->data + (start + done - rab->start) * desc->blksz,
+		       count * desc->blksz);
+	}
+	if (done == blkcnt) {
+		ra_stats.merged++;
+		ra_prefetch(desc, ra);
+		return blkcnt;
+	}
+
+	buffer += done * desc->blksz;
+	ret = ra_miss(desc, ra, seq || done, start + done, blkcnt - done,
+		      buffer);
+	if (ret == -ENOENT && done) {
+		/* part of the read was served already, so finish it here */
+		ra->active = true;
+		ret = blk_read(desc->bdev, start + done, blkcnt - done, buffer);
+		ra->active = false;
+	}
+	if (ret < 0)
+		return ret;
+
+	return done + ret;
+}
+
+static void ra_free(struct blk_readahead *ra)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ra->buf); i++)
+		free(ra->buf[i].data);
+	free(ra);
+}
+
+void blk_readahead_start(struct blk_desc *desc)
+{
+	struct blk_readahead *ra;
+
+	if (!desc || !desc->bdev || !desc->blksz || desc->ra)
+		return;
+
+	ra = calloc(1, sizeof(*ra));
+	if (!ra)
+		return;
+	ra->max = max(CONFIG_BLOCK_READAHEAD_MAX / desc->blksz, 1UL);
+	ra->initial = min(max(BLK_READAHEAD_INITIAL / desc->blksz, 1UL),
+			  (ulong)ra->max);
+	ra->win = ra->initial;
+	ra->next = -1;
+	desc->ra = ra;
+}
+
+void blk_readahead_stop(struct blk_desc *desc)
+{
+	if (!desc || !desc->ra)
+		return;
+
+	ra_drop(desc->ra);
+	ra_free(desc->ra);
+	desc->ra = NULL;
+}
+
+void blk_readahead_invalidate(struct blk_desc *desc)
+{
+	if (desc->ra)
+		ra_drop(desc->ra);
+}
+
+void blk_readahead_stats(struct blk_readahead_stats *stats)
+{
+	*stats = ra_stats;
+	memset(&ra_stats, '\0', sizeof(ra_stats));
+}
@@ -12,54 +12,124 @@
 #include <linux/ctype.h>
 #include <linux/list.h>
 
+/* Number of hash buckets in each per-device cache */
+#define BLKCACHE_HASH_BITS	8
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
+
+/**
+ * struct block_cache_node - a run of cached blocks
+ *
+ * @hash:	Entry in the hash bucket for @start
+ * @lru:	Entry in the owning cache's LRU list (most recent first)
+ * @start:	First block number held by this node
+ * @blkcnt:	Number of blocks held by this node
+ * @data:	Block data, @blkcnt * blksz bytes
+ */
 struct block_cache_node {
-	struct list_head lh;
-	int iftype;
-	int devnum;
+	struct hlist_node hash;
+	struct list_head lru;
 	lbaint_t start;
 	lbaint_t blkcnt;
+	char data[];
+};
+
+/**
+ * struct block_cache - block cache for a single block device
+ *
+ * This is allocated on the first fill and hangs off the device's blk_desc.
+ * Nodes are indexed by their starting block so that a lookup only has to
+ * probe the few buckets from which a node could cover the requested range.
+ *
+ * @sibling:	Entry in the list of all caches
+ * @desc:	Block device which owns this cache
+ * @blksz:	Block size at the time the cache was created
+ * @size:	Number of bytes of block data currently held
+ * @entries:	Number of nodes currently held
+ * @lru:	List of nodes, most recently used first
+ * @hash:	Hash buckets, indexed by blkcache_hash() of the start block
+ */
+struct block_cache {
+	struct list_head sibling;
+	struct blk_desc *desc;
 	unsigned long blksz;
-	char *cache;
+	unsigned long size;
+	unsigned entries;
+	struct list_head lru;
+	struct hlist_head hash[BLKCACHE_HASH_SIZE];
 };
 
-static LIST_HEAD(block_cache);
+static LIST_HEAD(block_caches);
 
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_size = CONFIG_BLOCK_CACHE_SIZE,
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+static inline uint blkcache_hash(lbaint_t start)
+{
+	u32 key = (u32)start ^ (u32)((u64)start >> 32);
+
+	/* multiplicative hash, as used by hash_32() in Linux */
+	return (key * 0x61c88647) >> (32 - BLKCACHE_HASH_BITS);
+}
+
+static void cache_drop(struct block_cache *cache, struct block_cache_node *node)
+{
+	debug("drop: start " LBAF ", count " LBAFU "\n",
+	      node->start, node->blkcnt);
+	hlist_del(&node->hash);
+	list_del(&node->lru);
+	cache->size -= node->blkcnt * cache->blksz;
+	cache->entries--;
+	free(node);
+}
+
+static struct block_cache_node *cache_find(struct block_cache *cache,
+					   lbaint_t start, lbaint_t blkcnt)
 {
 	struct block_cache_node *node;
+	lbaint_t first, blk;
+
+	/* no node is larger than this, so nothing can cover the range */
+	if (blkcnt > _stats.max_blocks_per_entry)
+		return NULL;
+
+	/* lowest start block from which a node could cover the range */
+	first = start + blkcnt - _stats.max_blocks_per_entry;
+	if (first > start)
+		first = 0;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
+	for (blk = start; ; blk--) {
+		hlist_for_each_entry(node, &cache->hash[blkcache_hash(blk)],
+				     hash) {
+			if (node->start == blk &&
+			    node->start + node->blkcnt >= start + blkcnt) {
 				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
+				if (cache->lru.next != &node->lru)
+					list_move(&node->lru, &cache->lru);
+				return node;
 			}
-			return node;
 		}
-	return 0;
+		if (blk == first)
+			break;
+	}
+
+	return NULL;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+int blkcache_read(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		  void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
+	struct block_cache *cache = desc->cache;
+	struct block_cache_node *node = NULL;
+
+	if (cache && cache->blksz == desc->blksz)
+		node = cache_find(cache, start, blkcnt);
 	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
+		const char *src = node->data + (start - node->start) *
+				  cache->blksz;
+
+		memcpy(buffer, src, cache->blksz * blkcnt);
 		debug("hit: start " LBAF ", count " LBAFU "\n",
 		      start, blkcnt);
 		++_stats.hits;
@@ -72,99 +142,133 @@ int blkcache_read(int iftype, int devnum,
 	return 0;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+static struct block_cache *cache_get(struct blk_desc *desc)
 {
-	lbaint_t bytes;
+	struct block_cache *cache = desc->cache;
+	int i;
+
+	/* the block size can change when the medium is re-initialised */
+	if (cache && cache->blksz != desc->blksz) {
+		blkcache_invalidate(desc);
+		cache = NULL;
+	}
+	if (cache)
+		return cache;
+
+	cache = malloc(sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->desc = desc;
+	cache->blksz = desc->blksz;
+	cache->size = 0;
+	cache->entries = 0;
+	INIT_LIST_HEAD(&cache->lru);
+	for (i = 0; i < BLKCACHE_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&cache->hash[i]);
+	list_add(&cache->sibling, &block_caches);
+	desc->cache = cache;
+
+	return cache;
+}
+
+void blkcache_fill(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		   void const *buffer)
+{
+	struct block_cache *cache;
 	struct block_cache_node *node;
+	unsigned long bytes;
 
 	/* don't cache big stuff */
 	if (blkcnt > _stats.max_blocks_per_entry)
 		return;
 
-	if (_stats.max_entries == 0)
+	bytes = desc->blksz * blkcnt;
+	if (!bytes || bytes > _stats.max_size)
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
+	cache = cache_get(desc);
+	if (!cache)
+		return;
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
+	/* already covered by an existing node */
+	if (cache_find(cache, start, blkcnt))
+		return;
+
+	/* pop LRU until the new node fits */
+	while (cache->size + bytes > _stats.max_size) {
+		node = list_last_entry(&cache->lru, struct block_cache_node,
+				       lru);
+		cache_drop(cache, node);
+		_stats.evictions++;
 	}
 
+	node = malloc(sizeof(*node) + bytes);
+	if (!node)
+		return;
+
 	debug("fill: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 
-	node->iftype = iftype;
-	node->devnum = devnum;
 	node->start = start;
 	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	memcpy(node->data, buffer, bytes);
+	hlist_add_head(&node->hash, &cache->hash[blkcache_hash(start)]);
+	list_add(&node->lru, &cache->lru);
+	cache->size += bytes;
+	cache->entries++;
 }
 
-void blkcache_invalidate(int iftype, int devnum)
+void blkcache_invalidate(struct blk_desc *desc)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache *cache = desc->cache;
+	struct block_cache_node *node, *n;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if (iftype == -1 ||
-		    (node->iftype == iftype && node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
-		}
-	}
+	if (!cache)
+		return;
+
+	list_for_each_entry_safe(node, n, &cache->lru, lru)
+		cache_drop(cache, node);
+	list_del(&cache->sibling);
+	free(cache);
+	desc->cache = NULL;
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+void blkcache_configure(unsigned blocks, unsigned long size)
 {
 	/* invalidate cache if there is a change */
 	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries))
-		blkcache_invalidate(-1, 0);
+	    (size != _stats.max_size))
+		blkcache_free();
 
 	_stats.max_blocks_per_entry = blocks;
-	_stats.max_entries = entries;
+	_stats.max_size = size;
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
 {
+	struct block_cache *cache;
+
+	_stats.entries = 0;
+	_stats.size = 0;
+	list_for_each_entry(cache, &block_caches, sibling) {
+		_stats.entries += cache->entries;
+		_stats.size += cache->size;
+	}
+
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_free(void)
 {
-	blkcache_invalidate(-1, 0);
+	struct block_cache *cache, *n;
+
+	list_for_each_entry_safe(cache, n, &block_caches, sibling)
+		blkcache_invalidate(cache->desc);
 }
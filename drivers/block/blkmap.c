@@ -7,12 +7,14 @@
 #include <blk.h>
 #include <blkmap.h>
 #include <dm.h>
+#include <fs.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include <part.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/root.h>
+#include <linux/sizes.h>
 
 struct blkmap;
 
@@ -40,6 +42,22 @@ struct blkmap;
  */
 #define BLKMAP_SLICE_PRESERVE	BIT(2)
 
+/**
+ * define BLKMAP_SLICE_ZERO - Sparse slice reading as zeroes
+ *
+ * This blkmap slice type is used for regions without any backing
+ * data. It reads as zeroes and takes no memory.
+ */
+#define BLKMAP_SLICE_ZERO	BIT(3)
+
+/**
+ * define BLKMAP_SLICE_LAZY - Lazily populated slice
+ *
+ * This blkmap slice type is used for data which is fetched from its
+ * source, like a file, when it is first accessed.
+ */
+#define BLKMAP_SLICE_LAZY	BIT(4)
+
 /**
  * struct blkmap_slice - Region mapped to a blkmap
  *
@@ -85,8 +103,8 @@ struct blkmap_slice {
 	/**
 	 * @destroy: - Tear down slice
 	 *
-	 * @read.bm: Blkmap to which this slice belongs
-	 * @read.bms: This slice
+	 * @destroy.bm: Blkmap to which this slice belongs
+	 * @destroy.bms: This slice
 	 */
 	void (*destroy)(struct blkmap *bm, struct blkmap_slice *bms);
 };
@@ -140,6 +158,31 @@ static int blkmap_slice_add(struct blkmap *bm, struct blkmap_slice *new)
 	return 0;
 }
 
+/* Remove the slices within a range, after mapping it failed part way */
+static void blkmap_slice_remove_range(struct blkmap *bm, lbaint_t blknr,
+				      lbaint_t blkcnt)
+{
+	struct blk_desc *bd = dev_get_uclass_plat(bm->blk);
+	struct blkmap_slice *bms, *tmp;
+
+	list_for_each_entry_safe(bms, tmp, &bm->slices, node) {
+		if (bms->blknr < blknr || bms->blknr >= blknr + blkcnt)
+			continue;
+
+		list_del(&bms->node);
+		if (bms->destroy)
+			bms->destroy(bm, bms);
+		free(bms);
+	}
+
+	if (list_empty(&bm->slices)) {
+		bd->lba = 1;
+	} else {
+		bms = list_last_entry(&bm->slices, struct blkmap_slice, node);
+		bd->lba = bms->blknr + bms->blkcnt;
+	}
+}
+
 /**
  * struct blkmap_linear - Linear mapping to other block device
  *
@@ -171,8 +214,9 @@ static ulong blkmap_linear_write(struct blkmap *bm, struct blkmap_slice *bms,
 	return blk_write(bml->blk, bml->blknr + blknr, blkcnt, buffer);
 }
 
-int blkmap_map_linear(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
-		      struct udevice *lblk, lbaint_t lblknr)
+static int __blkmap_map_linear(struct udevice *dev, lbaint_t blknr,
+			       lbaint_t blkcnt, struct udevice *lblk,
+			       lbaint_t lblknr, bool readonly)
 {
 	struct blkmap *bm = dev_get_plat(dev);
 	struct blkmap_linear *linear;
@@ -205,6 +249,9 @@ int blkmap_map_linear(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
 		.blknr = lblknr,
 	};
 
+	if (readonly)
+		linear->slice.write = NULL;
+
 	err = blkmap_slice_add(bm, &linear->slice);
 	if (err)
 		free(linear);
@@ -212,6 +259,475 @@ int blkmap_map_linear(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
 	return err;
 }
 
+int blkmap_map_linear(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
+		      struct udevice *lblk, lbaint_t lblknr)
+{
+	return __blkmap_map_linear(dev, blknr, blkcnt, lblk, lblknr, false);
+}
+
+static ulong blkmap_zero_read(struct blkmap *bm, struct blkmap_slice *bms,
+			      lbaint_t blknr, lbaint_t blkcnt, void *buffer)
+{
+	struct blk_desc *bd = dev_get_uclass_plat(bm->blk);
+
+	memset(buffer, 0, blkcnt << bd->log2blksz);
+	return blkcnt;
+}
+
+int blkmap_map_zero(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt)
+{
+	struct blkmap *bm = dev_get_plat(dev);
+	struct blkmap_slice *bms;
+	int err;
+
+	bms = malloc(sizeof(*bms));
+	if (!bms)
+		return -ENOMEM;
+
+	*bms = (struct blkmap_slice) {
+		.blknr = blknr,
+		.blkcnt = blkcnt,
+		.attr = BLKMAP_SLICE_ZERO,
+
+		.read = blkmap_zero_read,
+	};
+
+	err = blkmap_slice_add(bm, bms);
+	if (err)
+		free(bms);
+
+	return err;
+}
+
+/* Granularity at which lazily populated slices are fetched and cached */
+#define BLKMAP_CHUNK_SHIFT	20
+#define BLKMAP_CHUNK_SIZE	(1UL << BLKMAP_CHUNK_SHIFT)
+
+/**
+ * struct blkmap_chunk - Cached part of a lazily populated slice
+ *
+ * @idx: Index of the chunk within the slice, -1 if unused
+ * @age: Value of the slice's tick when the chunk was last used
+ * @data: Chunk data, allocated when the chunk is first used
+ */
+struct blkmap_chunk {
+	long idx;
+	ulong age;
+	void *data;
+};
+
+/**
+ * struct blkmap_lazy - Lazily populated mapping
+ *
+ * @slice: Common map data
+ * @fill: Fetches data from the backing source
+ * @release: Releases @priv when the slice is torn down, may be NULL
+ * @priv: Private data of the backing source
+ * @tick: Counter used to find the least recently used chunk
+ * @nchunks: Number of entries in @chunks
+ * @chunks: Chunks of backing data kept in memory
+ */
+struct blkmap_lazy {
+	struct blkmap_slice slice;
+
+	blkmap_fill_fn fill;
+	void (*release)(void *priv);
+	void *priv;
+
+	ulong tick;
+	int nchunks;
+	struct blkmap_chunk chunks[];
+};
+
+static struct blkmap_chunk *blkmap_lazy_find(struct blkmap_lazy *bml,
+					     long idx)
+{
+	int i;
+
+	for (i = 0; i < bml->nchunks; i++) {
+		if (bml->chunks[i].idx == idx)
+			return &bml->chunks[i];
+	}
+
+	return NULL;
+}
+
+/* Fetch a chunk into the least recently used entry */
+static struct blkmap_chunk *blkmap_lazy_load(struct blkmap *bm,
+					     struct blkmap_lazy *bml, long idx)
+{
+	struct blk_desc *bd = dev_get_uclass_plat(bm->blk);
+	struct blkmap_chunk *bmc = &bml->chunks[0];
+	u64 pos, size;
+	int i, err;
+
+	for (i = 1; i < bml->nchunks; i++) {
+		if (bml->chunks[i].age < bmc->age)
+			bmc = &bml->chunks[i];
+	}
+
+	pos = (u64)idx << BLKMAP_CHUNK_SHIFT;
+	size = (u64)bml->slice.blkcnt << bd->log2blksz;
+	if (!bmc->data) {
+		/* a slice smaller than a chunk only needs its own size */
+		bmc->data = malloc(min_t(u64, size, BLKMAP_CHUNK_SIZE));
+		if (!bmc->data)
+			return NULL;
+	}
+
+	bmc->idx = -1;
+	err = bml->fill(bml->priv, pos, min_t(u64, size - pos,
+					      BLKMAP_CHUNK_SIZE), bmc->data);
+	if (err) {
+		log_debug("Cannot fetch chunk %ld: %d\n", idx, err);
+		return NULL;
+	}
+	bmc->idx = idx;
+
+	return bmc;
+}
+
+static ulong blkmap_lazy_read(struct blkmap *bm, struct blkmap_slice *bms,
+			      lbaint_t blknr, lbaint_t blkcnt, void *buffer)
+{
+	struct blkmap_lazy *bml = container_of(bms, struct blkmap_lazy, slice);
+	struct blk_desc *bd = dev_get_uclass_plat(bm->blk);
+	u64 start = (u64)blknr << bd->log2blksz;
+	u64 end = (u64)(blknr + blkcnt) << bd->log2blksz;
+	struct blkmap_chunk *bmc;
+	u64 pos, len;
+	ulong off;
+	long idx;
+
+	for (pos = start; pos < end; pos += len, buffer += len) {
+		idx = pos >> BLKMAP_CHUNK_SHIFT;
+		off = pos & (BLKMAP_CHUNK_SIZE - 1);
+		len = min_t(u64, end - pos, BLKMAP_CHUNK_SIZE - off);
+
+		bmc = blkmap_lazy_find(bml, idx);
+		if (!bmc && !off && len == BLKMAP_CHUNK_SIZE) {
+			/*
+			 * Whole chunks which are not cached are fetched
+			 * straight into the caller's buffer, as one request,
+			 * so that streaming a large slice does not go through
+			 * the cache.
+			 */
+			while (end - pos - len >= BLKMAP_CHUNK_SIZE &&
+			       !blkmap_lazy_find(bml, idx + (len >>
+							     BLKMAP_CHUNK_SHIFT)))
+				len += BLKMAP_CHUNK_SIZE;
+			if (bml->fill(bml->priv, pos, len, buffer))
+				break;
+			continue;
+		}
+
+		if (!bmc)
+			bmc = blkmap_lazy_load(bm, bml, idx);
+		if (!bmc)
+			break;
+		bmc->age = ++bml->tick;
+		memcpy(buffer, bmc->data + off, len);
+	}
+
+	return (pos - start) >> bd->log2blksz;
+}
+
+static void blkmap_lazy_destroy(struct blkmap *bm, struct blkmap_slice *bms)
+{
+	struct blkmap_lazy *bml = container_of(bms, struct blkmap_lazy, slice);
+	int i;
+
+	for (i = 0; i < bml->nchunks; i++)
+		free(bml->chunks[i].data);
+
+	if (bml->release)
+		bml->release(bml->priv);
+}
+
+int blkmap_map_lazy(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
+		    blkmap_fill_fn fill, void (*release)(void *priv),
+		    void *priv)
+{
+	struct blkmap *bm = dev_get_plat(dev);
+	struct blkmap_lazy *bml;
+	int nchunks, i, err;
+
+	nchunks = max(CONFIG_BLKMAP_LAZY_CACHE_SIZE >> BLKMAP_CHUNK_SHIFT, 1);
+	bml = malloc(sizeof(*bml) + nchunks * sizeof(bml->chunks[0]));
+	if (!bml)
+		return -ENOMEM;
+
+	*bml = (struct blkmap_lazy) {
+		.slice = {
+			.blknr = blknr,
+			.blkcnt = blkcnt,
+			.attr = BLKMAP_SLICE_LAZY,
+
+			.read = blkmap_lazy_read,
+			.destroy = blkmap_lazy_destroy,
+		},
+
+		.fill = fill,
+		.release = release,
+		.priv = priv,
+		.nchunks = nchunks,
+	};
+
+	for (i = 0; i < nchunks; i++) {
+		bml->chunks[i] = (struct blkmap_chunk) {
+			.idx = -1,
+		};
+	}
+
+	err = blkmap_slice_add(bm, &bml->slice);
+	if (err)
+		free(bml);
+
+	return err;
+}
+
+/**
+ * struct blkmap_file - File backing a lazily populated mapping
+ *
+ * @desc: Block device holding the file
+ * @part: Partition holding the file
+ * @size: Size of the file in bytes
+ * @path: Path to the file
+ */
+struct blkmap_file {
+	struct blk_desc *desc;
+	int part;
+	loff_t size;
+	char path[];
+};
+
+static int blkmap_file_fill(void *priv, u64 offset, ulong len, void *buf)
+{
+	struct blkmap_file *bmf = priv;
+	loff_t actread = 0;
+	int err;
+
+	/* The mapping may extend past the end of the file */
+	if (offset < bmf->size) {
+		/*
+		 * Filesystems are not reentrant, so the file cannot be read
+		 * while a filesystem, possibly one on this blkmap, is in use.
+		 */
+		if (fs_in_use()) {
+			log_err("Cannot read %s while a filesystem is in use\n",
+				bmf->path);
+			return -EBUSY;
+		}
+
+		err = fs_set_blk_dev_with_part(bmf->desc, bmf->part);
+		if (err)
+			return -ENODEV;
+
+		err = fs_read(bmf->path, map_to_sysmem(buf), offset,
+			      min_t(u64, len, bmf->size - offset), &actread);
+		if (err)
+			return -EIO;
+	}
+
+	if (actread < len)
+		memset(buf + actread, 0, len - actread);
+
+	return 0;
+}
+
+static void blkmap_file_release(void *priv)
+{
+	free(priv);
+}
+
+/**
+ * struct blkmap_extents - Extents of a file being mapped
+ *
+ * @blksz: Block size of the device holding the file
+ * @size: Size of the file in bytes
+ * @count: Number of entries in @ext
+ * @alloc: Number of entries allocated in @ext
+ * @ext: Extents of the file, in file order
+ */
+struct blkmap_extents {
+	ulong blksz;
+	loff_t size;
+	int count;
+	int alloc;
+	struct blkmap_extent {
+		loff_t offset;
+		u64 pos;
+		u64 len;
+	} *ext;
+};
+
+static int blkmap_file_extent(void *priv, loff_t offset, u64 pos, u64 len)
+{
+	struct blkmap_extents *bme = priv;
+	struct blkmap_extent *ext;
+
+	/* only whole blocks can be mapped to the device */
+	if ((offset | pos | len) & (bme->blksz - 1))
+		return -EOPNOTSUPP;
+	if (offset >= bme->size)
+		return 0;
+
+	if (bme->count == bme->alloc) {
+		ext = realloc(bme->ext, (bme->alloc + 16) * sizeof(*ext));
+		if (!ext)
+			return -ENOMEM;
+		bme->ext = ext;
+		bme->alloc += 16;
+	}
+	bme->ext[bme->count++] = (struct blkmap_extent) {
+		.offset = offset,
+		.pos = pos,
+		.len = len,
+	};
+
+	return 0;
+}
+
+static int blkmap_buf_fill(void *priv, u64 offset, ulong len, void *buf)
+{
+	memcpy(buf, priv + offset, len);
+
+	return 0;
+}
+
+/* Map the block holding the end of the file from a copy in memory */
+static int blkmap_map_file_tail(struct udevice *dev, lbaint_t blknr,
+				struct blkmap_file *bmf, ulong blksz)
+{
+	loff_t offset = bmf->size & ~(loff_t)(blksz - 1);
+	loff_t actread;
+	void *buf;
+	int err;
+
+	buf = calloc(1, blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	if (fs_set_blk_dev_with_part(bmf->desc, bmf->part) ||
+	    fs_read(bmf->path, map_to_sysmem(buf), offset, bmf->size - offset,
+		    &actread)) {
+		free(buf);
+		return -EIO;
+	}
+
+	err = blkmap_map_lazy(dev, blknr, 1, blkmap_buf_fill,
+			      blkmap_file_release, buf);
+	if (err)
+		free(buf);
+
+	return err;
+}
+
+/*
+ * Map a file as read-only linear slices of the device holding it, so that it
+ * can be read without going through the filesystem. Holes in the file, and
+ * blocks past its end, are mapped as zeroes. Return -EOPNOTSUPP if the
+ * filesystem cannot report where the file is stored.
+ */
+static int blkmap_map_file_extents(struct udevice *dev, lbaint_t blknr,
+				   lbaint_t blkcnt, struct blkmap_file *bmf)
+{
+	struct blkmap *bm = dev_get_plat(dev);
+	struct blk_desc *bd = dev_get_uclass_plat(bm->blk);
+	struct blkmap_extents bme = {
+		.blksz = bd->blksz,
+		.size = bmf->size,
+	};
+	struct blkmap_slice range = {
+		.blknr = blknr,
+		.blkcnt = blkcnt,
+	};
+	struct blkmap_extent *ext;
+	lbaint_t nr = 0, full, start, cnt;
+	int i, err;
+
+	if (bmf->desc->blksz != bd->blksz)
+		return -EOPNOTSUPP;
+	if (!blkmap_slice_available(bm, &range))
+		return -EBUSY;
+
+	if (fs_set_blk_dev_with_part(bmf->desc, bmf->part))
+		return -ENODEV;
+	err = fs_get_extents(bmf->path, blkmap_file_extent, &bme);
+	if (err)
+		goto out;
+
+	/* blocks which are wholly within the file */
+	full = min_t(u64, blkcnt, bmf->size >> bd->log2blksz);
+	for (i = 0; i < bme.count && !err; i++) {
+		ext = &bme.ext[i];
+		start = ext->offset >> bd->log2blksz;
+		if (start >= full)
+			break;
+
+		if (start > nr)
+			err = blkmap_map_zero(dev, blknr + nr, start - nr);
+		cnt = min_t(u64, ext->len >> bd->log2blksz, full - start);
+		if (!err)
+			err = __blkmap_map_linear(dev, blknr + start, cnt,
+						  bmf->desc->bdev,
+						  ext->pos >> bd->log2blksz,
+						  true);
+		nr = start + cnt;
+	}
+	if (!err && nr < full)
+		err = blkmap_map_zero(dev, blknr + nr, full - nr);
+	nr = full;
+
+	if (!err && nr < blkcnt && (bmf->size & (bd->blksz - 1))) {
+		err = blkmap_map_file_tail(dev, blknr + nr, bmf, bd->blksz);
+		nr++;
+	}
+	if (!err && nr < blkcnt)
+		err = blkmap_map_zero(dev, blknr + nr, blkcnt - nr);
+
+	if (err)
+		blkmap_slice_remove_range(bm, blknr, blkcnt);
+out:
+	free(bme.ext);
+	return err;
+}
+
+int blkmap_map_file(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
+		    struct blk_desc *desc, int part, const char *path)
+{
+	struct blkmap_file *bmf;
+	int err;
+
+	bmf = malloc(sizeof(*bmf) + strlen(path) + 1);
+	if (!bmf)
+		return -ENOMEM;
+
+	bmf->desc = desc;
+	bmf->part = part;
+	strcpy(bmf->path, path);
+
+	if (fs_set_blk_dev_with_part(desc, part) ||
+	    fs_size(path, &bmf->size)) {
+		free(bmf);
+		return -ENOENT;
+	}
+
+	err = blkmap_map_file_extents(dev, blknr, blkcnt, bmf);
+	if (err != -EOPNOTSUPP) {
+		free(bmf);
+		return err;
+	}
+
+	/* read the file through the filesystem when it is accessed */
+	err = blkmap_map_lazy(dev, blknr, blkcnt, blkmap_file_fill,
+			      blkmap_file_release, bmf);
+	if (err)
+		free(bmf);
+
+	return err;
+}
+
 /**
  * struct blkmap_mem - Memory mapping
  *
@@ -328,7 +844,7 @@ static ulong blkmap_blk_read_slice(struct blkmap *bm, struct blkmap_slice *bms,
 	lbaint_t nr, cnt;
 
 	nr = blknr - bms->blknr;
-	cnt = (blkcnt < bms->blkcnt) ? blkcnt : bms->blkcnt;
+	cnt = min(blkcnt, bms->blkcnt - nr);
 	return bms->read(bm, bms, nr, cnt, buffer);
 }
 
@@ -360,8 +876,12 @@ static ulong blkmap_blk_write_slice(struct blkmap *bm, struct blkmap_slice *bms,
 {
 	lbaint_t nr, cnt;
 
+	/* sparse and lazily populated slices are read-only */
+	if (!bms->write)
+		return 0;
+
 	nr = blknr - bms->blknr;
-	cnt = (blkcnt < bms->blkcnt) ? blkcnt : bms->blkcnt;
+	cnt = min(blkcnt, bms->blkcnt - nr);
 	return bms->write(bm, bms, nr, cnt, buffer);
 }
 
@@ -433,6 +953,8 @@ static int blkmap_dev_unbind(struct udevice *dev)
 
 	list_for_each_entry_safe(bms, tmp, &bm->slices, node) {
 		list_del(&bms->node);
+		if (bms->destroy)
+			bms->destroy(bm, bms);
 		free(bms);
 	}
 
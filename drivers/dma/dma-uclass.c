@@ -260,6 +260,45 @@ int dma_memcpy(void *dst, void *src, size_t len)
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(DMA_BULK_COPY)
+int dma_bulk_copy_try(void *dst, const void *src, size_t len)
+{
+	ulong to = (ulong)dst, from = (ulong)src;
+	size_t head, body;
+	int ret;
+
+	/* the partial cache lines at either end must fit in the copy */
+	BUILD_BUG_ON(CONFIG_DMA_BULK_COPY_MIN < 2 * ARCH_DMA_MINALIGN);
+
+	if (len < CONFIG_DMA_BULK_COPY_MIN || (to < from + len && from < to + len))
+		return -EINVAL;
+
+	/* both areas must start at the same offset in a cache line */
+	if ((to ^ from) & (ARCH_DMA_MINALIGN - 1))
+		return -EINVAL;
+
+	head = ALIGN(to, ARCH_DMA_MINALIGN) - to;
+	body = ALIGN_DOWN(len - head, ARCH_DMA_MINALIGN);
+	ret = dma_memcpy(dst + head, (void *)src + head, body);
+	if (ret < 0) {
+		log_debug("DMA copy of %zx bytes failed (%d)\n", body, ret);
+		return ret;
+	}
+	memcpy(dst, src, head);
+	memcpy(dst + head + body, src + head + body, len - head - body);
+
+	return 0;
+}
+
+void *dma_bulk_copy(void *dst, const void *src, size_t len)
+{
+	if (dma_bulk_copy_try(dst, src, len))
+		return memmove(dst, src, len);
+
+	return dst;
+}
+#endif
+
 UCLASS_DRIVER(dma) = {
 	.id		= UCLASS_DMA,
 	.name		= "dma",
@@ -55,6 +55,29 @@ int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 	return dm_mmc_send_cmd(mmc->dev, cmd, data);
 }
 
+static int dm_mmc_send_cmd_sbc(struct udevice *dev, struct mmc_cmd *cmd,
+			       struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+	int ret;
+
+	if (!ops->send_cmd_sbc)
+		return -ENOSYS;
+
+	mmmc_trace_before_send(mmc, cmd);
+	ret = ops->send_cmd_sbc(dev, cmd, data);
+	mmmc_trace_after_send(mmc, cmd, ret);
+
+	return ret;
+}
+
+int mmc_send_cmd_sbc(struct mmc *mmc, struct mmc_cmd *cmd,
+		     struct mmc_data *data)
+{
+	return dm_mmc_send_cmd_sbc(mmc->dev, cmd, data);
+}
+
 static int dm_mmc_set_ios(struct udevice *dev)
 {
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
@@ -144,6 +167,24 @@ int mmc_execute_tuning(struct mmc *mmc, uint opcode)
 
 	return ret;
 }
+
+int mmc_get_tuning(struct mmc *mmc, u32 *tuning)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+
+	if (!ops->get_tuning)
+		return -ENOSYS;
+	return ops->get_tuning(mmc->dev, tuning);
+}
+
+int mmc_set_tuning(struct mmc *mmc, u32 tuning)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+
+	if (!ops->set_tuning)
+		return -ENOSYS;
+	return ops->set_tuning(mmc->dev, tuning);
+}
 #endif
 
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
@@ -493,7 +534,7 @@ static int mmc_select_hwpart(struct udevice *bdev, int hwpart)
 
 	ret = mmc_switch_part(mmc, hwpart);
 	if (!ret)
-		blkcache_invalidate(desc->uclass_id, desc->devnum);
+		blkcache_invalidate(desc);
 
 	return ret;
 }
@@ -456,11 +456,64 @@ int mmc_send_stop_transmission(struct mmc *mmc, bool write)
 	return mmc_send_cmd(mmc, &cmd, NULL);
 }
 
+#if !CONFIG_IS_ENABLED(DM_MMC)
+static int mmc_send_cmd_sbc(struct mmc *mmc, struct mmc_cmd *cmd,
+			    struct mmc_data *data)
+{
+	return -ENOSYS;
+}
+#endif
+
+/* Whether multi-block transfers can have their length set by CMD23 */
+static bool mmc_can_cmd23(struct mmc *mmc)
+{
+	if (!(mmc->host_caps & MMC_CAP_CMD23))
+		return false;
+	if (IS_SD(mmc))
+		return mmc->scr[0] & SD_CMD23_SUPPORT;
+
+	return mmc->version >= MMC_VERSION_3;
+}
+
+/**
+ * mmc_send_cmd_counted() - send a multi-block data command of known length
+ *
+ * The block count is set with SET_BLOCK_COUNT (CMD23) beforehand, so the card
+ * ends the transfer by itself and no STOP_TRANSMISSION is needed afterwards.
+ * Hosts which can send CMD23 along with the data command do so.
+ *
+ * @mmc:	MMC device
+ * @cmd:	Read or write command to send
+ * @data:	Data to transfer, at most 65535 blocks
+ * Return: 0 if OK, -ve on error
+ */
+static int mmc_send_cmd_counted(struct mmc *mmc, struct mmc_cmd *cmd,
+				struct mmc_data *data)
+{
+	struct mmc_cmd sbc;
+	int err;
+
+	err = mmc_send_cmd_sbc(mmc, cmd, data);
+	if (err != -ENOSYS)
+		return err;
+
+	sbc.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	sbc.cmdarg = data->blocks;
+	sbc.resp_type = MMC_RSP_R1;
+	err = mmc_send_cmd(mmc, &sbc, NULL);
+	if (err)
+		return err;
+
+	return mmc_send_cmd(mmc, cmd, data);
+}
+
 static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	bool counted = blkcnt > 1 && blkcnt <= 0xffff && mmc_can_cmd23(mmc);
+	int err;
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -479,10 +532,14 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	data.blocksize = mmc->read_bl_len;
 	data.flags = MMC_DATA_READ;
 
-	if (mmc_send_cmd(mmc, &cmd, &data))
+	if (counted)
+		err = mmc_send_cmd_counted(mmc, &cmd, &data);
+	else
+		err = mmc_send_cmd(mmc, &cmd, &data);
+	if (err)
 		return 0;
 
-	if (blkcnt > 1) {
+	if (blkcnt > 1 && !counted) {
 		if (mmc_send_stop_transmission(mmc, false)) {
 #if !defined(CONFIG_XPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
 			log_err("mmc fail to send stop cmd\n");
@@ -1689,6 +1746,17 @@ static int mmc_host_power_cycle(struct mmc *mmc)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_SUPPORTS_TUNING)
+/* Tune the host, reusing the result from an earlier boot if it still works */
+static int mmc_tune(struct mmc *mmc, uint opcode)
+{
+	if (!mmc_tuning_cache_restore(mmc, opcode))
+		return 0;
+
+	return mmc_execute_tuning(mmc, opcode);
+}
+#endif
+
 int mmc_set_clock(struct mmc *mmc, uint clock, bool disable)
 {
 	if (!disable) {
@@ -1835,7 +1903,9 @@ static int sd_select_mode_and_width(struct mmc *mmc, uint card_caps)
 #else
 	bool uhs_en = false;
 #endif
-	uint caps;
+	uint caps, cached_width;
+	enum bus_mode cached_mode;
+	bool cached;
 
 #ifdef DEBUG
 	mmc_dump_capabilities("sd card", card_caps);
@@ -1860,10 +1930,17 @@ static int sd_select_mode_and_width(struct mmc *mmc, uint card_caps)
 	if (!uhs_en)
 		caps &= ~UHS_CAPS;
 
+	/* try the settings which worked last time first */
+	cached = !mmc_tuning_cache_lookup(mmc, caps, &cached_mode,
+					  &cached_width);
+retry:
 	for_each_sd_mode_by_pref(caps, mwt) {
 		uint *w;
 
 		for (w = widths; w < widths + ARRAY_SIZE(widths); w++) {
+			if (cached && (mwt->mode != cached_mode ||
+				       *w != cached_width))
+				continue;
 			if (*w & caps & mwt->widths) {
 				pr_debug("trying mode %s width %d (at %d MHz)\n",
 					 mmc_mode_name(mwt->mode),
@@ -1889,8 +1966,7 @@ static int sd_select_mode_and_width(struct mmc *mmc, uint card_caps)
 #if CONFIG_IS_ENABLED(MMC_SUPPORTS_TUNING)
 				/* execute tuning if needed */
 				if (mwt->tuning && !mmc_host_is_spi(mmc)) {
-					err = mmc_execute_tuning(mmc,
-								 mwt->tuning);
+					err = mmc_tune(mmc, mwt->tuning);
 					if (err) {
 						pr_debug("tuning failed\n");
 						goto error;
@@ -1903,8 +1979,10 @@ static int sd_select_mode_and_width(struct mmc *mmc, uint card_caps)
 				if (err)
 					pr_warn("unable to read ssr\n");
 #endif
-				if (!err)
+				if (!err) {
+					mmc_tuning_cache_save(mmc, caps, *w);
 					return 0;
+				}
 
 error:
 				/* revert to a safer bus speed */
@@ -1915,6 +1993,13 @@ error:
 		}
 	}
 
+	if (cached) {
+		/* the card or the board changed, so start from scratch */
+		mmc_tuning_cache_drop(mmc);
+		cached = false;
+		goto retry;
+	}
+
 	log_err("unable to select a mode\n");
 	return -ENOTSUPP;
 }
@@ -2075,7 +2160,7 @@ static int mmc_select_hs400(struct mmc *mmc)
 
 	/* execute tuning if needed */
 	mmc->hs400_tuning = true;
-	err = mmc_execute_tuning(mmc, MMC_CMD_SEND_TUNING_BLOCK_HS200);
+	err = mmc_tune(mmc, MMC_CMD_SEND_TUNING_BLOCK_HS200);
 	mmc->hs400_tuning = false;
 	if (err) {
 		debug("tuning failed\n");
@@ -2164,6 +2249,9 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 	int err = 0;
 	const struct mode_width_tuning *mwt;
 	const struct ext_csd_bus_width *ecbw;
+	enum bus_mode cached_mode;
+	uint cached_width;
+	bool cached;
 
 #ifdef DEBUG
 	mmc_dump_capabilities("mmc", card_caps);
@@ -2205,10 +2293,18 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 #endif
 		mmc_set_clock(mmc, mmc->legacy_speed, MMC_CLK_ENABLE);
 
+	/* try the settings which worked last time first */
+	cached = !mmc_tuning_cache_lookup(mmc, card_caps, &cached_mode,
+					  &cached_width);
+retry:
 	for_each_mmc_mode_by_pref(card_caps, mwt) {
 		for_each_supported_width(card_caps & mwt->widths,
 					 mmc_is_mode_ddr(mwt->mode), ecbw) {
 			enum mmc_voltage old_voltage;
+
+			if (cached && (mwt->mode != cached_mode ||
+				       ecbw->cap != cached_width))
+				continue;
 			pr_debug("trying mode %s width %d (at %d MHz)\n",
 				 mmc_mode_name(mwt->mode),
 				 bus_width(ecbw->cap),
@@ -2268,8 +2364,7 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 
 				/* execute tuning if needed */
 				if (mwt->tuning) {
-					err = mmc_execute_tuning(mmc,
-								 mwt->tuning);
+					err = mmc_tune(mmc, mwt->tuning);
 					if (err) {
 						pr_debug("tuning failed : %d\n", err);
 						goto error;
@@ -2280,8 +2375,11 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 
 			/* do a transfer to check the configuration */
 			err = mmc_read_and_compare_ext_csd(mmc);
-			if (!err)
+			if (!err) {
+				mmc_tuning_cache_save(mmc, card_caps,
+						      ecbw->cap);
 				return 0;
+			}
 error:
 			mmc_set_signal_voltage(mmc, old_voltage);
 			/* if an error occurred, revert to a safer bus mode */
@@ -2293,6 +2391,13 @@ error:
 		}
 	}
 
+	if (cached) {
+		/* the card or the board changed, so start from scratch */
+		mmc_tuning_cache_drop(mmc);
+		cached = false;
+		goto retry;
+	}
+
 	log_err("unable to select a mode: %d\n", err);
 
 	return -ENOTSUPP;
@@ -88,6 +88,103 @@ static inline void mmc_trace_state(struct mmc *mmc, struct mmc_cmd *cmd)
 }
 #endif
 
+/* Number of cards whose settings are kept */
+#define MMC_TUNING_CACHE_ENTRIES	4
+
+/**
+ * struct mmc_tuning_entry - bus settings which worked with a card
+ *
+ * @cid:	Card identification; all zero if the entry is unused
+ * @caps:	Capabilities of the card and host the settings were chosen from
+ * @mode:	Bus mode (enum bus_mode)
+ * @width:	Bus width capability (MMC_MODE_xBIT)
+ * @tuned:	1 if @tuning holds a host tuning result, else 0
+ * @tuning:	Host tuning result, see get_tuning() in struct dm_mmc_ops
+ */
+struct mmc_tuning_entry {
+	u32 cid[4];
+	u32 caps;
+	u32 mode;
+	u32 width;
+	u32 tuned;
+	u32 tuning;
+};
+
+/**
+ * struct mmc_tuning_cache - contents of the bloblist record
+ *
+ * @entry:	Settings for each card
+ */
+struct mmc_tuning_cache {
+	struct mmc_tuning_entry entry[MMC_TUNING_CACHE_ENTRIES];
+};
+
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+/**
+ * mmc_tuning_cache_lookup() - find the bus settings which last worked
+ *
+ * Settings chosen from other capabilities are not used, since the mode
+ * selection might not come to the same result with @caps.
+ *
+ * @mmc:	MMC device, whose CID has been read
+ * @caps:	Capabilities of the card and host to choose a mode from
+ * @mode:	Returns the bus mode
+ * @width:	Returns the bus width capability (MMC_MODE_xBIT)
+ * Return: 0 if found, -ENOENT if the card is not known or @caps differ
+ */
+int mmc_tuning_cache_lookup(struct mmc *mmc, uint caps, enum bus_mode *mode,
+			    uint *width);
+
+/**
+ * mmc_tuning_cache_restore() - restore the tuning result for the card
+ *
+ * This replays the host tuning recorded for the card in the current bus mode
+ * and checks it by reading a single tuning block.
+ *
+ * @mmc:	MMC device
+ * @opcode:	Tuning command for the bus mode
+ * Return: 0 if OK, -ENOENT if there is nothing to restore, -EIO if the
+ *	restored tuning does not work
+ */
+int mmc_tuning_cache_restore(struct mmc *mmc, uint opcode);
+
+/**
+ * mmc_tuning_cache_save() - record the bus settings in use
+ *
+ * @mmc:	MMC device, in its selected bus mode
+ * @caps:	Capabilities of the card and host the mode was chosen from
+ * @width:	Bus width capability (MMC_MODE_xBIT)
+ */
+void mmc_tuning_cache_save(struct mmc *mmc, uint caps, uint width);
+
+/**
+ * mmc_tuning_cache_drop() - forget the bus settings for a card
+ *
+ * @mmc:	MMC device
+ */
+void mmc_tuning_cache_drop(struct mmc *mmc);
+#else
+static inline int mmc_tuning_cache_lookup(struct mmc *mmc, uint caps,
+					  enum bus_mode *mode, uint *width)
+{
+	return -ENOENT;
+}
+
+static inline int mmc_tuning_cache_restore(struct mmc *mmc, uint opcode)
+{
+	return -ENOENT;
+}
+
+static inline void mmc_tuning_cache_save(struct mmc *mmc, uint caps,
+					 uint width)
+{
+}
+
+static inline void mmc_tuning_cache_drop(struct mmc *mmc)
+{
+}
+#endif
+
 /**
  * mmc_get_next_devnum() - Get the next available MMC device number
  *
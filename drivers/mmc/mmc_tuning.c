@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Reuse of MMC bus settings between boot phases
+ *
+ * Selecting HS200, HS400 or SDR104 means tuning the host for the card, which
+ * takes many tuning block reads. The settings which worked are recorded for
+ * each card in a bloblist record, so that a later boot phase can try them
+ * first and check the tuning with a single tuning block.
+ */
+
+#define LOG_CATEGORY UCLASS_MMC
+
+#include <bloblist.h>
+#include <dm.h>
+#include <errno.h>
+#include <log.h>
+#include <mmc.h>
+#include "mmc_private.h"
+
+static struct mmc_tuning_entry *mmc_tuning_find(struct mmc *mmc)
+{
+	struct mmc_tuning_cache *cache;
+	int i;
+
+	cache = bloblist_find(BLOBLISTT_U_BOOT_MMC_TUNING, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	for (i = 0; i < MMC_TUNING_CACHE_ENTRIES; i++) {
+		if (!memcmp(cache->entry[i].cid, mmc->cid, sizeof(mmc->cid)))
+			return &cache->entry[i];
+	}
+
+	return NULL;
+}
+
+int mmc_tuning_cache_lookup(struct mmc *mmc, uint caps, enum bus_mode *mode,
+			    uint *width)
+{
+	struct mmc_tuning_entry *ent = mmc_tuning_find(mmc);
+
+	/* with other capabilities a better mode may be possible */
+	if (!ent || ent->caps != caps)
+		return -ENOENT;
+	*mode = ent->mode;
+	*width = ent->width;
+
+	return 0;
+}
+
+int mmc_tuning_cache_restore(struct mmc *mmc, uint opcode)
+{
+	struct mmc_tuning_entry *ent = mmc_tuning_find(mmc);
+	enum bus_mode mode = mmc->selected_mode;
+	int ret;
+
+	/* HS400 is tuned in HS200 mode */
+	if (mmc->hs400_tuning)
+		mode = MMC_HS_400;
+	if (!ent || !ent->tuned || ent->mode != mode)
+		return -ENOENT;
+
+	ret = mmc_set_tuning(mmc, ent->tuning);
+	if (ret)
+		return -ENOENT;
+
+	mmc->tuning = true;
+	ret = mmc_send_tuning(mmc, opcode);
+	mmc->tuning = false;
+	if (ret) {
+		log_debug("%s: cached tuning failed (err=%dE)\n",
+			  mmc->dev->name, ret);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+void mmc_tuning_cache_save(struct mmc *mmc, uint caps, uint width)
+{
+	struct mmc_tuning_cache *cache;
+	struct mmc_tuning_entry *ent;
+	int i;
+
+	ent = mmc_tuning_find(mmc);
+	if (!ent) {
+		cache = bloblist_ensure(BLOBLISTT_U_BOOT_MMC_TUNING,
+					sizeof(*cache));
+		if (!cache)
+			return;
+		/* use a free entry if there is one, else replace the first */
+		ent = &cache->entry[0];
+		for (i = 0; i < MMC_TUNING_CACHE_ENTRIES; i++) {
+			u32 *cid = cache->entry[i].cid;
+
+			if (!(cid[0] | cid[1] | cid[2] | cid[3])) {
+				ent = &cache->entry[i];
+				break;
+			}
+		}
+		memcpy(ent->cid, mmc->cid, sizeof(ent->cid));
+	}
+
+	ent->caps = caps;
+	ent->mode = mmc->selected_mode;
+	ent->width = width;
+	ent->tuned = !mmc_get_tuning(mmc, &ent->tuning);
+}
+
+void mmc_tuning_cache_drop(struct mmc *mmc)
+{
+	struct mmc_tuning_entry *ent = mmc_tuning_find(mmc);
+
+	if (ent)
+		memset(ent, '\0', sizeof(*ent));
+}
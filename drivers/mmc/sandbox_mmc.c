@@ -46,7 +46,11 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
-		memset(cmd->response, '\0', sizeof(cmd->response));
+		/* manufacturer 0xaa, product "SANDB", serial from the seq */
+		cmd->response[0] = 0xaa000053;
+		cmd->response[1] = 0x414e4442;
+		cmd->response[2] = 0x10000000 | (dev_seq(dev) & 0xff);
+		cmd->response[3] = 0;
 		break;
 	case SD_CMD_SEND_RELATIVE_ADDR:
 		cmd->response[0] = 0 << 16; /* mmc->rca */
@@ -117,7 +121,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3, 4-bit bus */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_DATA_4BIT);
 		break;
 	}
 	default:
@@ -212,7 +217,8 @@ static int sandbox_mmc_bind(struct udevice *dev)
 	struct mmc_config *cfg = &plat->cfg;
 
 	cfg->name = dev->name;
-	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
+	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_4BIT |
+			 MMC_MODE_8BIT;
 	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
@@ -129,6 +129,7 @@ static int sdhci_cdns_set_tune_val(struct sdhci_cdns_plat *plat,
 	u32 tmp;
 	int i, ret;
 
+	plat->tune_val = val;
 	if (device_is_compatible(plat->mmc.dev, "cdns,sd6hc"))
 		return sdhci_cdns6_set_tune_val(plat, val);
 
@@ -157,6 +158,21 @@ static int sdhci_cdns_set_tune_val(struct sdhci_cdns_plat *plat,
 	return 0;
 }
 
+/* Apply the result of a tuning, so that get_tuning() can report it */
+static int __maybe_unused sdhci_cdns_set_tuned(struct sdhci_cdns_plat *plat,
+					       unsigned int val)
+{
+	int ret;
+
+	plat->tuned = false;
+	ret = sdhci_cdns_set_tune_val(plat, val);
+	if (ret)
+		return ret;
+	plat->tuned = true;
+
+	return 0;
+}
+
 static int __maybe_unused sdhci_cdns_execute_tuning(struct udevice *dev,
 						    unsigned int opcode)
 {
@@ -178,6 +194,7 @@ static int __maybe_unused sdhci_cdns_execute_tuning(struct udevice *dev,
 	if (WARN_ON(opcode != MMC_CMD_SEND_TUNING_BLOCK_HS200))
 		return -EINVAL;
 
+	plat->tuned = false;
 	for (i = 0; i < SDHCI_CDNS_MAX_TUNING_LOOP; i++) {
 		if (sdhci_cdns_set_tune_val(plat, i) ||
 		    mmc_send_tuning(mmc, opcode)) { /* bad */
@@ -196,7 +213,31 @@ static int __maybe_unused sdhci_cdns_execute_tuning(struct udevice *dev,
 		return -EIO;
 	}
 
-	return sdhci_cdns_set_tune_val(plat, end_of_streak - max_streak / 2);
+	return sdhci_cdns_set_tuned(plat, end_of_streak - max_streak / 2);
+}
+
+static int __maybe_unused sdhci_cdns_get_tuning(struct udevice *dev,
+						u32 *tuning)
+{
+	struct sdhci_cdns_plat *plat = dev_get_plat(dev);
+
+	/* only report a completed eMMC tuning, which set_tuning() accepts */
+	if (!IS_MMC(&plat->mmc) || !plat->tuned)
+		return -ENOTSUPP;
+	*tuning = plat->tune_val;
+
+	return 0;
+}
+
+static int __maybe_unused sdhci_cdns_set_tuning(struct udevice *dev,
+						u32 tuning)
+{
+	struct sdhci_cdns_plat *plat = dev_get_plat(dev);
+
+	if (!IS_MMC(&plat->mmc))
+		return -ENOTSUPP;
+
+	return sdhci_cdns_set_tuned(plat, tuning);
 }
 
 static struct dm_mmc_ops sdhci_cdns_mmc_ops;
@@ -232,6 +273,8 @@ static int sdhci_cdns_probe(struct udevice *dev)
 	sdhci_cdns_mmc_ops = sdhci_ops;
 #if CONFIG_IS_ENABLED(MMC_SUPPORTS_TUNING)
 	sdhci_cdns_mmc_ops.execute_tuning = sdhci_cdns_execute_tuning;
+	sdhci_cdns_mmc_ops.get_tuning = sdhci_cdns_get_tuning;
+	sdhci_cdns_mmc_ops.set_tuning = sdhci_cdns_set_tuning;
 #endif
 
 	ret = mmc_of_parse(dev, &plat->cfg);
@@ -197,17 +197,9 @@ static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data)
 #define SDHCI_CMD_DEFAULT_TIMEOUT		100
 #define SDHCI_READ_STATUS_TIMEOUT		1000
 
-#ifdef CONFIG_DM_MMC
-static int sdhci_send_command(struct udevice *dev, struct mmc_cmd *cmd,
-			      struct mmc_data *data)
-{
-	struct mmc *mmc = mmc_get_mmc_dev(dev);
-
-#else
-static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
-			      struct mmc_data *data)
+static int sdhci_do_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
+				 struct mmc_data *data, bool auto_cmd23)
 {
-#endif
 	struct sdhci_host *host = mmc->priv;
 	unsigned int stat = 0;
 	int ret = 0;
@@ -280,6 +272,8 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 		trans_bytes = data->blocks * data->blocksize;
 		if (data->blocks > 1)
 			mode |= SDHCI_TRNS_MULTI | SDHCI_TRNS_BLK_CNT_EN;
+		if (data->blocks > 1 && auto_cmd23)
+			mode |= SDHCI_TRNS_AUTO_CMD23;
 
 		if (data->flags == MMC_DATA_READ)
 			mode |= SDHCI_TRNS_READ;
@@ -289,6 +283,9 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 			sdhci_prepare_dma(host, data, &is_aligned, trans_bytes);
 		}
 
+		if (mode & SDHCI_TRNS_AUTO_CMD23)
+			sdhci_writel(host, data->blocks, SDHCI_ARGUMENT2);
+
 		sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG,
 				data->blocksize),
 				SDHCI_BLOCK_SIZE);
@@ -351,6 +348,32 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 		return -ECOMM;
 }
 
+#ifdef CONFIG_DM_MMC
+static int sdhci_send_command(struct udevice *dev, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
+{
+	return sdhci_do_send_command(mmc_get_mmc_dev(dev), cmd, data, false);
+}
+
+static int sdhci_send_command_sbc(struct udevice *dev, struct mmc_cmd *cmd,
+				  struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+
+	if (!(host->flags & USE_AUTO_CMD23))
+		return -ENOSYS;
+
+	return sdhci_do_send_command(mmc, cmd, data, true);
+}
+#else
+static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
+{
+	return sdhci_do_send_command(mmc, cmd, data, false);
+}
+#endif
+
 #if defined(CONFIG_DM_MMC) && CONFIG_IS_ENABLED(MMC_SUPPORTS_TUNING)
 static int sdhci_execute_tuning(struct udevice *dev, uint opcode)
 {
@@ -842,6 +865,7 @@ static int sdhci_set_enhanced_strobe(struct udevice *dev)
 
 const struct dm_mmc_ops sdhci_ops = {
 	.send_cmd	= sdhci_send_command,
+	.send_cmd_sbc	= sdhci_send_command_sbc,
 	.set_ios	= sdhci_set_ios,
 	.get_cd		= sdhci_get_cd,
 	.deferred_probe	= sdhci_deferred_probe,
@@ -913,6 +937,18 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	cfg->ops = &sdhci_ops;
 #endif
 
+	/*
+	 * The argument of auto-CMD23 shares its register with the SDMA
+	 * address, so the host only sends it for ADMA or PIO transfers.
+	 */
+	if (!(host->quirks & SDHCI_QUIRK_NO_CMD23)) {
+		if (SDHCI_GET_VERSION(host) >= SDHCI_SPEC_300 &&
+		    !(host->flags & USE_SDMA) &&
+		    !(host->quirks & SDHCI_QUIRK_BROKEN_AUTO_CMD23))
+			host->flags |= USE_AUTO_CMD23;
+		cfg->host_caps |= MMC_CAP_CMD23;
+	}
+
 	/* Check whether the clock multiplier is supported or not */
 	if (SDHCI_GET_VERSION(host) >= SDHCI_SPEC_300) {
 #if CONFIG_IS_ENABLED(DM_MMC)
@@ -1084,7 +1084,7 @@ static int nand_init_data_interface(struct nand_chip *chip)
 	return 0;
 }
 
-static void __maybe_unused nand_release_data_interface(struct nand_chip *chip)
+static void nand_release_data_interface(struct nand_chip *chip)
 {
 	kfree(chip->data_interface);
 }
@@ -2304,6 +2304,190 @@ static int nand_setup_read_retry(struct mtd_info *mtd, int retry_mode)
 	return chip->setup_read_retry(mtd, retry_mode);
 }
 
+#ifdef CONFIG_SYS_NAND_PAGE_CACHE
+#define NAND_PAGE_CACHE_SIZE	CONFIG_SYS_NAND_PAGE_CACHE
+#else
+#define NAND_PAGE_CACHE_SIZE	0
+#endif
+
+/**
+ * nand_page_cache_find - [INTERN] Look up a page in the page cache
+ * @chip: NAND chip object
+ * @page: page number, not masked by chip->pagemask
+ *
+ * Returns the entry holding @page, or NULL if it is not cached.
+ */
+static struct nand_cached_page *nand_page_cache_find(struct nand_chip *chip,
+						     int page)
+{
+	struct nand_cached_page *pc;
+	int i;
+
+	for (i = 0; i < chip->page_cache_size; i++) {
+		pc = &chip->page_cache[i];
+		if (pc->page == page) {
+			pc->age = ++chip->page_cache_tick;
+			return pc;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * nand_page_cache_add - [INTERN] Keep a decoded page in the page cache
+ * @mtd: MTD device structure
+ * @page: page number, not masked by chip->pagemask
+ * @buf: page data, after ECC correction
+ * @bitflips: maximum number of bitflips corrected in an ECC step
+ *
+ * The least recently used entry is replaced.
+ */
+static void nand_page_cache_add(struct mtd_info *mtd, int page,
+				const uint8_t *buf, unsigned int bitflips)
+{
+	struct nand_chip *chip = mtd_to_nand(mtd);
+	struct nand_cached_page *pc, *lru = NULL;
+	int i;
+
+	for (i = 0; i < chip->page_cache_size; i++) {
+		pc = &chip->page_cache[i];
+		if (pc->page == page) {
+			lru = pc;
+			break;
+		}
+		if (!lru || pc->age < lru->age)
+			lru = pc;
+	}
+	if (!lru)
+		return;
+
+	lru->page = page;
+	lru->bitflips = bitflips;
+	lru->age = ++chip->page_cache_tick;
+	memcpy(lru->data, buf, mtd->writesize);
+}
+
+/**
+ * nand_page_cache_invalidate - [INTERN] Drop pages from the page cache
+ * @chip: NAND chip object
+ * @page: first page to drop, not masked by chip->pagemask
+ * @count: number of pages to drop
+ */
+static void nand_page_cache_invalidate(struct nand_chip *chip, int page,
+				       int count)
+{
+	struct nand_cached_page *pc;
+	int i;
+
+	for (i = 0; i < chip->page_cache_size; i++) {
+		pc = &chip->page_cache[i];
+		if (pc->page >= page && pc->page < page + count) {
+			pc->page = -1;
+			pc->age = 0;
+		}
+	}
+}
+
+/**
+ * nand_page_cache_init - [INTERN] Allocate the page cache
+ * @mtd: MTD device structure
+ * @size: number of pages to cache
+ */
+static void nand_page_cache_init(struct mtd_info *mtd, int size)
+{
+	struct nand_chip *chip = mtd_to_nand(mtd);
+	uint8_t *data;
+	int i;
+
+	if (size <= 0 || chip->page_cache)
+		return;
+
+	chip->page_cache = kcalloc(size, sizeof(*chip->page_cache),
+				   GFP_KERNEL);
+	data = kmalloc(size * mtd->writesize, GFP_KERNEL);
+	if (!chip->page_cache || !data) {
+		pr_warn("No memory for the NAND page cache\n");
+		kfree(chip->page_cache);
+		kfree(data);
+		chip->page_cache = NULL;
+		return;
+	}
+
+	for (i = 0; i < size; i++) {
+		chip->page_cache[i].page = -1;
+		chip->page_cache[i].data = data + i * mtd->writesize;
+	}
+	chip->page_cache_size = size;
+}
+
+/**
+ * nand_page_cache_free - [INTERN] Free the page cache
+ * @chip: NAND chip object
+ */
+static void nand_page_cache_free(struct nand_chip *chip)
+{
+	if (!chip->page_cache)
+		return;
+
+	/* the data of all entries is one allocation */
+	kfree(chip->page_cache[0].data);
+	kfree(chip->page_cache);
+	chip->page_cache = NULL;
+	chip->page_cache_size = 0;
+}
+
+/**
+ * nand_cache_read_pages - [INTERN] Pages to read with READ CACHE SEQUENTIAL
+ * @mtd: MTD device structure
+ * @ops: oob ops structure
+ * @page: first page to read, masked by chip->pagemask
+ * @col: column of the first byte to read
+ * @readlen: number of bytes left to read
+ *
+ * Cache reads are used for runs of at least two whole pages of data within
+ * the current LUN, since a sequence cannot continue into another LUN. While
+ * the host transfers one page out of the cache register, the chip loads the
+ * next one into the data register, which hides most of tR.
+ *
+ * Returns the number of pages to read in the sequence, 0 if cache reads
+ * should not be used.
+ */
+static int nand_cache_read_pages(struct mtd_info *mtd, struct mtd_oob_ops *ops,
+				 int page, int col, uint32_t readlen)
+{
+	struct nand_chip *chip = mtd_to_nand(mtd);
+	int lun_pages, pages;
+
+	if (!NAND_HAS_CACHEREAD(chip) || ops->oobbuf || col)
+		return 0;
+
+	lun_pages = (chip->pagemask + 1) / max_t(int, chip->luns, 1);
+	pages = min_t(int, readlen >> chip->page_shift,
+		      lun_pages - page % lun_pages);
+
+	return pages > 1 ? pages : 0;
+}
+
+/**
+ * nand_read_cache_op - [INTERN] Move the next page of a cache read sequence
+ *			into the cache register
+ * @chip: NAND chip object
+ * @page: page to start the sequence from, -1 to continue the sequence
+ * @last: true to end the sequence with this page
+ *
+ * This function does not select/unselect the CS line.
+ */
+static void nand_read_cache_op(struct nand_chip *chip, int page, bool last)
+{
+	struct mtd_info *mtd = nand_to_mtd(chip);
+
+	if (page >= 0)
+		chip->cmdfunc(mtd, NAND_CMD_READ0, 0, page);
+	chip->cmdfunc(mtd, last ? NAND_CMD_READCACHEEND : NAND_CMD_READCACHESEQ,
+		      -1, -1);
+}
+
 /**
  * nand_do_read_ops - [INTERN] Read data with ECC
  * @mtd: MTD device structure
@@ -2327,6 +2511,8 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	unsigned int max_bitflips = 0;
 	int retry_mode = 0;
 	bool ecc_fail = false;
+	int cache_pages = 0;
+	bool cache_start = false;
 
 	chipnr = (int)(from >> chip->chip_shift);
 	chip->select_chip(mtd, chipnr);
@@ -2342,10 +2528,14 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 
 	while (1) {
 		unsigned int ecc_failures = mtd->ecc_stats.failed;
+		struct nand_cached_page *pc = NULL;
+		bool subpage;
 
 		schedule();
 		bytes = min(mtd->writesize - col, readlen);
 		aligned = (bytes == mtd->writesize);
+		subpage = !aligned && NAND_HAS_SUBPAGE_READ(chip) && !oob &&
+			  !chip->page_cache;
 
 		if (!aligned)
 			use_bufpoi = 1;
@@ -2355,8 +2545,21 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 		else
 			use_bufpoi = 0;
 
-		/* Is the current page in the buffer? */
-		if (realpage != chip->pagebuf || oob) {
+		if (!cache_pages) {
+			cache_pages = nand_cache_read_pages(mtd, ops, page, col,
+							    readlen);
+			cache_start = cache_pages;
+		}
+
+		if (!cache_pages && !oob && ops->mode != MTD_OPS_RAW)
+			pc = nand_page_cache_find(chip, realpage);
+
+		/* Is the current page in the page cache or in the buffer? */
+		if (pc) {
+			memcpy(buf, pc->data + col, bytes);
+			buf += bytes;
+			max_bitflips = max(max_bitflips, pc->bitflips);
+		} else if (cache_pages || realpage != chip->pagebuf || oob) {
 			bufpoi = use_bufpoi ? chip->buffers->databuf : buf;
 
 			if (use_bufpoi && aligned)
@@ -2364,7 +2567,12 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 						 __func__, buf);
 
 read_retry:
-			if (nand_standard_page_accessors(&chip->ecc)) {
+			if (cache_pages) {
+				nand_read_cache_op(chip, cache_start ? page : -1,
+						   cache_pages == 1);
+				cache_start = false;
+				cache_pages--;
+			} else if (nand_standard_page_accessors(&chip->ecc)) {
 				ret = nand_read_page_op(chip, page, 0, NULL, 0);
 				if (ret)
 					break;
@@ -2378,8 +2586,7 @@ read_retry:
 				ret = chip->ecc.read_page_raw(mtd, chip, bufpoi,
 							      oob_required,
 							      page);
-			else if (!aligned && NAND_HAS_SUBPAGE_READ(chip) &&
-				 !oob)
+			else if (subpage)
 				ret = chip->ecc.read_subpage(mtd, chip,
 							col, bytes, bufpoi,
 							page);
@@ -2407,6 +2614,13 @@ read_retry:
 					chip->pagebuf = -1;
 				}
 				memcpy(buf, chip->buffers->databuf + col, bytes);
+
+				/* Keep the decoded page for later partial reads */
+				if (!subpage && !oob &&
+				    !(mtd->ecc_stats.failed - ecc_failures) &&
+				    ops->mode != MTD_OPS_RAW)
+					nand_page_cache_add(mtd, realpage,
+							    bufpoi, ret);
 			}
 
 			if (unlikely(oob)) {
@@ -2429,6 +2643,11 @@ read_retry:
 
 			if (mtd->ecc_stats.failed - ecc_failures) {
 				if (retry_mode + 1 < chip->read_retries) {
+					/* Retry outside of the cache read sequence */
+					if (cache_pages) {
+						nand_read_cache_op(chip, -1, true);
+						cache_pages = 0;
+					}
 					retry_mode++;
 					ret = nand_setup_read_retry(mtd,
 							retry_mode);
@@ -2478,6 +2697,9 @@ read_retry:
 			chip->select_chip(mtd, chipnr);
 		}
 	}
+	/* Leave the cache read sequence if the read stopped early */
+	if (cache_pages)
+		nand_read_cache_op(chip, -1, true);
 	chip->select_chip(mtd, -1);
 
 	ops->retlen = ops->len - (size_t) readlen;
@@ -3240,6 +3462,9 @@ static int nand_do_write_ops(struct mtd_info *mtd, loff_t to,
 	if (to <= ((loff_t)chip->pagebuf << chip->page_shift) &&
 	    ((loff_t)chip->pagebuf << chip->page_shift) < (to + ops->len))
 		chip->pagebuf = -1;
+	nand_page_cache_invalidate(chip, realpage,
+				   DIV_ROUND_UP(column + ops->len,
+						mtd->writesize));
 
 	/* Don't allow multipage oob writes with offset */
 	if (oob && ops->ooboffs && (ops->ooboffs + ops->ooblen > oobmaxlen)) {
@@ -3415,6 +3640,7 @@ static int nand_do_write_oob(struct mtd_info *mtd, loff_t to,
 	/* Invalidate the page cache, if we write to the cached page */
 	if (page == chip->pagebuf)
 		chip->pagebuf = -1;
+	nand_page_cache_invalidate(chip, page, 1);
 
 	nand_fill_oob(mtd, ops->oobbuf, ops->ooblen, ops);
 
@@ -3574,6 +3800,7 @@ int nand_erase_nand(struct mtd_info *mtd, struct erase_info *instr,
 		if (page <= chip->pagebuf && chip->pagebuf <
 		    (page + pages_per_block))
 			chip->pagebuf = -1;
+		nand_page_cache_invalidate(chip, page, pages_per_block);
 
 		status = chip->erase(mtd, page & chip->pagemask);
 
@@ -3945,10 +4172,14 @@ static int nand_flash_detect_onfi(struct mtd_info *mtd, struct nand_chip *chip)
 	chip->chipsize = 1 << (fls(le32_to_cpu(p->blocks_per_lun)) - 1);
 	chip->chipsize *= (uint64_t)mtd->erasesize * p->lun_count;
 	chip->bits_per_cell = p->bits_per_cell;
+	chip->luns = p->lun_count;
 
 	if (onfi_feature(chip) & ONFI_FEATURE_16_BIT_BUS)
 		chip->options |= NAND_BUSWIDTH_16;
 
+	if (le16_to_cpu(p->opt_cmd) & ONFI_OPT_CMD_READ_CACHE)
+		chip->options |= NAND_CACHERD;
+
 	if (p->ecc_bits != 0xff) {
 		chip->ecc_strength_ds = p->ecc_bits;
 		chip->ecc_step_ds = 512;
@@ -4043,6 +4274,7 @@ static int nand_flash_detect_jedec(struct mtd_info *mtd, struct nand_chip *chip)
 	chip->chipsize = 1 << (fls(le32_to_cpu(p->blocks_per_lun)) - 1);
 	chip->chipsize *= (uint64_t)mtd->erasesize * p->lun_count;
 	chip->bits_per_cell = p->bits_per_cell;
+	chip->luns = p->lun_count;
 
 	if (jedec_feature(chip) & JEDEC_FEATURE_16_BIT_BUS)
 		chip->options |= NAND_BUSWIDTH_16;
@@ -5172,6 +5404,18 @@ int nand_scan_tail(struct mtd_info *mtd)
 	/* Invalidate the pagebuffer reference */
 	chip->pagebuf = -1;
 
+	nand_page_cache_init(mtd, NAND_PAGE_CACHE_SIZE);
+
+	/*
+	 * Cache reads are only issued through the default large page command
+	 * function, with the core sending the READ PAGE commands itself.
+	 */
+	if (!IS_ENABLED(CONFIG_SYS_NAND_CACHE_READ) ||
+	    chip->cmdfunc != nand_command_lp ||
+	    !nand_standard_page_accessors(ecc) ||
+	    ecc->mode == NAND_ECC_HW_OOB_FIRST)
+		chip->options &= ~NAND_CACHERD;
+
 	/* Large page NAND with SOFT_ECC should support subpage reads */
 	switch (ecc->mode) {
 	case NAND_ECC_SOFT:
@@ -5237,6 +5481,40 @@ int nand_scan(struct mtd_info *mtd, int maxchips)
 }
 EXPORT_SYMBOL(nand_scan);
 
+/**
+ * nand_cleanup - [NAND Interface] Free resources held by the NAND device
+ * @chip: NAND chip object
+ */
+void nand_cleanup(struct nand_chip *chip)
+{
+	if (chip->ecc.mode == NAND_ECC_SOFT_BCH)
+		nand_bch_free((struct nand_bch_control *)chip->ecc.priv);
+
+	nand_release_data_interface(chip);
+	nand_page_cache_free(chip);
+
+	/* Free bad block table memory */
+	kfree(chip->bbt);
+	if (!(chip->options & NAND_OWN_BUFFERS))
+		kfree(chip->buffers);
+
+	/* Free bad block descriptor memory */
+	if (chip->badblock_pattern && chip->badblock_pattern->options
+			& NAND_BBT_DYNAMICSTRUCT)
+		kfree(chip->badblock_pattern);
+}
+EXPORT_SYMBOL_GPL(nand_cleanup);
+
+/**
+ * nand_release - [NAND Interface] Free resources held by the NAND device
+ * @mtd: MTD device structure
+ */
+void nand_release(struct mtd_info *mtd)
+{
+	nand_cleanup(mtd_to_nand(mtd));
+}
+EXPORT_SYMBOL_GPL(nand_release);
+
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Steven J. Hill <sjhill@realitydiluted.com>");
 MODULE_AUTHOR("Thomas Gleixner <tglx@linutronix.de>");
@@ -460,6 +460,7 @@ int sand_nand_remove(struct udevice *dev)
 			nand_chip = NULL;
 
 		nand_unregister(nand_to_mtd(nand));
+		nand_release(nand_to_mtd(nand));
 		free(chip->programmed);
 		os_close(chip->fd);
 		free(chip);
@@ -629,7 +630,7 @@ static int sand_nand_probe(struct udevice *dev)
 		if (ret) {
 			dev_dbg(dev, "Could not register nand %d: %d\n", devnum,
 				ret);
-			goto err_prog;
+			goto err_release;
 		}
 
 		if (!nand_chip)
@@ -639,6 +640,8 @@ static int sand_nand_probe(struct udevice *dev)
 		devnum++;
 		continue;
 
+err_release:
+		nand_release(mtd);
 err_prog:
 		free(chip->programmed);
 err_fd:
@@ -833,6 +833,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
+	ubi_io_read_hdrs(ubi, pnum);
 	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
 	if (err < 0)
 		return err;
@@ -1243,6 +1244,11 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!vidh)
 		goto out_ech;
 
+	/* Not fatal: without it, each header is read on its own */
+	ubi->hdrs_buf = kmalloc(ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize,
+				GFP_KERNEL);
+	ubi->hdrs_pnum = -1;
+
 	for (pnum = start; pnum < ubi->peb_count; pnum++) {
 		cond_resched();
 
@@ -1252,6 +1258,8 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 			goto out_vidh;
 	}
 
+	kfree(ubi->hdrs_buf);
+	ubi->hdrs_buf = NULL;
 	ubi_msg(ubi, "scanning is finished");
 
 	/* Calculate mean erase counter */
@@ -1295,6 +1303,8 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	return 0;
 
 out_vidh:
+	kfree(ubi->hdrs_buf);
+	ubi->hdrs_buf = NULL;
 	ubi_free_vid_hdr(ubi, vidh);
 out_ech:
 	kfree(ech);
@@ -87,7 +87,8 @@ static bool fm_debug;
 #endif
 #else
 #ifdef CONFIG_MTD_UBI_FASTMAP
-static bool fm_autoconvert = CONFIG_MTD_UBI_FASTMAP_AUTOCONVERT;
+static bool fm_autoconvert = CONFIG_MTD_UBI_FASTMAP_AUTOCONVERT ||
+			     IS_ENABLED(CONFIG_MTD_UBI_FASTMAP_WRITEBACK);
 static bool fm_debug = CONFIG_MTD_UBI_FM_DEBUG;
 #endif
 #endif
@@ -1010,6 +1011,16 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 			goto out_detach;
 	}
 
+#ifdef CONFIG_MTD_UBI_FASTMAP_WRITEBACK
+	/* Attached by scanning, so make sure the next attach is fast */
+	if (!ubi->fm && !ubi->fm_disabled && !ubi->ro_mode) {
+		err = ubi_update_fastmap(ubi);
+		if (err)
+			ubi_warn(ubi, "unable to write a fastmap, error %d",
+				 err);
+	}
+#endif
+
 	err = uif_init(ubi, &ref);
 	if (err)
 		goto out_detach;
@@ -136,6 +136,13 @@ int ubi_io_read(const struct ubi_device *ubi, void *buf, int pnum, int offset,
 	if (err)
 		return err;
 
+	/* Headers read by ubi_io_read_hdrs() while scanning */
+	if (ubi->hdrs_buf && pnum == ubi->hdrs_pnum &&
+	    offset + len <= ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize) {
+		memcpy(buf, ubi->hdrs_buf + offset, len);
+		return 0;
+	}
+
 	/*
 	 * Deliberately corrupt the buffer to improve robustness. Indeed, if we
 	 * do not do this, the following may happen:
@@ -251,6 +258,9 @@ int ubi_io_write(struct ubi_device *ubi, const void *buf, int pnum, int offset,
 	if (err)
 		return err;
 
+	if (pnum == ubi->hdrs_pnum)
+		ubi->hdrs_pnum = -1;
+
 	/* The area we are writing to has to contain all 0xFF bytes */
 	err = ubi_self_check_all_ff(ubi, pnum, offset, len);
 	if (err)
@@ -327,6 +337,9 @@ static int do_sync_erase(struct ubi_device *ubi, int pnum)
 		return -EROFS;
 	}
 
+	if (pnum == ubi->hdrs_pnum)
+		ubi->hdrs_pnum = -1;
+
 retry:
 	init_waitqueue_head(&wq);
 	memset(&ei, 0, sizeof(struct erase_info));
@@ -697,6 +710,38 @@ bad:
 	return 1;
 }
 
+/**
+ * ubi_io_read_hdrs - read the EC and VID headers of a PEB in one go.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock to read from
+ *
+ * While scanning, the EC and the VID header of each PEB are read one after
+ * the other. This function reads both of them with a single MTD read into
+ * @ubi->hdrs_buf, which saves a round trip to the flash for each PEB and
+ * lets the driver read consecutive pages in one go. The following
+ * 'ubi_io_read_ec_hdr()' and 'ubi_io_read_vid_hdr()' calls are then served
+ * from memory.
+ *
+ * Only a clean read is kept. If there is a bit-flip or an error, the headers
+ * are read separately as usual, so that each of them gets its own return
+ * code and the error is reported there.
+ */
+void ubi_io_read_hdrs(struct ubi_device *ubi, int pnum)
+{
+	int len = ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize;
+	size_t read;
+	int err;
+
+	ubi->hdrs_pnum = -1;
+	if (!ubi->hdrs_buf)
+		return;
+
+	err = mtd_read(ubi->mtd, (loff_t)pnum * ubi->peb_size, len, &read,
+		       ubi->hdrs_buf);
+	if (!err && read == len)
+		ubi->hdrs_pnum = pnum;
+}
+
 /**
  * ubi_io_read_ec_hdr - read and check an erase counter header.
  * @ubi: UBI device description object
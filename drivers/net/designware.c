@@ -399,6 +399,335 @@ static void tx_descs_init(struct dw_eth_dev *priv)
 	priv->tx_currdescnum = 0;
 }
 
+#if IS_ENABLED(CONFIG_NET_RX_PLACE)
+/*
+ * An Rx buffer with a destination from the network stack is set up as three
+ * chained descriptors: the head of the frame in the Rx buffer, the data part
+ * in the destination and the rest of the frame further on in the Rx buffer.
+ *
+ * Only the first buffer of a frame may start off the bus width. The DMA then
+ * counts its size from the bus-width boundary below its address, and it
+ * ignores the low address bits of the buffers which follow. So the head
+ * starts a few bytes into the Rx buffer, just far enough for the data part to
+ * start on a cache line inside the destination. This is only done when those
+ * few bytes are fewer than 4, so that they are the same for any bus width.
+ * Buffer sizes are multiples of 16, the widest bus.
+ *
+ * A short frame ends in the head, so the next one starts in the data part: a
+ * frame can start in any part. Frames other than one starting in the head of
+ * a buffer with a destination are copied out.
+ */
+#define DW_RX_BUS_ALIGN		16
+#define DW_RX_MAX_OFFSET	4
+/* Most parts a frame of MAC_MAX_FRAME_SZ bytes can span */
+#define DW_RX_MAX_PARTS		4
+/* Space at the end of each Rx buffer, used when a data part is taken back */
+#define DW_RX_SPARE		ALIGN(MAC_MAX_FRAME_SZ, ARCH_DMA_MINALIGN)
+
+static struct dmamacdescr *dw_rx_desc(struct dw_eth_dev *priv, u32 slot,
+				      u32 part)
+{
+	if (!part)
+		return &priv->rx_mac_descrtable[slot];
+
+	return &priv->rx_place_descrtable[slot][part - 1];
+}
+
+static u32 dw_rx_nparts(struct dw_eth_dev *priv, u32 slot)
+{
+	return priv->rx_placed & BIT(slot) ? 3 : 1;
+}
+
+static void dw_rx_set_desc(struct dw_eth_dev *priv, struct dmamacdescr *desc,
+			   void *buf, u32 size, struct dmamacdescr *next)
+{
+	desc->dmamac_addr = dev_phys_to_bus(priv->dev, (ulong)buf);
+	desc->dmamac_cntl = (size & DESC_RXCTRL_SIZE1MASK) |
+			    DESC_RXCTRL_RXCHAIN;
+	desc->dmamac_next = dev_phys_to_bus(priv->dev, (ulong)next);
+}
+
+static void dw_rx_flush_desc(struct dmamacdescr *desc)
+{
+	flush_dcache_range((ulong)desc, (ulong)desc + sizeof(*desc));
+}
+
+/* Set up a freed Rx buffer again, with a destination if there is one */
+static void _dw_rx_arm(struct dw_eth_dev *priv, u32 slot, int ahead)
+{
+	struct dmamacdescr *head = dw_rx_desc(priv, slot, 0);
+	struct dmamacdescr *data = dw_rx_desc(priv, slot, 1);
+	struct dmamacdescr *tail = dw_rx_desc(priv, slot, 2);
+	struct dmamacdescr *next = dw_rx_desc(priv,
+					      (slot + 1) % CFG_RX_DESCR_NUM, 0);
+	struct eth_rx_dest *dest = &priv->rx_dest[slot];
+	char *buf = &priv->rxbuffs[slot * CFG_ETH_BUFSIZE];
+	int skip, size, hdr, off, toff;
+	ulong start;
+
+	priv->rx_placed &= ~BIT(slot);
+	priv->rx_stale &= ~BIT(slot);
+	invalidate_dcache_range((ulong)buf, (ulong)buf + CFG_ETH_BUFSIZE);
+
+	if (!eth_rx_place_get(priv->dev, ahead, dest)) {
+		start = ALIGN((ulong)dest->data, ARCH_DMA_MINALIGN);
+		skip = start - (ulong)dest->data;
+		size = ALIGN_DOWN(dest->len - skip, ARCH_DMA_MINALIGN);
+		hdr = dest->hdr_len + skip;
+		off = -hdr & (DW_RX_BUS_ALIGN - 1);
+		toff = ALIGN(hdr + off, ARCH_DMA_MINALIGN);
+		if (size > 0 && off < DW_RX_MAX_OFFSET &&
+		    toff < MAC_MAX_FRAME_SZ) {
+			/* no dirty line may be written back over the data */
+			flush_dcache_range(start, start + size);
+			dw_rx_set_desc(priv, data, (void *)start, size, tail);
+			dw_rx_set_desc(priv, tail, buf + toff,
+				       MAC_MAX_FRAME_SZ - toff, next);
+			data->txrx_status = DESC_RXSTS_OWNBYDMA;
+			tail->txrx_status = DESC_RXSTS_OWNBYDMA;
+			dw_rx_flush_desc(data);
+			dw_rx_flush_desc(tail);
+			dw_rx_set_desc(priv, head, buf + off, hdr + off, data);
+			priv->rx_placed |= BIT(slot);
+		} else {
+			eth_rx_place_put(dest);
+		}
+	}
+	if (!(priv->rx_placed & BIT(slot))) {
+		dest->data = NULL;
+		dw_rx_set_desc(priv, head, buf, MAC_MAX_FRAME_SZ, next);
+	}
+
+	/* the head goes last, so that the DMA never finds half a buffer */
+	head->txrx_status = DESC_RXSTS_OWNBYDMA;
+	dw_rx_flush_desc(head);
+}
+
+/* Find the bytes of a frame which the DMA put in one part of an Rx buffer */
+static char *dw_rx_part_buf(struct dw_eth_dev *priv, struct dmamacdescr *desc,
+			    bool first, int *sizep)
+{
+	ulong addr = dev_bus_to_phys(priv->dev, desc->dmamac_addr);
+	int off = addr & (DW_RX_BUS_ALIGN - 1);
+
+	*sizep = (desc->dmamac_cntl & DESC_RXCTRL_SIZE1MASK) - off;
+	if (!first) {
+		addr -= off;
+		*sizep += off;
+	}
+	invalidate_dcache_range(ALIGN_DOWN(addr, ARCH_DMA_MINALIGN),
+				ALIGN(addr + *sizep, ARCH_DMA_MINALIGN));
+
+	return (char *)addr;
+}
+
+/*
+ * Put a frame received in place in the form eth_rx_place_split() expects: its
+ * head followed by whatever came after the data in the packet buffer, and all
+ * of the data in the destination
+ */
+static uchar *dw_rx_place_join(struct dw_eth_dev *priv,
+			       struct dmamacdescr **descs, int n, int length,
+			       const struct eth_rx_dest *dest)
+{
+	char *pkt, *data, *tail;
+	int head, size, rest, left;
+
+	pkt = dw_rx_part_buf(priv, descs[0], true, &head);
+	data = dw_rx_part_buf(priv, descs[1], false, &size);
+	/* the head also holds the start of the data */
+	memcpy(dest->data, pkt + dest->hdr_len, head - dest->hdr_len);
+
+	rest = length - head - size;
+	if (n == 3 && rest > 0) {
+		tail = dw_rx_part_buf(priv, descs[2], false, &left);
+		left = min(rest, dest->len - (head - dest->hdr_len) - size);
+		memcpy(data + size, tail, left);
+		memmove(pkt + dest->hdr_len, tail + left, rest - left);
+	}
+
+	return (uchar *)pkt;
+}
+
+static int _dw_rx_place_recv(struct dw_eth_dev *priv, uchar **packetp)
+{
+	struct dmamacdescr *descs[DW_RX_MAX_PARTS];
+	u32 slots[DW_RX_MAX_PARTS], parts[DW_RX_MAX_PARTS];
+	u32 slot = priv->rx_currdescnum, part = priv->rx_part;
+	struct eth_rx_dest *dest;
+	int length, copied, size, i, n;
+	bool drop = false;
+	u32 status;
+	char *buf;
+
+	for (n = 0; ; ) {
+		descs[n] = dw_rx_desc(priv, slot, part);
+		invalidate_dcache_range((ulong)descs[n],
+					(ulong)descs[n] + sizeof(*descs[n]));
+		status = descs[n]->txrx_status;
+		if (status & DESC_RXSTS_OWNBYDMA)
+			return -EAGAIN;
+		slots[n] = slot;
+		parts[n++] = part;
+		/* a data part taken back full may have been written over */
+		if (part == 1 && (priv->rx_stale & BIT(slot)))
+			drop = true;
+		if (status & DESC_RXSTS_RXLAST)
+			break;
+		if (n == DW_RX_MAX_PARTS) {
+			drop = true;
+			break;
+		}
+		if (++part == dw_rx_nparts(priv, slot)) {
+			part = 0;
+			slot = (slot + 1) % CFG_RX_DESCR_NUM;
+		}
+	}
+	priv->rx_nparts = n;
+	length = (status & DESC_RXSTS_FRMLENMSK) >> DESC_RXSTS_FRMLENSHFT;
+
+	dest = &priv->rx_dest[slots[0]];
+	if (!drop && n == 1 && !(parts[0] == 1 && dest->data)) {
+		*packetp = (uchar *)dw_rx_part_buf(priv, descs[0], true, &size);
+		return length;
+	}
+	if (!drop && !parts[0] && dest->data && n <= 3) {
+		*packetp = dw_rx_place_join(priv, descs, n, length, dest);
+		eth_rx_place_split(dest);
+		dest->data = NULL;
+		return length;
+	}
+
+	/* copy out anything else and give back the destinations it went to */
+	length = min(length, MAC_MAX_FRAME_SZ);
+	for (i = 0, copied = 0; i < n; i++) {
+		buf = dw_rx_part_buf(priv, descs[i], !i, &size);
+		size = min(size, length - copied);
+		if (!drop && size > 0) {
+			memcpy(priv->rx_bounce + copied, buf, size);
+			copied += size;
+		}
+		dest = &priv->rx_dest[slots[i]];
+		if (parts[i] == 1 && dest->data) {
+			eth_rx_place_put(dest);
+			dest->data = NULL;
+		}
+	}
+	if (drop)
+		return 0;
+	*packetp = (uchar *)priv->rx_bounce;
+
+	return length;
+}
+
+static int _dw_rx_place_free(struct dw_eth_dev *priv)
+{
+	u32 i;
+
+	for (i = 0; i < priv->rx_nparts; i++) {
+		if (++priv->rx_part < dw_rx_nparts(priv, priv->rx_currdescnum))
+			continue;
+
+		/* the whole buffer is free, _dw_rx_refill() sets it up again */
+		priv->rx_part = 0;
+		priv->rx_pending++;
+		if (++priv->rx_currdescnum >= CFG_RX_DESCR_NUM)
+			priv->rx_currdescnum = 0;
+	}
+	priv->rx_nparts = 0;
+
+	return 0;
+}
+
+static void _dw_rx_place_reset(struct dw_eth_dev *priv)
+{
+	u32 slot;
+
+	for (slot = 0; slot < CFG_RX_DESCR_NUM; slot++) {
+		if (priv->rx_dest[slot].data)
+			eth_rx_place_put(&priv->rx_dest[slot]);
+		priv->rx_dest[slot].data = NULL;
+	}
+	priv->rx_placed = 0;
+	priv->rx_stale = 0;
+	priv->rx_part = 0;
+	priv->rx_nparts = 0;
+}
+
+static int _dw_rx_place_stop(struct dw_eth_dev *priv)
+{
+	struct eth_dma_regs *dma_p = priv->dma_regs_p;
+	struct dmamacdescr *data;
+	unsigned int start;
+	u32 slot;
+
+	for (slot = 0; slot < CFG_RX_DESCR_NUM; slot++) {
+		if (priv->rx_dest[slot].data)
+			break;
+	}
+	if (slot == CFG_RX_DESCR_NUM)
+		return 0;
+
+	/* Stop the Rx DMA, so that the data parts can be changed */
+	writel(readl(&dma_p->opmode) & ~RXSTART, &dma_p->opmode);
+	start = get_timer(0);
+	while (readl(&dma_p->status) & RXSTATE_MASK) {
+		if (get_timer(start) >= CFG_RXSTOP_TIMEOUT) {
+			printf("Rx DMA stop timeout\n");
+			return -ETIMEDOUT;
+		}
+		udelay(10);
+	}
+
+	for (slot = 0; slot < CFG_RX_DESCR_NUM; slot++) {
+		if (!priv->rx_dest[slot].data)
+			continue;
+		priv->rx_dest[slot].data = NULL;
+		data = dw_rx_desc(priv, slot, 1);
+		invalidate_dcache_range((ulong)data,
+					(ulong)data + sizeof(*data));
+		if (!(data->txrx_status & DESC_RXSTS_OWNBYDMA)) {
+			/* the frame there is dropped, the data may change */
+			priv->rx_stale |= BIT(slot);
+			continue;
+		}
+
+		/* receive into the spare end of the Rx buffer instead */
+		dw_rx_set_desc(priv, data,
+			       &priv->rxbuffs[slot * CFG_ETH_BUFSIZE +
+					      DW_RX_SPARE],
+			       CFG_ETH_BUFSIZE - DW_RX_SPARE,
+			       dw_rx_desc(priv, slot, 2));
+		dw_rx_flush_desc(data);
+	}
+
+	writel(readl(&dma_p->opmode) | RXSTART, &dma_p->opmode);
+	writel(POLL_DATA, &dma_p->rxpolldemand);
+
+	return 0;
+}
+
+int designware_eth_rx_place_stop(struct udevice *dev)
+{
+	struct dw_eth_dev *priv = dev_get_priv(dev);
+
+	return _dw_rx_place_stop(priv);
+}
+#else
+static inline void _dw_rx_arm(struct dw_eth_dev *priv, u32 slot, int ahead) {}
+static inline int _dw_rx_place_recv(struct dw_eth_dev *priv, uchar **packetp)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline int _dw_rx_place_free(struct dw_eth_dev *priv)
+{
+	return 0;
+}
+
+static inline void _dw_rx_place_reset(struct dw_eth_dev *priv) {}
+#endif
+
 static void rx_descs_init(struct dw_eth_dev *priv)
 {
 	struct eth_dma_regs *dma_p = priv->dma_regs_p;
@@ -440,6 +769,8 @@ static void rx_descs_init(struct dw_eth_dev *priv)
 	writel(dev_phys_to_bus(priv->dev, (ulong)&desc_table_p[0]),
 			&dma_p->rxdesclistaddr);
 	priv->rx_currdescnum = 0;
+	priv->rx_pending = 0;
+	_dw_rx_place_reset(priv);
 }
 
 static int _dw_write_hwaddr(struct dw_eth_dev *priv, u8 *mac_id)
@@ -677,6 +1008,55 @@ static int _dw_eth_send(struct dw_eth_dev *priv, void *packet, int length)
 	return 0;
 }
 
+/* Give a run of Rx descriptors, which does not wrap, back to the DMA */
+static void _dw_rx_give(struct dw_eth_dev *priv, u32 desc_num, u32 count)
+{
+	struct dmamacdescr *desc_p = &priv->rx_mac_descrtable[desc_num];
+	ulong desc_start = (ulong)desc_p;
+	ulong desc_end = desc_start + count * sizeof(*desc_p);
+	ulong data_start = dev_bus_to_phys(priv->dev, desc_p->dmamac_addr);
+	ulong data_end = data_start + count * CFG_ETH_BUFSIZE;
+	u32 i;
+
+	/* Invalidate the descriptor buffer data */
+	invalidate_dcache_range(data_start, data_end);
+
+	/* Make the descriptors valid again */
+	for (i = 0; i < count; i++)
+		desc_p[i].txrx_status |= DESC_RXSTS_OWNBYDMA;
+
+	/* Flush only status field - others weren't changed */
+	flush_dcache_range(desc_start, desc_end);
+}
+
+static void _dw_rx_refill(struct dw_eth_dev *priv)
+{
+	struct eth_dma_regs *dma_p = priv->dma_regs_p;
+	u32 desc_num, count;
+
+	if (!priv->rx_pending)
+		return;
+
+	/* the freed descriptors are the ones before the current one */
+	while (priv->rx_pending) {
+		desc_num = (priv->rx_currdescnum + CFG_RX_DESCR_NUM -
+			    priv->rx_pending) % CFG_RX_DESCR_NUM;
+		count = min(priv->rx_pending, CFG_RX_DESCR_NUM - desc_num);
+		if (IS_ENABLED(CONFIG_NET_RX_PLACE)) {
+			/* each buffer may get a destination of its own */
+			count = 1;
+			_dw_rx_arm(priv, desc_num,
+				   CFG_RX_DESCR_NUM - priv->rx_pending);
+		} else {
+			_dw_rx_give(priv, desc_num, count);
+		}
+		priv->rx_pending -= count;
+	}
+
+	/* Resume reception, in case the DMA ran out of descriptors */
+	writel(POLL_DATA, &dma_p->rxpolldemand);
+}
+
 static int _dw_eth_recv(struct dw_eth_dev *priv, uchar **packetp)
 {
 	u32 status, desc_num = priv->rx_currdescnum;
@@ -688,6 +1068,14 @@ static int _dw_eth_recv(struct dw_eth_dev *priv, uchar **packetp)
 	ulong data_start = dev_bus_to_phys(priv->dev, desc_p->dmamac_addr);
 	ulong data_end;
 
+	/* The whole ring is waiting to be refilled, without rx_refill() */
+	if (priv->rx_pending == CFG_RX_DESCR_NUM)
+		_dw_rx_refill(priv);
+
+	/* a frame may span several parts of the Rx buffers */
+	if (IS_ENABLED(CONFIG_NET_RX_PLACE))
+		return _dw_rx_place_recv(priv, packetp);
+
 	/* Invalidate entire buffer descriptor */
 	invalidate_dcache_range(desc_start, desc_end);
 
@@ -712,24 +1100,15 @@ static int _dw_eth_recv(struct dw_eth_dev *priv, uchar **packetp)
 static int _dw_free_pkt(struct dw_eth_dev *priv)
 {
 	u32 desc_num = priv->rx_currdescnum;
-	struct dmamacdescr *desc_p = &priv->rx_mac_descrtable[desc_num];
-	ulong desc_start = (ulong)desc_p;
-	ulong desc_end = desc_start +
-		roundup(sizeof(*desc_p), ARCH_DMA_MINALIGN);
-	ulong data_start = dev_bus_to_phys(priv->dev, desc_p->dmamac_addr);
-	ulong data_end = data_start + roundup(CFG_ETH_BUFSIZE, ARCH_DMA_MINALIGN);
 
-	/* Invalidate the descriptor buffer data */
-	invalidate_dcache_range(data_start, data_end);
+	if (IS_ENABLED(CONFIG_NET_RX_PLACE))
+		return _dw_rx_place_free(priv);
 
 	/*
-	 * Make the current descriptor valid again and go to
-	 * the next one
+	 * The descriptor is given back to the DMA by _dw_rx_refill(), along
+	 * with the others freed during the same burst. Go to the next one.
 	 */
-	desc_p->txrx_status |= DESC_RXSTS_OWNBYDMA;
-
-	/* Flush only status field - others weren't changed */
-	flush_dcache_range(desc_start, desc_end);
+	priv->rx_pending++;
 
 	/* Test the wrap-around condition. */
 	if (++desc_num >= CFG_RX_DESCR_NUM)
@@ -817,6 +1196,13 @@ int designware_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 	return _dw_free_pkt(priv);
 }
 
+void designware_eth_rx_refill(struct udevice *dev)
+{
+	struct dw_eth_dev *priv = dev_get_priv(dev);
+
+	_dw_rx_refill(priv);
+}
+
 void designware_eth_stop(struct udevice *dev)
 {
 	struct dw_eth_dev *priv = dev_get_priv(dev);
@@ -1006,8 +1392,12 @@ const struct eth_ops designware_eth_ops = {
 	.send			= designware_eth_send,
 	.recv			= designware_eth_recv,
 	.free_pkt		= designware_eth_free_pkt,
+	.rx_refill		= designware_eth_rx_refill,
 	.stop			= designware_eth_stop,
 	.write_hwaddr		= designware_eth_write_hwaddr,
+#if IS_ENABLED(CONFIG_NET_RX_PLACE)
+	.rx_place_stop		= designware_eth_rx_place_stop,
+#endif
 };
 
 int designware_eth_of_to_plat(struct udevice *dev)
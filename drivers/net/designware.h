@@ -22,6 +22,7 @@
 
 #define CFG_MACRESET_TIMEOUT	(3 * CONFIG_SYS_HZ)
 #define CFG_MDIO_TIMEOUT	(3 * CONFIG_SYS_HZ)
+#define CFG_RXSTOP_TIMEOUT	(CONFIG_SYS_HZ / 10)
 
 struct eth_mac_regs {
 	u32 conf;		/* 0x00 */
@@ -97,6 +98,9 @@ struct eth_dma_regs {
 #define RXHIGHPRIO		(1 << 1)
 #define DMAMAC_SRST		(1 << 0)
 
+/* Status definitions */
+#define RXSTATE_MASK		(7 << 17)
+
 /* Poll demand definitions */
 #define POLL_DATA		(0xFFFFFFFF)
 
@@ -229,6 +233,17 @@ struct dw_eth_dev {
 	u32 max_speed;
 	u32 tx_currdescnum;
 	u32 rx_currdescnum;
+	u32 rx_pending;		/* freed Rx descriptors not given back yet */
+#if IS_ENABLED(CONFIG_NET_RX_PLACE)
+	/* data and tail parts of the Rx buffers set up with a destination */
+	struct dmamacdescr rx_place_descrtable[CFG_RX_DESCR_NUM][2];
+	struct eth_rx_dest rx_dest[CFG_RX_DESCR_NUM];
+	u32 rx_placed;		/* Rx buffers set up in three parts */
+	u32 rx_stale;		/* Rx buffers whose data part was taken back */
+	u32 rx_part;		/* part of the current Rx buffer */
+	u32 rx_nparts;		/* parts holding the frame returned by recv() */
+	char rx_bounce[MAC_MAX_FRAME_SZ];
+#endif
 #if IS_ENABLED(CONFIG_BITBANGMII) && IS_ENABLED(CONFIG_DM_GPIO)
 	u32 bb_delay;
 	struct gpio_desc mdc_gpio;
@@ -264,6 +279,8 @@ int designware_eth_send(struct udevice *dev, void *packet, int length);
 int designware_eth_recv(struct udevice *dev, int flags, uchar **packetp);
 int designware_eth_free_pkt(struct udevice *dev, uchar *packet,
 				   int length);
+void designware_eth_rx_refill(struct udevice *dev);
+int designware_eth_rx_place_stop(struct udevice *dev);
 void designware_eth_stop(struct udevice *dev);
 int designware_eth_write_hwaddr(struct udevice *dev);
 
@@ -266,8 +266,12 @@ static const struct eth_ops dwmac_thead_eth_ops = {
 	.send                   = designware_eth_send,
 	.recv                   = designware_eth_recv,
 	.free_pkt               = designware_eth_free_pkt,
+	.rx_refill              = designware_eth_rx_refill,
 	.stop                   = designware_eth_stop,
 	.write_hwaddr           = designware_eth_write_hwaddr,
+#if IS_ENABLED(CONFIG_NET_RX_PLACE)
+	.rx_place_stop          = designware_eth_rx_place_stop,
+#endif
 };
 
 static const struct udevice_id dwmac_thead_match[] = {
@@ -97,10 +97,25 @@ static int sb_eth_raw_recv(struct udevice *dev, int flags, uchar **packetp)
 		length = ARP_HDR_SIZE;
 	} else {
 		/* If local, the Ethernet header won't be included; skip it */
-		uchar *pktptr = priv->local ?
-			net_rx_packets[0] + ETHER_HDR_SIZE : net_rx_packets[0];
-
-		retval = sandbox_eth_raw_os_recv(pktptr, &length, priv);
+		int skip = priv->local ? ETHER_HDR_SIZE : 0;
+		uchar *pktptr = net_rx_packets[0] + skip;
+		struct eth_rx_dest dest;
+
+		/* The data of a download can go straight to its destination */
+		if (!eth_rx_place_get(dev, 0, &dest)) {
+			int hdr_len = dest.hdr_len - skip;
+
+			retval = sandbox_eth_raw_os_recv_split(pktptr, hdr_len,
+							       dest.data,
+							       dest.len,
+							       &length, priv);
+			if (!retval && length)
+				eth_rx_place_split(&dest);
+			else
+				eth_rx_place_put(&dest);
+		} else {
+			retval = sandbox_eth_raw_os_recv(pktptr, &length, priv);
+		}
 	}
 
 	if (!retval && length) {
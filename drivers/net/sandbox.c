@@ -424,9 +424,24 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	return priv->tx_handler(dev, packet, length);
 }
 
+/*
+ * Act like a device which received the data part of a frame into a destination
+ * handed out by the network stack, and the rest into the packet buffer
+ */
+static void sb_eth_split(uchar *pkt, int len, const struct eth_rx_dest *dest)
+{
+	int hdr = min(len, dest->hdr_len);
+	int data = min(len - hdr, dest->len);
+
+	memcpy(dest->data, pkt + hdr, data);
+	memmove(pkt + hdr, pkt + hdr + data, len - hdr - data);
+	eth_rx_place_split(dest);
+}
+
 static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct eth_rx_dest dest;
 
 	if (skip_timeout) {
 		timer_test_add_offset(11000UL);
@@ -439,6 +454,8 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		debug("eth_sandbox: received packet[%d], %d waiting\n",
 		      lcl_recv_packet_length, priv->recv_packets - 1);
 		*packetp = priv->recv_packet_buffer[0];
+		if (!eth_rx_place_get(dev, 0, &dest))
+			sb_eth_split(*packetp, lcl_recv_packet_length, &dest);
 		return lcl_recv_packet_length;
 	}
 	return 0;
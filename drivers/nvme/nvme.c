@@ -7,6 +7,7 @@
 #include <blk.h>
 #include <bootdev.h>
 #include <cpu_func.h>
+#include <cyclic.h>
 #include <dm.h>
 #include <errno.h>
 #include <log.h>
@@ -18,11 +19,13 @@
 #include "nvme.h"
 
 #define NVME_Q_DEPTH		2
+/* Deeper I/O queue, so that asynchronous requests can overlap */
+#define NVME_IO_Q_DEPTH		64
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
-#define NVME_CQ_ALLOCATION	ALIGN(NVME_CQ_SIZE(NVME_Q_DEPTH), \
-				      ARCH_DMA_MINALIGN)
+#define NVME_CQ_ALLOCATION(depth)	ALIGN(NVME_CQ_SIZE(depth), \
+					      ARCH_DMA_MINALIGN)
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
 #define MAX_PRP_POOL		512
@@ -39,13 +42,26 @@ static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 	while (get_timer(start) < timeout) {
 		if ((readl(&dev->bar->csts) & mask) == val)
 			return 0;
+		schedule();
 	}
 
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+/**
+ * nvme_setup_prps() - set up the second PRP entry for a transfer
+ *
+ * @dev:	NVMe device
+ * @poolp:	PRP list to use if one is needed; this is reallocated if it
+ *		is too small
+ * @entry_num:	Number of entries in *@poolp, updated if it is reallocated
+ * @prp2:	Returns the value for the PRP2 field of the command
+ * @total_len:	Length of the transfer in bytes
+ * @dma_addr:	Address of the transfer
+ * Return: 0 if OK, -ENOMEM if the PRP list could not be allocated
+ */
+static int nvme_setup_prps(struct nvme_dev *dev, u64 **poolp, u32 *entry_num,
+			   u64 *prp2, int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
@@ -73,36 +89,37 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 	nprps = DIV_ROUND_UP(length, page_size);
 	num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
+	if (nprps > *entry_num) {
+		free(*poolp);
 		/*
 		 * Always increase in increments of pages.  It doesn't waste
 		 * much memory and reduces the number of allocations.
 		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
+		*poolp = memalign(page_size, num_pages * page_size);
+		if (!*poolp) {
+			*entry_num = 0;
 			printf("Error: malloc prp_pool fail\n");
 			return -ENOMEM;
 		}
-		dev->prp_entry_num = num_pages * (prps_per_page - 1) + 1;
+		*entry_num = num_pages * (prps_per_page - 1) + 1;
 	}
 
-	prp_pool = dev->prp_pool;
+	prp_pool = *poolp;
 	i = 0;
 	while (nprps) {
 		if ((i == (prps_per_page - 1)) && nprps > 1) {
 			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
 					page_size);
 			i = 0;
-			prp_pool += page_size;
+			prp_pool += prps_per_page;
 		}
 		*(prp_pool + i++) = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)*poolp;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
+	flush_dcache_range((ulong)*poolp, (ulong)*poolp +
 			   num_pages * page_size);
 
 	return 0;
@@ -124,13 +141,44 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 	 * as the cache line should never become dirty.
 	 */
 	ulong start = (ulong)&nvmeq->cqes[0];
-	ulong stop = start + NVME_CQ_ALLOCATION;
+	ulong stop = start + NVME_CQ_ALLOCATION(nvmeq->q_depth);
 
 	invalidate_dcache_range(start, stop);
 
 	return readw(&(nvmeq->cqes[index].status));
 }
 
+static void nvme_copy_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	u16 tail = nvmeq->sq_tail;
+
+	memcpy(&nvmeq->sq_cmds[tail], cmd, sizeof(*cmd));
+	flush_dcache_range((ulong)&nvmeq->sq_cmds[tail],
+			   (ulong)&nvmeq->sq_cmds[tail] + sizeof(*cmd));
+}
+
+/**
+ * nvme_queue_cmd() - copy a command into a queue without ringing the doorbell
+ *
+ * The controller does not see the command until nvme_ring_sq() is called, so
+ * that several commands can be handed over with a single doorbell write. This
+ * is not used with controller-specific submission.
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send
+ */
+static void nvme_queue_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	nvme_copy_cmd(nvmeq, cmd);
+	if (++nvmeq->sq_tail == nvmeq->q_depth)
+		nvmeq->sq_tail = 0;
+}
+
+static void nvme_ring_sq(struct nvme_queue *nvmeq)
+{
+	writel(nvmeq->sq_tail, nvmeq->q_db);
+}
+
 /**
  * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
  *
@@ -140,22 +188,16 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 {
 	struct nvme_ops *ops;
-	u16 tail = nvmeq->sq_tail;
-
-	memcpy(&nvmeq->sq_cmds[tail], cmd, sizeof(*cmd));
-	flush_dcache_range((ulong)&nvmeq->sq_cmds[tail],
-			   (ulong)&nvmeq->sq_cmds[tail] + sizeof(*cmd));
 
 	ops = (struct nvme_ops *)nvmeq->dev->udev->driver->ops;
 	if (ops && ops->submit_cmd) {
+		nvme_copy_cmd(nvmeq, cmd);
 		ops->submit_cmd(nvmeq, cmd);
 		return;
 	}
 
-	if (++tail == nvmeq->q_depth)
-		tail = 0;
-	writel(tail, nvmeq->q_db);
-	nvmeq->sq_tail = tail;
+	nvme_queue_cmd(nvmeq, cmd);
+	nvme_ring_sq(nvmeq);
 }
 
 static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
@@ -233,7 +275,7 @@ static struct nvme_queue *nvme_alloc_queue(struct nvme_dev *dev,
 		return NULL;
 	memset(nvmeq, 0, sizeof(*nvmeq));
 
-	nvmeq->cqes = (void *)memalign(4096, NVME_CQ_ALLOCATION);
+	nvmeq->cqes = (void *)memalign(4096, NVME_CQ_ALLOCATION(depth));
 	if (!nvmeq->cqes)
 		goto free_nvmeq;
 	memset((void *)nvmeq->cqes, 0, NVME_CQ_SIZE(depth));
@@ -317,6 +359,13 @@ static int nvme_shutdown_ctrl(struct nvme_dev *dev)
 
 static void nvme_free_queue(struct nvme_queue *nvmeq)
 {
+	int i;
+
+	if (nvmeq->async) {
+		for (i = 0; i < nvmeq->q_depth; i++)
+			free(nvmeq->async[i].prp_pool);
+		free(nvmeq->async);
+	}
 	free((void *)nvmeq->cqes);
 	free(nvmeq->sq_cmds);
 	free(nvmeq);
@@ -344,7 +393,7 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
 	memset((void *)nvmeq->cqes, 0, NVME_CQ_SIZE(nvmeq->q_depth));
 	flush_dcache_range((ulong)nvmeq->cqes,
-			   (ulong)nvmeq->cqes + NVME_CQ_ALLOCATION);
+			   (ulong)nvmeq->cqes + NVME_CQ_ALLOCATION(nvmeq->q_depth));
 	dev->online_queues++;
 }
 
@@ -741,11 +790,312 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
+/**
+ * nvme_async_reap() - process completions of asynchronous commands
+ *
+ * This updates the requests which own the completed commands and frees their
+ * slots, then releases all the completion queue entries at once. Commands
+ * which timed out just have their slots freed.
+ *
+ * @nvmeq:	I/O queue to check
+ * Return: number of completions processed
+ */
+static int nvme_async_reap(struct nvme_queue *nvmeq)
+{
+	u16 head = nvmeq->cq_head;
+	u16 phase = nvmeq->cq_phase;
+	int count = 0;
+
+	while (nvmeq->async_count) {
+		struct nvme_async_cmd *acmd = NULL;
+		struct blk_req *req = NULL;
+		u16 status, cid;
+
+		status = nvme_read_completion_status(nvmeq, head);
+		if ((status & 0x01) != phase)
+			break;
+
+		cid = readw(&nvmeq->cqes[head].command_id);
+		if (cid < nvmeq->q_depth) {
+			acmd = &nvmeq->async[cid];
+			req = acmd->req;
+		}
+		if (acmd && acmd->timed_out) {
+			log_debug("Late completion, cid %d\n", cid);
+			acmd->timed_out = false;
+			nvmeq->async_count--;
+		} else if (req) {
+			acmd->req = NULL;
+			nvmeq->async_count--;
+			req->pending--;
+			req->timestamp = timer_get_us();
+			status >>= 1;
+			if (status) {
+				printf("ERROR: status = %x, cid = %d\n", status,
+				       cid);
+				req->err = -EIO;
+			}
+		} else {
+			log_err("Unexpected completion, cid %d\n", cid);
+		}
+
+		if (++head == nvmeq->q_depth) {
+			head = 0;
+			phase = !phase;
+		}
+		count++;
+	}
+
+	if (count) {
+		writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
+		nvmeq->cq_head = head;
+		nvmeq->cq_phase = phase;
+	}
+
+	return count;
+}
+
+/**
+ * nvme_async_drain() - wait for all asynchronous commands to complete
+ *
+ * @nvmeq:	I/O queue to drain
+ * Return: 0 if OK, -ETIMEDOUT if the commands did not complete
+ */
+static int nvme_async_drain(struct nvme_queue *nvmeq)
+{
+	ulong start_time = timer_get_us();
+
+	while (nvmeq->async_count) {
+		if (nvme_async_reap(nvmeq))
+			start_time = timer_get_us();
+		else if (timer_get_us() - start_time >= IO_TIMEOUT * 100000)
+			return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+/**
+ * nvme_async_alloc() - set up the command slots of the I/O queue
+ *
+ * Each slot gets a PRP list large enough for a transfer of the maximum size
+ * up front, so that nvme_setup_prps() does not allocate while commands are
+ * issued. If memory runs short, the remaining slots get a list on first use.
+ *
+ * @nvmeq:	I/O queue to set up
+ * Return: 0 if OK, -ENOMEM if the slots could not be allocated
+ */
+static int nvme_async_alloc(struct nvme_queue *nvmeq)
+{
+	struct nvme_dev *dev = nvmeq->dev;
+	u32 page_size = dev->page_size;
+	u32 prps_per_page = page_size >> 3;
+	u32 nprps, num_pages;
+	int i;
+
+	if (nvmeq->async)
+		return 0;
+
+	nvmeq->async = calloc(nvmeq->q_depth, sizeof(*nvmeq->async));
+	if (!nvmeq->async)
+		return -ENOMEM;
+
+	/* entries needed after the first page of a maximum-sized transfer */
+	nprps = (1ULL << dev->max_transfer_shift) / page_size;
+	if (nprps <= 1)
+		return 0;
+	num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
+
+	for (i = 0; i < nvmeq->q_depth; i++) {
+		struct nvme_async_cmd *acmd = &nvmeq->async[i];
+
+		acmd->prp_pool = memalign(page_size, num_pages * page_size);
+		if (!acmd->prp_pool)
+			break;
+		acmd->prp_entry_num = num_pages * (prps_per_page - 1) + 1;
+	}
+
+	return 0;
+}
+
+/**
+ * nvme_async_issue() - issue as much of a request as the queue has room for
+ *
+ * The request is split into commands of at most the maximum transfer size.
+ * Each command uses a free slot, whose index is the command ID. The commands
+ * are queued back to back and the doorbell is rung once for all of them.
+ *
+ * @ns:		Namespace to access
+ * @req:	Request to issue
+ */
+static void nvme_async_issue(struct nvme_ns *ns, struct blk_req *req)
+{
+	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	lbaint_t max_lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
+	bool queued = false;
+
+	while (req->issued < req->blkcnt &&
+	       nvmeq->async_count < nvmeq->q_depth - 1) {
+		lbaint_t lbas = min(req->blkcnt - req->issued, max_lbas);
+		ulong buf = (ulong)req->buffer + (req->issued << ns->lba_shift);
+		struct nvme_async_cmd *acmd;
+		struct nvme_command c;
+		u64 prp2;
+		u16 cid;
+
+		for (cid = 0; nvmeq->async[cid].req ||
+		     nvmeq->async[cid].timed_out; cid++)
+			;
+		acmd = &nvmeq->async[cid];
+		if (nvme_setup_prps(dev, &acmd->prp_pool, &acmd->prp_entry_num,
+				    &prp2, lbas << ns->lba_shift, buf)) {
+			req->err = -ENOMEM;
+			break;
+		}
+
+		memset(&c, 0, sizeof(c));
+		c.rw.opcode = req->write ? nvme_cmd_write : nvme_cmd_read;
+		c.rw.command_id = cpu_to_le16(cid);
+		c.rw.nsid = cpu_to_le32(ns->ns_id);
+		c.rw.slba = cpu_to_le64(req->start + req->issued);
+		c.rw.length = cpu_to_le16(lbas - 1);
+		c.rw.prp1 = cpu_to_le64(buf);
+		c.rw.prp2 = cpu_to_le64(prp2);
+		nvme_queue_cmd(nvmeq, &c);
+		queued = true;
+
+		acmd->req = req;
+		nvmeq->async_count++;
+		req->pending++;
+		req->issued += lbas;
+	}
+
+	if (queued)
+		nvme_ring_sq(nvmeq);
+}
+
+int nvme_async_submit(struct nvme_ns *ns, struct blk_req *req)
+{
+	struct nvme_queue *nvmeq = ns->dev->queues[NVME_IO_Q];
+	int ret;
+
+	ret = nvme_async_alloc(nvmeq);
+	if (ret)
+		return ret;
+
+	flush_dcache_range((ulong)req->buffer, (ulong)req->buffer +
+			   (req->blkcnt << ns->lba_shift));
+	req->timestamp = timer_get_us();
+	nvme_async_issue(ns, req);
+	if (req->err && !req->pending)
+		return req->err;
+
+	return 0;
+}
+
+int nvme_async_poll(struct nvme_ns *ns, struct blk_req *req)
+{
+	struct nvme_queue *nvmeq = ns->dev->queues[NVME_IO_Q];
+	int i;
+
+	nvme_async_reap(nvmeq);
+	if (!req->err)
+		nvme_async_issue(ns, req);
+
+	/* this also covers waiting for slots held by timed-out commands */
+	if (req->pending || (!req->err && req->issued < req->blkcnt)) {
+		if (timer_get_us() - req->timestamp < IO_TIMEOUT * 100000)
+			return -EBUSY;
+
+		/*
+		 * Give up on the request. Its commands may still be carried
+		 * out, so keep their slots until they complete.
+		 */
+		for (i = 0; i < nvmeq->q_depth; i++) {
+			if (nvmeq->async[i].req == req) {
+				nvmeq->async[i].req = NULL;
+				nvmeq->async[i].timed_out = true;
+			}
+		}
+		req->pending = 0;
+		return -ETIMEDOUT;
+	}
+	if (req->err)
+		return req->err;
+
+	if (!req->write)
+		invalidate_dcache_range((ulong)req->buffer, (ulong)req->buffer +
+					(req->blkcnt << ns->lba_shift));
+	req->result = req->blkcnt;
+
+	return 0;
+}
+
+static int nvme_blk_submit(struct udevice *udev, struct blk_req *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_ops *ops = (struct nvme_ops *)ns->dev->udev->driver->ops;
+
+	/* controller-specific submission only handles one command at a time */
+	if (ops && ops->submit_cmd)
+		return -ENOSYS;
+
+	return nvme_async_submit(ns, req);
+}
+
+static int nvme_blk_poll(struct udevice *udev, struct blk_req *req)
+{
+	return nvme_async_poll(dev_get_priv(udev), req);
+}
+
+/**
+ * nvme_blk_rw_queued() - transfer blocks using the whole depth of the I/O queue
+ *
+ * Rather than waiting for each command before building the next, all the
+ * commands of the transfer are issued back to back, as far as the queue has
+ * room, and their completions are reaped together.
+ *
+ * @udev:	Block device to access
+ * @blknr:	First block to transfer
+ * @blkcnt:	Number of blocks to transfer
+ * @buffer:	Buffer to transfer to or from
+ * @read:	true to read, false to write
+ * Return: number of blocks transferred, 0 on error
+ */
+static ulong nvme_blk_rw_queued(struct udevice *udev, lbaint_t blknr,
+				lbaint_t blkcnt, void *buffer, bool read)
+{
+	struct blk_req req = {
+		.dev = udev,
+		.start = blknr,
+		.blkcnt = blkcnt,
+		.buffer = buffer,
+		.write = !read,
+	};
+	int ret;
+
+	ret = nvme_blk_submit(udev, &req);
+	if (!ret) {
+		do {
+			ret = nvme_blk_poll(udev, &req);
+		} while (ret == -EBUSY);
+	}
+	if (ret) {
+		log_debug("%s of " LBAFU " blocks at " LBAFU " failed (err=%dE)\n",
+			  read ? "Read" : "Write", blkcnt, blknr, ret);
+		return 0;
+	}
+
+	return blkcnt;
+}
+
 static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 			 lbaint_t blkcnt, void *buffer, bool read)
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
+	struct nvme_ops *ops = (struct nvme_ops *)dev->udev->driver->ops;
 	struct nvme_command c;
 	struct blk_desc *desc = dev_get_uclass_plat(udev);
 	int status;
@@ -758,6 +1108,13 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
 	u64 total_lbas = blkcnt;
 
+	if (!ops || !ops->submit_cmd)
+		return nvme_blk_rw_queued(udev, blknr, blkcnt, buffer, read);
+
+	/* the synchronous path expects to own the I/O completion queue */
+	if (nvme_async_drain(dev->queues[NVME_IO_Q]))
+		return -EIO;
+
 	flush_dcache_range((unsigned long)buffer,
 			   (unsigned long)buffer + total_len);
 
@@ -779,8 +1136,8 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 			total_lbas -= lbas;
 		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, temp_buffer))
+		if (nvme_setup_prps(dev, &dev->prp_pool, &dev->prp_entry_num,
+				    &prp2, lbas << ns->lba_shift, temp_buffer))
 			return -EIO;
 		c.rw.slba = cpu_to_le64(slba);
 		slba += lbas;
@@ -817,6 +1174,8 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 static const struct blk_ops nvme_blk_ops = {
 	.read	= nvme_blk_read,
 	.write	= nvme_blk_write,
+	.submit	= nvme_blk_submit,
+	.poll	= nvme_blk_poll,
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
@@ -831,6 +1190,7 @@ int nvme_init(struct udevice *udev)
 {
 	struct nvme_dev *ndev = dev_get_priv(udev);
 	struct nvme_id_ns *id;
+	struct nvme_ops *ops;
 	int ret;
 
 	ndev->udev = udev;
@@ -850,7 +1210,14 @@ int nvme_init(struct udevice *udev)
 	memset(ndev->queues, 0, NVME_Q_NUM * sizeof(struct nvme_queue *));
 
 	ndev->cap = nvme_readq(&ndev->bar->cap);
-	ndev->q_depth = min_t(int, NVME_CAP_MQES(ndev->cap) + 1, NVME_Q_DEPTH);
+	/*
+	 * Controller-specific submission (e.g. Apple ANS) tracks commands by
+	 * submission queue slot, so keep the shallow queue there.
+	 */
+	ops = (struct nvme_ops *)udev->driver->ops;
+	ndev->q_depth = min_t(int, NVME_CAP_MQES(ndev->cap) + 1,
+			      ops && ops->submit_cmd ? NVME_Q_DEPTH :
+			      NVME_IO_Q_DEPTH);
 	ndev->db_stride = 1 << NVME_CAP_STRIDE(ndev->cap);
 	ndev->dbs = ((void __iomem *)ndev->bar) + 4096;
 
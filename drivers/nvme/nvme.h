@@ -630,6 +630,29 @@ enum nvme_queue_id {
 	NVME_Q_NUM,
 };
 
+/**
+ * struct nvme_async_cmd - slot for a command issued by the asynchronous path
+ *
+ * Commands issued through the blk submit()/poll() methods use the index of
+ * their slot as the command ID, so that completions can be matched to their
+ * request. Each slot keeps its own PRP list since several commands may be in
+ * flight at once.
+ *
+ * @req:		Request which owns the command, or NULL if it has none
+ * @timed_out:		true if the request gave up on the command, which may
+ *			still be in flight. The slot stays in use until the
+ *			command completes, or the queue is freed when the
+ *			controller is reset
+ * @prp_pool:		PRP list for this slot
+ * @prp_entry_num:	Number of entries available in @prp_pool
+ */
+struct nvme_async_cmd {
+	struct blk_req *req;
+	bool timed_out;
+	u64 *prp_pool;
+	u32 prp_entry_num;
+};
+
 /*
  * An NVM Express queue. Each device has at least two (one for admin
  * commands and one for I/O commands).
@@ -647,6 +670,8 @@ struct nvme_queue {
 	u16 qid;
 	u8 cq_phase;
 	u8 cqe_seen;
+	struct nvme_async_cmd *async;
+	u16 async_count;
 	unsigned long cmdid_data[];
 };
 
@@ -705,4 +730,30 @@ int nvme_init(struct udevice *udev);
  */
 int nvme_shutdown(struct udevice *udev);
 
+/**
+ * nvme_async_submit() - start a request on the I/O queue of a namespace
+ *
+ * As many commands as the queue has room for are issued straight away; the
+ * rest are issued by nvme_async_poll() as slots become free.
+ *
+ * @ns:		Namespace to access
+ * @req:	Request to start
+ * Return: 0 if OK, -ve on error
+ */
+int nvme_async_submit(struct nvme_ns *ns, struct blk_req *req);
+
+/**
+ * nvme_async_poll() - check whether a request has completed
+ *
+ * If the request has made no progress for IO_TIMEOUT, it is given up on.
+ * Its outstanding commands keep their slots until they complete, since the
+ * controller may still access their buffers and PRP lists.
+ *
+ * @ns:		Namespace being accessed
+ * @req:	Request to check
+ * Return: 0 if complete, -EBUSY if still in progress, -ETIMEDOUT if it
+ * timed out, other -ve on error
+ */
+int nvme_async_poll(struct nvme_ns *ns, struct blk_req *req);
+
 #endif /* __DRIVER_NVME_H__ */
@@ -367,6 +367,58 @@ static int cadence_spi_mem_exec_op(struct spi_slave *spi,
 	return err;
 }
 
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+static int cadence_spi_mem_dirmap_create(struct spi_mem_dirmap_desc *desc)
+{
+	struct udevice *bus = desc->slave->dev->parent;
+	struct cadence_spi_priv *priv = dev_get_priv(bus);
+
+	if (desc->info.op_tmpl.data.dir != SPI_MEM_DATA_IN ||
+	    !priv->use_dac_mode || desc->info.offset >= priv->ahbsize)
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
+static ssize_t cadence_spi_mem_dirmap_read(struct spi_mem_dirmap_desc *desc,
+					   u64 offs, size_t len, void *buf)
+{
+	struct udevice *bus = desc->slave->dev->parent;
+	struct cadence_spi_priv *priv = dev_get_priv(bus);
+	struct spi_mem_op op = desc->info.op_tmpl;
+	u64 from = desc->info.offset + offs;
+	int err;
+
+	/*
+	 * Only the start of the flash is inside the AHB window, so stop a
+	 * read there at its end. Anything beyond is read indirectly.
+	 */
+	if (from < priv->ahbsize)
+		len = min_t(u64, len, priv->ahbsize - from);
+
+	op.addr.val = from;
+	op.data.nbytes = len;
+	op.data.buf.in = buf;
+
+	cadence_qspi_apb_chipselect(priv->regbase,
+				    spi_chip_select(desc->slave->dev),
+				    priv->is_decoded_cs);
+
+	err = cadence_qspi_apb_read_setup(priv, &op);
+	if (err)
+		return err;
+
+	if (priv->is_dma)
+		err = cadence_qspi_apb_dma_read(priv, &op);
+	else
+		err = cadence_qspi_apb_read_execute(priv, &op);
+	if (err)
+		return err;
+
+	return len;
+}
+#endif
+
 static bool cadence_spi_mem_supports_op(struct spi_slave *slave,
 					const struct spi_mem_op *op)
 {
@@ -457,6 +509,10 @@ static int cadence_spi_of_to_plat(struct udevice *bus)
 static const struct spi_controller_mem_ops cadence_spi_mem_ops = {
 	.exec_op = cadence_spi_mem_exec_op,
 	.supports_op = cadence_spi_mem_supports_op,
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+	.dirmap_create = cadence_spi_mem_dirmap_create,
+	.dirmap_read = cadence_spi_mem_dirmap_read,
+#endif
 };
 
 static const struct dm_spi_ops cadence_spi_ops = {
@@ -810,6 +810,57 @@ static int nxp_fspi_exec_op(struct spi_slave *slave,
 	return err;
 }
 
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+static int nxp_fspi_dirmap_create(struct spi_mem_dirmap_desc *desc)
+{
+	struct nxp_fspi *f = dev_get_priv(desc->slave->dev->parent);
+
+	/* Writes still go through the TX FIFO, one page at a time */
+	if (desc->info.op_tmpl.data.dir != SPI_MEM_DATA_IN || needs_ip_only(f))
+		return -EOPNOTSUPP;
+
+	if (desc->info.offset >= f->memmap_phy_size)
+		return -EINVAL;
+
+	return 0;
+}
+
+/*
+ * Read through the AHB window in a single go, rather than in chunks of the
+ * AHB buffer size as done by nxp_fspi_exec_op(). The controller prefetches
+ * the next buffer while the previous one is copied, so the flash is read at
+ * close to its full bandwidth.
+ */
+static ssize_t nxp_fspi_dirmap_read(struct spi_mem_dirmap_desc *desc,
+				    u64 offs, size_t len, void *buf)
+{
+	struct nxp_fspi *f = dev_get_priv(desc->slave->dev->parent);
+	struct spi_mem_op op = desc->info.op_tmpl;
+	u64 addr = desc->info.offset + offs;
+	int err;
+
+	if (addr >= f->memmap_phy_size)
+		return -EINVAL;
+	len = min_t(u64, len, f->memmap_phy_size - addr);
+
+	err = fspi_readl_poll_tout(f, f->iobase + FSPI_STS0,
+				   FSPI_STS0_ARB_IDLE, 1, POLL_TOUT, true);
+	if (err)
+		return err;
+
+	op.addr.val = addr;
+	op.data.nbytes = len;
+	op.data.buf.in = buf;
+	nxp_fspi_prepare_lut(f, &op);
+	nxp_fspi_read_ahb(f, &op);
+
+	/* Invalidate the data in the AHB buffer. */
+	nxp_fspi_invalid(f);
+
+	return len;
+}
+#endif
+
 static int nxp_fspi_adjust_op_size(struct spi_slave *slave,
 				   struct spi_mem_op *op)
 {
@@ -1058,6 +1109,10 @@ static const struct spi_controller_mem_ops nxp_fspi_mem_ops = {
 	.adjust_op_size = nxp_fspi_adjust_op_size,
 	.supports_op = nxp_fspi_supports_op,
 	.exec_op = nxp_fspi_exec_op,
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+	.dirmap_create = nxp_fspi_dirmap_create,
+	.dirmap_read = nxp_fspi_dirmap_read,
+#endif
 };
 
 static const struct dm_spi_ops nxp_fspi_ops = {
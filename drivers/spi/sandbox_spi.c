@@ -15,9 +15,11 @@
 #include <malloc.h>
 #include <spi.h>
 #include <spi_flash.h>
+#include <spi-mem.h>
 #include <os.h>
 
 #include <linux/errno.h>
+#include <linux/sizes.h>
 #include <asm/spi.h>
 #include <asm/state.h>
 #include <dm/acpi.h>
@@ -34,12 +36,19 @@
  *
  * @speed:	Current bus speed.
  * @mode:	Current bus mode.
+ * @dirmap_reads:	Direct mapping reads inside the mapped window.
+ * @dirmap_fallbacks:	Direct mapping reads beyond the mapped window.
  */
 struct sandbox_spi_priv {
 	uint speed;
 	uint mode;
+	uint dirmap_reads;
+	uint dirmap_fallbacks;
 };
 
+/* Size of the part of a flash which reads as if memory-mapped */
+#define SANDBOX_SPI_DIRMAP_SIZE	SZ_1M
+
 __weak int sandbox_spi_get_emul(struct sandbox_state *state,
 				struct udevice *bus, struct udevice *slave,
 				struct udevice **emulp)
@@ -61,6 +70,15 @@ uint sandbox_spi_get_mode(struct udevice *dev)
 	return priv->mode;
 }
 
+void sandbox_spi_get_dirmap_stats(struct udevice *dev, uint *readsp,
+				  uint *fallbacksp)
+{
+	struct sandbox_spi_priv *priv = dev_get_priv(dev);
+
+	*readsp = priv->dirmap_reads;
+	*fallbacksp = priv->dirmap_fallbacks;
+}
+
 static int sandbox_spi_xfer(struct udevice *slave, unsigned int bitlen,
 			    const void *dout, void *din, unsigned long flags)
 {
@@ -152,12 +170,64 @@ static int sandbox_spi_get_mmap(struct udevice *dev, ulong *map_basep,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+static int sandbox_spi_dirmap_create(struct spi_mem_dirmap_desc *desc)
+{
+	if (desc->info.op_tmpl.data.dir != SPI_MEM_DATA_IN ||
+	    desc->info.offset >= SANDBOX_SPI_DIRMAP_SIZE)
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
+/*
+ * Act like a controller which maps only the start of the flash, such as
+ * cadence_qspi. A read stops at the end of the window and anything beyond
+ * it is read as usual.
+ */
+static ssize_t sandbox_spi_dirmap_read(struct spi_mem_dirmap_desc *desc,
+				       u64 offs, size_t len, void *buf)
+{
+	struct sandbox_spi_priv *priv = dev_get_priv(desc->slave->dev->parent);
+	struct spi_mem_op op = desc->info.op_tmpl;
+	u64 from = desc->info.offset + offs;
+	int ret;
+
+	if (from < SANDBOX_SPI_DIRMAP_SIZE) {
+		len = min_t(u64, len, SANDBOX_SPI_DIRMAP_SIZE - from);
+		priv->dirmap_reads++;
+	} else {
+		priv->dirmap_fallbacks++;
+	}
+
+	op.addr.val = from;
+	op.data.nbytes = len;
+	op.data.buf.in = buf;
+	ret = spi_mem_adjust_op_size(desc->slave, &op);
+	if (ret)
+		return ret;
+	ret = spi_mem_exec_op(desc->slave, &op);
+	if (ret)
+		return ret;
+
+	return op.data.nbytes;
+}
+
+static const struct spi_controller_mem_ops sandbox_spi_mem_ops = {
+	.dirmap_create	= sandbox_spi_dirmap_create,
+	.dirmap_read	= sandbox_spi_dirmap_read,
+};
+#endif
+
 static const struct dm_spi_ops sandbox_spi_ops = {
 	.xfer		= sandbox_spi_xfer,
 	.set_speed	= sandbox_spi_set_speed,
 	.set_mode	= sandbox_spi_set_mode,
 	.cs_info	= sandbox_cs_info,
 	.get_mmap	= sandbox_spi_get_mmap,
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+	.mem_ops	= &sandbox_spi_mem_ops,
+#endif
 };
 
 static const struct udevice_id sandbox_spi_ids[] = {
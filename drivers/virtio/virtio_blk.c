@@ -8,14 +8,40 @@
 
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
+#include <time.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
+#include <linux/list.h>
 #include "virtio_blk.h"
 
+/* Time without progress after which asynchronous requests are failed */
+#define VIRTIO_BLK_TIMEOUT_MS	3000
+
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	unsigned int async_count;
+	struct list_head async_list;
+};
+
+/**
+ * struct virtio_blk_async - an asynchronous request on the virtqueue
+ *
+ * The header must come first, since virtqueue_get_buf() returns the address of
+ * the first buffer in the chain.
+ *
+ * @out_hdr:	Request header
+ * @status:	Status written by the device
+ * @req:	Block request this belongs to, NULL once it has timed out
+ * @sibling:	Entry in the list of requests on the virtqueue
+ */
+struct virtio_blk_async {
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+	struct blk_req *req;
+	struct list_head sibling;
 };
 
 static const u32 feature[] = {
@@ -59,6 +85,187 @@ static void virtio_blk_init_data_sg(void *buffer, lbaint_t blkcnt, struct virtio
 	sg->length = blkcnt * 512;
 }
 
+/**
+ * virtio_blk_async_reap() - process used buffers of asynchronous requests
+ *
+ * Buffers of requests which timed out are just freed.
+ *
+ * @dev:	Block device
+ * Return: number of used buffers processed
+ */
+static int virtio_blk_async_reap(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_async *async;
+	struct blk_req *req;
+	int count = 0;
+
+	while (priv->async_count &&
+	       (async = virtqueue_get_buf(priv->vq, NULL))) {
+		req = async->req;
+		if (req) {
+			if (async->status != VIRTIO_BLK_S_OK)
+				req->err = -EIO;
+			req->pending--;
+			req->priv = NULL;
+		} else {
+			log_debug("Late completion\n");
+		}
+		list_del(&async->sibling);
+		priv->async_count--;
+		free(async);
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * virtio_blk_async_abandon() - fail a request which is on the virtqueue
+ *
+ * The device may still use the buffers of the request, so they stay on the
+ * virtqueue until it returns them.
+ *
+ * @req:	Request to fail
+ */
+static void virtio_blk_async_abandon(struct blk_req *req)
+{
+	struct virtio_blk_async *async = req->priv;
+
+	async->req = NULL;
+	req->priv = NULL;
+	req->pending = 0;
+	req->err = -ETIMEDOUT;
+}
+
+/**
+ * virtio_blk_async_drain() - wait for all asynchronous requests to complete
+ *
+ * If the device makes no progress for VIRTIO_BLK_TIMEOUT_MS, the requests
+ * still on the virtqueue are failed.
+ *
+ * @dev:	Block device
+ * Return: 0 if OK, -ETIMEDOUT if the requests did not complete
+ */
+static int virtio_blk_async_drain(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_async *async;
+	ulong start = get_timer(0);
+
+	while (priv->async_count) {
+		if (virtio_blk_async_reap(dev)) {
+			start = get_timer(0);
+		} else if (get_timer(start) >= VIRTIO_BLK_TIMEOUT_MS) {
+			list_for_each_entry(async, &priv->async_list, sibling) {
+				if (async->req)
+					virtio_blk_async_abandon(async->req);
+			}
+			return -ETIMEDOUT;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * virtio_blk_async_issue() - add a request to the virtqueue if there is room
+ *
+ * @dev:	Block device
+ * @req:	Request to add
+ * Return: 0 if added or if the queue is full, other -ve on error
+ */
+static int virtio_blk_async_issue(struct udevice *dev, struct blk_req *req)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_async *async = req->priv;
+	struct virtio_sg hdr_sg, data_sg, status_sg;
+	struct virtio_sg *sgs[3];
+	u32 type = req->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+	int ret;
+
+	virtio_blk_init_header_sg(dev, req->start, type, &async->out_hdr,
+				  &hdr_sg);
+	virtio_blk_init_data_sg(req->buffer, req->blkcnt, &data_sg);
+	virtio_blk_init_status_sg(&async->status, &status_sg);
+	sgs[0] = &hdr_sg;
+	sgs[1] = &data_sg;
+	sgs[2] = &status_sg;
+
+	ret = virtqueue_add(priv->vq, sgs, req->write ? 2 : 1,
+			    req->write ? 1 : 2);
+	if (ret == -ENOSPC)
+		return 0;
+	if (ret)
+		return ret;
+
+	req->issued = req->blkcnt;
+	req->pending++;
+	list_add_tail(&async->sibling, &priv->async_list);
+	priv->async_count++;
+	virtqueue_kick(priv->vq);
+
+	return 0;
+}
+
+static int virtio_blk_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_async *async;
+	int ret;
+
+	/* the buffer returned for a bounced chain is not our header */
+	if (priv->vq->vring.bouncebufs)
+		return -ENOSYS;
+
+	async = malloc(sizeof(*async));
+	if (!async)
+		return -ENOMEM;
+	async->req = req;
+	req->priv = async;
+	req->timestamp = get_timer(0);
+
+	ret = virtio_blk_async_issue(dev, req);
+	if (ret) {
+		free(async);
+		req->priv = NULL;
+	}
+
+	return ret;
+}
+
+static int virtio_blk_poll(struct udevice *dev, struct blk_req *req)
+{
+	int ret;
+
+	virtio_blk_async_reap(dev);
+	if (!req->issued) {
+		ret = virtio_blk_async_issue(dev, req);
+		if (!ret && !req->issued &&
+		    get_timer(req->timestamp) >= VIRTIO_BLK_TIMEOUT_MS)
+			ret = -ETIMEDOUT;
+		if (ret) {
+			free(req->priv);
+			req->priv = NULL;
+			return ret;
+		}
+		/* the device has the whole timeout to complete it */
+		if (req->issued)
+			req->timestamp = get_timer(0);
+		return -EBUSY;
+	}
+	if (req->pending) {
+		if (get_timer(req->timestamp) < VIRTIO_BLK_TIMEOUT_MS)
+			return -EBUSY;
+		virtio_blk_async_abandon(req);
+	}
+	if (req->err)
+		return req->err;
+	req->result = req->blkcnt;
+
+	return 0;
+}
+
 static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
 			       lbaint_t blkcnt, void *buffer, u32 type)
 {
@@ -98,6 +305,10 @@ static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
 	log_debug("dev=%s, active=%d, priv=%p, priv->vq=%p\n", dev->name,
 		  device_active(dev), priv, priv->vq);
 
+	/* completions of asynchronous requests must not be mistaken for ours */
+	if (virtio_blk_async_drain(dev))
+		return -EIO;
+
 	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
 	if (ret)
 		return ret;
@@ -181,6 +392,7 @@ static int virtio_blk_probe(struct udevice *dev)
 	ret = virtio_find_vqs(dev, 1, &priv->vq);
 	if (ret)
 		return ret;
+	INIT_LIST_HEAD(&priv->async_list);
 
 	desc->blksz = 512;
 	desc->log2blksz = 9;
@@ -194,6 +406,8 @@ static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
 	.erase	= virtio_blk_erase,
+	.submit	= virtio_blk_submit,
+	.poll	= virtio_blk_poll,
 };
 
 U_BOOT_DRIVER(virtio_blk) = {
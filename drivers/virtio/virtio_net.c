@@ -30,6 +30,7 @@ struct virtio_net_priv {
 	};
 
 	char rx_buff[VIRTIO_NET_NUM_RX_BUFS][VIRTIO_NET_RX_BUF_SIZE];
+	struct eth_rx_dest rx_dest[VIRTIO_NET_NUM_RX_BUFS];
 	bool rx_running;
 	int net_hdr_len;
 };
@@ -47,22 +48,47 @@ static const u32 feature_legacy[] = {
 	VIRTIO_NET_F_MAC
 };
 
+/*
+ * Put a receive buffer in the rx ring. If the network stack has a destination
+ * for the packet expected in it, the data part of the frame goes straight
+ * there, between the header and the rest of the frame in the buffer.
+ */
+static void virtio_net_add_rx_buf(struct udevice *dev, int i)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	struct eth_rx_dest *dest = &priv->rx_dest[i];
+	char *buf = priv->rx_buff[i];
+	struct virtio_sg sg[3];
+	struct virtio_sg *sgs[] = { &sg[0], &sg[1], &sg[2] };
+	int hdr;
+
+	if (eth_rx_place_get(dev, VIRTIO_NET_NUM_RX_BUFS - 1, dest)) {
+		dest->data = NULL;
+		sg[0].addr = buf;
+		sg[0].length = VIRTIO_NET_RX_BUF_SIZE;
+		virtqueue_add(priv->rx_vq, sgs, 0, 1);
+		return;
+	}
+
+	hdr = priv->net_hdr_len + dest->hdr_len;
+	sg[0].addr = buf;
+	sg[0].length = hdr;
+	sg[1].addr = dest->data;
+	sg[1].length = dest->len;
+	sg[2].addr = buf + hdr;
+	sg[2].length = VIRTIO_NET_RX_BUF_SIZE - hdr;
+	virtqueue_add(priv->rx_vq, sgs, 0, 3);
+}
+
 static int virtio_net_start(struct udevice *dev)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
-	struct virtio_sg sg;
-	struct virtio_sg *sgs[] = { &sg };
 	int i;
 
 	if (!priv->rx_running) {
-		/* receive buffer length is always 1526 */
-		sg.length = VIRTIO_NET_RX_BUF_SIZE;
-
 		/* setup the receive buffer address */
-		for (i = 0; i < VIRTIO_NET_NUM_RX_BUFS; i++) {
-			sg.addr = priv->rx_buff[i];
-			virtqueue_add(priv->rx_vq, sgs, 0, 1);
-		}
+		for (i = 0; i < VIRTIO_NET_NUM_RX_BUFS; i++)
+			virtio_net_add_rx_buf(dev, i);
 
 		virtqueue_kick(priv->rx_vq);
 
@@ -110,11 +136,16 @@ static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 	struct virtio_net_priv *priv = dev_get_priv(dev);
 	unsigned int len;
 	void *buf;
+	int i;
 
 	buf = virtqueue_get_buf(priv->rx_vq, &len);
 	if (!buf)
 		return -EAGAIN;
 
+	i = (buf - (void *)priv->rx_buff) / VIRTIO_NET_RX_BUF_SIZE;
+	if (priv->rx_dest[i].data)
+		eth_rx_place_split(&priv->rx_dest[i]);
+
 	*packetp = buf + priv->net_hdr_len;
 	return len - priv->net_hdr_len;
 }
@@ -123,11 +154,61 @@ static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
 	void *buf = packet - priv->net_hdr_len;
-	struct virtio_sg sg = { buf, VIRTIO_NET_RX_BUF_SIZE };
-	struct virtio_sg *sgs[] = { &sg };
 
-	/* Put the buffer back to the rx ring */
-	virtqueue_add(priv->rx_vq, sgs, 0, 1);
+	/* Put the buffer back to the rx ring, it is kicked by rx_refill */
+	virtio_net_add_rx_buf(dev, (buf - (void *)priv->rx_buff) /
+			      VIRTIO_NET_RX_BUF_SIZE);
+
+	return 0;
+}
+
+static void virtio_net_rx_refill(struct udevice *dev)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+
+	/* hand the buffers put back during the burst to the device in one go */
+	virtqueue_kick(priv->rx_vq);
+}
+
+static int virtio_net_rx_place_stop(struct udevice *dev)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	int i, ret;
+
+	for (i = 0; i < VIRTIO_NET_NUM_RX_BUFS; i++) {
+		if (priv->rx_dest[i].data)
+			break;
+	}
+	if (i == VIRTIO_NET_NUM_RX_BUFS)
+		return 0;
+
+	/*
+	 * Buffers cannot be taken back from a virtqueue, so reset the device
+	 * and set up the queues again, with plain buffers. This is only needed
+	 * when placing stops with a placed buffer still outstanding, which a
+	 * transfer that completes normally does not leave behind.
+	 */
+	virtio_reset(dev);
+	memset(priv->rx_dest, '\0', sizeof(priv->rx_dest));
+	virtio_add_status(dev, VIRTIO_CONFIG_S_ACKNOWLEDGE |
+			  VIRTIO_CONFIG_S_DRIVER);
+	ret = virtio_finalize_features(dev);
+	if (!ret)
+		ret = virtio_del_vqs(dev);
+	if (!ret)
+		ret = virtio_find_vqs(dev, 2, priv->vqs);
+	if (ret) {
+		/* the device stays reset, so it writes nothing more */
+		virtio_add_status(dev, VIRTIO_CONFIG_S_FAILED);
+		return ret;
+	}
+	virtio_add_status(dev, VIRTIO_CONFIG_S_DRIVER_OK);
+
+	if (priv->rx_running) {
+		for (i = 0; i < VIRTIO_NET_NUM_RX_BUFS; i++)
+			virtio_net_add_rx_buf(dev, i);
+		virtqueue_kick(priv->rx_vq);
+	}
 
 	return 0;
 }
@@ -220,9 +301,11 @@ static const struct eth_ops virtio_net_ops = {
 	.send = virtio_net_send,
 	.recv = virtio_net_recv,
 	.free_pkt = virtio_net_free_pkt,
+	.rx_refill = virtio_net_rx_refill,
 	.stop = virtio_net_stop,
 	.write_hwaddr = virtio_net_write_hwaddr,
 	.read_rom_hwaddr = virtio_net_read_rom_hwaddr,
+	.rx_place_stop = virtio_net_rx_place_stop,
 };
 
 U_BOOT_DRIVER(virtio_net) = {
@@ -97,10 +97,48 @@ static void virtqueue_detach_desc(struct virtqueue *vq, unsigned int idx)
 	desc->addr = cpu_to_virtio64(vq->vdev, (u64)(uintptr_t)bb->user_buffer);
 }
 
+/**
+ * virtqueue_add_indirect() - build an indirect descriptor table for a chain
+ *
+ * @vq:		Virtqueue
+ * @sgs:	Buffers, readable ones first
+ * @out_sgs:	Number of buffers readable by the device
+ * @descs_used:	Total number of buffers
+ * Return: the table, or NULL if out of memory
+ */
+static struct vring_desc *virtqueue_add_indirect(struct virtqueue *vq,
+						 struct virtio_sg *sgs[],
+						 unsigned int out_sgs,
+						 unsigned int descs_used)
+{
+	struct vring_desc *indir;
+	unsigned int n;
+
+	indir = memalign(VRING_DESC_ALIGN_SIZE, descs_used * sizeof(*indir));
+	if (!indir)
+		return NULL;
+
+	for (n = 0; n < descs_used; n++) {
+		u16 flags = 0;
+
+		if (n >= out_sgs)
+			flags |= VRING_DESC_F_WRITE;
+		if (n < descs_used - 1)
+			flags |= VRING_DESC_F_NEXT;
+		indir[n].addr = cpu_to_virtio64(vq->vdev,
+						(u64)(uintptr_t)sgs[n]->addr);
+		indir[n].len = cpu_to_virtio32(vq->vdev, sgs[n]->length);
+		indir[n].flags = cpu_to_virtio16(vq->vdev, flags);
+		indir[n].next = cpu_to_virtio16(vq->vdev, n + 1);
+	}
+
+	return indir;
+}
+
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		  unsigned int out_sgs, unsigned int in_sgs)
 {
-	struct vring_desc *desc;
+	struct vring_desc *desc, *indir = NULL;
 	unsigned int descs_used = out_sgs + in_sgs;
 	unsigned int i, n, avail, uninitialized_var(prev);
 	int head;
@@ -112,6 +150,16 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	desc = vq->vring.desc;
 	i = head;
 
+	/*
+	 * Bounce buffers are per ring descriptor, so they need a direct chain.
+	 * Don't build a table which would have nowhere to go on a full ring.
+	 */
+	if (vq->indirect && descs_used > 1 && !vq->vring.bouncebufs &&
+	    vq->num_free)
+		indir = virtqueue_add_indirect(vq, sgs, out_sgs, descs_used);
+	if (indir)
+		descs_used = 1;
+
 	if (vq->num_free < descs_used) {
 		debug("Can't add buf len %i - avail = %i\n",
 		      descs_used, vq->num_free);
@@ -125,17 +173,33 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		return -ENOSPC;
 	}
 
-	for (n = 0; n < descs_used; n++) {
-		u16 flags = VRING_DESC_F_NEXT;
+	if (indir) {
+		struct virtio_sg table = {
+			.addr = indir,
+			.length = (out_sgs + in_sgs) * sizeof(*indir),
+		};
 
-		if (n >= out_sgs)
-			flags |= VRING_DESC_F_WRITE;
 		prev = i;
-		i = virtqueue_attach_desc(vq, i, sgs[n], flags);
+		i = virtqueue_attach_desc(vq, i, &table,
+					  VRING_DESC_F_INDIRECT);
+		vq->vring_desc_shadow[head].data = sgs[0]->addr;
+	} else {
+		for (n = 0; n < descs_used; n++) {
+			u16 flags = VRING_DESC_F_NEXT;
+
+			if (n >= out_sgs)
+				flags |= VRING_DESC_F_WRITE;
+			prev = i;
+			i = virtqueue_attach_desc(vq, i, sgs[n], flags);
+		}
+		/* Last one doesn't continue */
+		vq->vring_desc_shadow[prev].flags &= ~VRING_DESC_F_NEXT;
+		desc[prev].flags = cpu_to_virtio16(vq->vdev,
+						   vq->vring_desc_shadow[prev].flags);
+		vq->vring_desc_shadow[head].data =
+			(void *)(uintptr_t)vq->vring_desc_shadow[head].addr;
 	}
-	/* Last one doesn't continue */
-	vq->vring_desc_shadow[prev].flags &= ~VRING_DESC_F_NEXT;
-	desc[prev].flags = cpu_to_virtio16(vq->vdev, vq->vring_desc_shadow[prev].flags);
+	vq->vring_desc_shadow[head].indir = indir;
 
 	/* We're using some buffers from the free list. */
 	vq->num_free -= descs_used;
@@ -200,6 +264,9 @@ static bool virtqueue_kick_prepare(struct virtqueue *vq)
 
 void virtqueue_kick(struct virtqueue *vq)
 {
+	if (!vq->num_added)
+		return;
+
 	if (virtqueue_kick_prepare(vq))
 		virtio_notify(vq->vdev, vq);
 }
@@ -210,6 +277,8 @@ static void detach_buf(struct virtqueue *vq, unsigned int head)
 
 	/* Unmark the descriptor as the head of a chain. */
 	vq->vring_desc_shadow[head].chain_head = false;
+	free(vq->vring_desc_shadow[head].indir);
+	vq->vring_desc_shadow[head].indir = NULL;
 
 	/* Put back on free list: unmap first-level descriptors and find end */
 	i = head;
@@ -280,7 +349,7 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
-	return (void *)(uintptr_t)vq->vring_desc_shadow[i].addr;
+	return vq->vring_desc_shadow[i].data;
 }
 
 static struct virtqueue *__vring_new_virtqueue(unsigned int index,
@@ -315,6 +384,7 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	list_add_tail(&vq->list, &uc_priv->vqs);
 
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC);
 
 	/* Tell other side not to bother us */
 	vq->avail_flags_shadow |= VRING_AVAIL_F_NO_INTERRUPT;
@@ -394,6 +464,10 @@ err_free_queue:
 
 void vring_del_virtqueue(struct virtqueue *vq)
 {
+	unsigned int i;
+
+	for (i = 0; i < vq->vring.num; i++)
+		free(vq->vring_desc_shadow[i].indir);
 	virtio_free_pages(vq->vdev, vq->vring.desc,
 			  DIV_ROUND_UP(vq->vring.size, PAGE_SIZE));
 	free(vq->vring_desc_shadow);
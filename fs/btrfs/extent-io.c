@@ -18,7 +18,9 @@ void extent_io_tree_init(struct extent_io_tree *tree)
 {
 	cache_tree_init(&tree->state);
 	cache_tree_init(&tree->cache);
+	INIT_LIST_HEAD(&tree->lru);
 	tree->cache_size = 0;
+	tree->max_cache_size = CONFIG_BTRFS_EXTENT_BUFFER_CACHE_SIZE;
 }
 
 static struct extent_state *alloc_extent_state(void)
@@ -54,6 +56,17 @@ static void free_extent_state_func(struct cache_extent *cache)
 static void free_extent_buffer_final(struct extent_buffer *eb);
 void extent_io_tree_cleanup(struct extent_io_tree *tree)
 {
+	struct extent_buffer *eb;
+
+	while (!list_empty(&tree->lru)) {
+		eb = list_first_entry(&tree->lru, struct extent_buffer, lru);
+		if (eb->refs) {
+			debug("extent buffer leak: start %llu len %u\n",
+			      eb->start, eb->len);
+			eb->refs = 0;
+		}
+		free_extent_buffer_final(eb);
+	}
 	cache_tree_free_extents(&tree->state, free_extent_state_func);
 }
 
@@ -575,6 +588,7 @@ static struct extent_buffer *__alloc_extent_buffer(struct btrfs_fs_info *info,
 		return NULL;
 	}
 
+	INIT_LIST_HEAD(&eb->lru);
 	eb->start = bytenr;
 	eb->len = blocksize;
 	eb->refs = 1;
@@ -608,6 +622,7 @@ static void free_extent_buffer_final(struct extent_buffer *eb)
 		struct extent_io_tree *tree = &eb->fs_info->extent_cache;
 
 		remove_cache_extent(&tree->cache, &eb->cache_node);
+		list_del_init(&eb->lru);
 		BUG_ON(tree->cache_size < eb->len);
 		tree->cache_size -= eb->len;
 	}
@@ -633,7 +648,16 @@ static void free_extent_buffer_internal(struct extent_buffer *eb, bool free_now)
 	}
 }
 
+/*
+ * Unused tree blocks stay in the cache, so that the next path search does not
+ * have to read them again, until trim_extent_buffer_cache() evicts them.
+ */
 void free_extent_buffer(struct extent_buffer *eb)
+{
+	free_extent_buffer_internal(eb, 0);
+}
+
+void free_extent_buffer_nocache(struct extent_buffer *eb)
 {
 	free_extent_buffer_internal(eb, 1);
 }
@@ -648,6 +672,7 @@ struct extent_buffer *find_extent_buffer(struct extent_io_tree *tree,
 	if (cache && cache->start == bytenr &&
 	    cache->size == blocksize) {
 		eb = container_of(cache, struct extent_buffer, cache_node);
+		list_move_tail(&eb->lru, &tree->lru);
 		eb->refs++;
 	}
 	return eb;
@@ -667,6 +692,19 @@ struct extent_buffer *find_first_extent_buffer(struct extent_io_tree *tree,
 	return eb;
 }
 
+/* Free the least recently used tree blocks which are not in use */
+static void trim_extent_buffer_cache(struct extent_io_tree *tree)
+{
+	struct extent_buffer *eb, *tmp;
+
+	list_for_each_entry_safe(eb, tmp, &tree->lru, lru) {
+		if (eb->refs == 0)
+			free_extent_buffer_final(eb);
+		if (tree->cache_size <= tree->max_cache_size * 9 / 10)
+			break;
+	}
+}
+
 struct extent_buffer *alloc_extent_buffer(struct btrfs_fs_info *fs_info,
 					  u64 bytenr, u32 blocksize)
 {
@@ -678,6 +716,7 @@ struct extent_buffer *alloc_extent_buffer(struct btrfs_fs_info *fs_info,
 	if (cache && cache->start == bytenr &&
 	    cache->size == blocksize) {
 		eb = container_of(cache, struct extent_buffer, cache_node);
+		list_move_tail(&eb->lru, &tree->lru);
 		eb->refs++;
 	} else {
 		int ret;
@@ -685,17 +724,25 @@ struct extent_buffer *alloc_extent_buffer(struct btrfs_fs_info *fs_info,
 		if (cache) {
 			eb = container_of(cache, struct extent_buffer,
 					  cache_node);
-			free_extent_buffer(eb);
+			/* an unused overlapping block is just dropped */
+			if (eb->refs)
+				free_extent_buffer(eb);
+			else
+				free_extent_buffer_final(eb);
 		}
 		eb = __alloc_extent_buffer(fs_info, bytenr, blocksize);
 		if (!eb)
 			return NULL;
 		ret = insert_cache_extent(&tree->cache, &eb->cache_node);
 		if (ret) {
+			free(eb->data);
 			free(eb);
 			return NULL;
 		}
+		list_add_tail(&eb->lru, &tree->lru);
 		tree->cache_size += blocksize;
+		if (tree->cache_size >= tree->max_cache_size)
+			trim_extent_buffer_cache(tree);
 	}
 	return eb;
 }
@@ -644,7 +644,9 @@ static int read_and_truncate_page(struct btrfs_path *path,
 			free(buf);
 			return ret;
 		}
-		memcpy(dest, buf + page_off, min3(page_len, ret, len));
+		ret = clamp(ret - page_off, 0, min(page_len, len));
+		memcpy(dest, buf + page_off, ret);
+		memset(dest + ret, 0, len - ret);
 		free(buf);
 		return len;
 	}
@@ -661,6 +663,21 @@ static int read_and_truncate_page(struct btrfs_path *path,
 	return len;
 }
 
+/* Zero the part of @dest for file range [@start, @end) */
+static void zero_file_range(char *dest, u64 file_offset, u64 len, u64 start,
+			    u64 end)
+{
+	start = max(start, file_offset);
+	end = min(end, file_offset + len);
+	if (start < end)
+		memset(dest + start - file_offset, 0, end - start);
+}
+
+/*
+ * Data extents are read straight into @dest. Only holes are zeroed, rather
+ * than clearing the whole of @dest first, and only the unaligned head and
+ * tail go through a bounce buffer.
+ */
 int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 		    char *dest)
 {
@@ -676,9 +693,6 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 
 	btrfs_init_path(&path);
 
-	/* Set the whole dest all zero, so we won't need to bother holes */
-	memset(dest, 0, len);
-
 	/* Read out the leading unaligned part */
 	if (aligned_start != file_offset) {
 		ret = lookup_data_extent(root, &path, ino, aligned_start,
@@ -690,8 +704,9 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 			fi = btrfs_item_ptr(path.nodes[0], path.slots[0],
 					struct btrfs_file_extent_item);
 			ret = read_and_truncate_page(&path, fi, file_offset,
-					round_up(file_offset, fs_info->sectorsize) -
-					file_offset, dest);
+					min(len, aligned_start +
+					    fs_info->sectorsize - file_offset),
+					dest);
 			if (ret < 0)
 				goto out;
 			cur += fs_info->sectorsize;
@@ -701,8 +716,15 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 				memset(dest, 0, len);
 				return len;
 			}
+			zero_file_range(dest, file_offset, len, file_offset,
+					next_offset);
 			cur = next_offset;
 		}
+		/* The read ends in the same sector */
+		if (cur > aligned_end) {
+			ret = 0;
+			goto out;
+		}
 	}
 
 	/* Read the aligned part */
@@ -717,6 +739,8 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 		if (ret > 0) {
 			/* No next, direct exit */
 			if (!next_offset) {
+				zero_file_range(dest, file_offset, len, cur,
+						file_offset + len);
 				ret = 0;
 				goto out;
 			}
@@ -725,6 +749,8 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 			 * Just to next offset directly.
 			 */
 			if (next_offset > cur) {
+				zero_file_range(dest, file_offset, len, cur,
+						next_offset);
 				cur = next_offset;
 				continue;
 			}
@@ -735,19 +761,25 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 		type = btrfs_file_extent_type(path.nodes[0], fi);
 		if (type == BTRFS_FILE_EXTENT_INLINE) {
 			ret = btrfs_read_extent_inline(&path, fi, dest);
+			if (ret >= 0)
+				zero_file_range(dest, file_offset, len,
+						cur + ret, file_offset + len);
 			goto out;
 		}
-		/* Skip holes, as we have zeroed the dest */
+		/* Zero holes, without reading them */
 		if (type == BTRFS_FILE_EXTENT_PREALLOC ||
 		    btrfs_file_extent_disk_bytenr(path.nodes[0], fi) == 0) {
-			cur = key.offset + btrfs_file_extent_num_bytes(
+			next_offset = key.offset + btrfs_file_extent_num_bytes(
 					path.nodes[0], fi);
+			zero_file_range(dest, file_offset, len, cur,
+					next_offset);
+			cur = next_offset;
 			continue;
 		}
 
 		/* Read the remaining part of the extent */
-		extent_num_bytes = btrfs_file_extent_num_bytes(path.nodes[0],
-							       fi);
+		extent_num_bytes = key.offset +
+			btrfs_file_extent_num_bytes(path.nodes[0], fi) - cur;
 		ret = btrfs_read_extent_reg(&path, fi, cur,
 				min(extent_num_bytes, aligned_end - cur),
 				dest + cur - file_offset);
@@ -757,11 +789,14 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 	}
 
 	/* Read the tailing unaligned part*/
-	if (file_offset + len != aligned_end) {
+	if (file_offset + len != aligned_end && cur <= aligned_end) {
 		btrfs_release_path(&path);
 		ret = lookup_data_extent(root, &path, ino, aligned_end,
 					 &next_offset);
 		/* <0 is error, >0 means no extent */
+		if (ret > 0)
+			zero_file_range(dest, file_offset, len, aligned_end,
+					file_offset + len);
 		if (ret)
 			goto out;
 		fi = btrfs_item_ptr(path.nodes[0], path.slots[0],
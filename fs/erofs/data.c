@@ -1,6 +1,42 @@
 // SPDX-License-Identifier: GPL-2.0+
 #include "internal.h"
 #include "decompress.h"
+#include <linux/list.h>
+#include <linux/sizes.h>
+
+/* max number of extents mapped before their compressed data is read */
+#define Z_EROFS_BATCH_EXTENTS	16
+/* max compressed bytes read at once, unless a single pcluster is larger */
+#define Z_EROFS_BATCH_SIZE	SZ_1M
+
+/*
+ * an extent whose compressed data is still to be read and decompressed,
+ * see z_erofs_read_data()
+ */
+struct z_erofs_extent {
+	erofs_off_t pa, la;
+	u64 plen;
+	unsigned int flags;
+	char alg;
+
+	/* what to decompress to, as for z_erofs_read_one_data() */
+	char *out;
+	erofs_off_t skip, length;
+	bool trimmed;
+};
+
+/* a decompressed pcluster kept in z_erofs_pclusters */
+struct z_erofs_pcluster {
+	struct list_head list;
+	erofs_off_t pa, la;
+	u64 llen;
+	char alg;
+	char data[] __aligned(8);
+};
+
+/* cached pclusters, most recently used first */
+static LIST_HEAD(z_erofs_pclusters);
+static unsigned long z_erofs_pclusters_size;
 
 static int erofs_map_blocks_flatmode(struct erofs_inode *inode,
 				     struct erofs_map_blocks *map,
@@ -216,10 +252,47 @@ static int erofs_read_raw_data(struct erofs_inode *inode, char *buffer,
 	return 0;
 }
 
+static void z_erofs_extent_init(struct z_erofs_extent *ext,
+				struct erofs_map_blocks *map, char *out,
+				erofs_off_t skip, erofs_off_t length,
+				bool trimmed)
+{
+	*ext = (struct z_erofs_extent) {
+		.pa = map->m_pa,
+		.la = map->m_la,
+		.plen = map->m_plen,
+		.flags = map->m_flags,
+		.alg = map->m_algorithmformat,
+		.out = out,
+		.skip = skip,
+		.length = length,
+		.trimmed = trimmed,
+	};
+}
+
+static int z_erofs_decompress_extent(struct z_erofs_extent *ext, char *raw)
+{
+	return z_erofs_decompress(&(struct z_erofs_decompress_req) {
+			.in = raw,
+			.out = ext->out,
+			.decodedskip = ext->skip,
+			.interlaced_offset =
+				ext->alg == Z_EROFS_COMPRESSION_INTERLACED ?
+					erofs_blkoff(ext->la) : 0,
+			.inputsize = ext->plen,
+			.decodedlength = ext->length,
+			.alg = ext->alg,
+			.partial_decoding = ext->trimmed ? true :
+				!(ext->flags & EROFS_MAP_FULL_MAPPED) ||
+					(ext->flags & EROFS_MAP_PARTIAL_REF),
+			 });
+}
+
 int z_erofs_read_one_data(struct erofs_inode *inode,
 			  struct erofs_map_blocks *map, char *raw, char *buffer,
 			  erofs_off_t skip, erofs_off_t length, bool trimmed)
 {
+	struct z_erofs_extent ext;
 	struct erofs_map_dev mdev;
 	int ret = 0;
 
@@ -252,34 +325,200 @@ int z_erofs_read_one_data(struct erofs_inode *inode,
 	if (ret < 0)
 		return ret;
 
-	ret = z_erofs_decompress(&(struct z_erofs_decompress_req) {
-			.in = raw,
-			.out = buffer,
-			.decodedskip = skip,
-			.interlaced_offset =
-				map->m_algorithmformat == Z_EROFS_COMPRESSION_INTERLACED ?
-					erofs_blkoff(map->m_la) : 0,
-			.inputsize = map->m_plen,
-			.decodedlength = length,
-			.alg = map->m_algorithmformat,
-			.partial_decoding = trimmed ? true :
-				!(map->m_flags & EROFS_MAP_FULL_MAPPED) ||
-					(map->m_flags & EROFS_MAP_PARTIAL_REF),
-			 });
+	z_erofs_extent_init(&ext, map, buffer, skip, length, trimmed);
+	ret = z_erofs_decompress_extent(&ext, raw);
+	if (ret < 0)
+		return ret;
+	return 0;
+}
+
+static int z_erofs_reserve_raw(char **raw, unsigned int *bufsize,
+			       unsigned int size)
+{
+	char *p;
+
+	if (size <= *bufsize)
+		return 0;
+
+	p = realloc(*raw, size);
+	if (!p)
+		return -ENOMEM;
+	*raw = p;
+	*bufsize = size;
+	return 0;
+}
+
+static void z_erofs_pcluster_drop(struct z_erofs_pcluster *pcl)
+{
+	list_del(&pcl->list);
+	z_erofs_pclusters_size -= pcl->llen;
+	free(pcl);
+}
+
+void z_erofs_drop_pclusters(void)
+{
+	struct z_erofs_pcluster *pcl, *n;
+
+	list_for_each_entry_safe(pcl, n, &z_erofs_pclusters, list)
+		z_erofs_pcluster_drop(pcl);
+}
+
+static struct z_erofs_pcluster *
+z_erofs_pcluster_find(struct erofs_map_blocks *map, erofs_off_t length)
+{
+	struct z_erofs_pcluster *pcl;
+
+	list_for_each_entry(pcl, &z_erofs_pclusters, list) {
+		if (pcl->pa == map->m_pa && pcl->la == map->m_la &&
+		    pcl->alg == map->m_algorithmformat && pcl->llen >= length) {
+			list_move(&pcl->list, &z_erofs_pclusters);
+			return pcl;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Read part of an extent through the pcluster cache, so that the following
+ * reads of the same pcluster (e.g. the next directory block, or the tail of
+ * another file in the packed inode) don't need to read and decompress it
+ * again. The whole extent is decompressed into the cache on a miss.
+ *
+ * Returns -ENOENT if the extent is too large to be cached.
+ */
+static int z_erofs_read_cached(struct erofs_inode *inode,
+			       struct erofs_map_blocks *map, char **raw,
+			       unsigned int *bufsize, char *buffer,
+			       erofs_off_t skip, erofs_off_t length)
+{
+	struct erofs_map_blocks orig = *map;
+	struct z_erofs_pcluster *pcl, *last;
+	struct z_erofs_extent ext;
+	struct erofs_map_dev mdev;
+	int ret;
+
+	pcl = z_erofs_pcluster_find(map, length);
+	if (pcl)
+		goto out;
+
+	/* find out where the extent ends to decompress all of it */
+	ret = z_erofs_map_blocks_iter(inode, map, EROFS_GET_BLOCKS_FIEMAP);
+	if (ret)
+		return ret;
+	if (map->m_llen > CONFIG_FS_EROFS_PCLUSTER_CACHE_SIZE ||
+	    map->m_la != orig.m_la || map->m_llen < length) {
+		ret = -ENOENT;
+		goto restore;
+	}
+
+	ret = z_erofs_reserve_raw(raw, bufsize, map->m_plen);
+	if (ret)
+		goto restore;
+	mdev = (struct erofs_map_dev) {
+		.m_pa = map->m_pa,
+	};
+	ret = erofs_map_dev(&mdev);
+	if (ret)
+		goto restore;
+	ret = erofs_dev_read(mdev.m_deviceid, *raw, mdev.m_pa, map->m_plen);
 	if (ret < 0)
+		goto restore;
+
+	while (!list_empty(&z_erofs_pclusters) &&
+	       z_erofs_pclusters_size + map->m_llen >
+			CONFIG_FS_EROFS_PCLUSTER_CACHE_SIZE) {
+		last = list_last_entry(&z_erofs_pclusters,
+				       struct z_erofs_pcluster, list);
+		z_erofs_pcluster_drop(last);
+	}
+	pcl = malloc(sizeof(*pcl) + map->m_llen);
+	if (!pcl) {
+		ret = -ENOENT;
+		goto restore;
+	}
+
+	z_erofs_extent_init(&ext, map, pcl->data, 0, map->m_llen, false);
+	ret = z_erofs_decompress_extent(&ext, *raw);
+	if (ret < 0) {
+		free(pcl);
+		goto restore;
+	}
+	pcl->pa = map->m_pa;
+	pcl->la = map->m_la;
+	pcl->llen = map->m_llen;
+	pcl->alg = map->m_algorithmformat;
+	list_add(&pcl->list, &z_erofs_pclusters);
+	z_erofs_pclusters_size += pcl->llen;
+	*map = orig;
+out:
+	memcpy(buffer, pcl->data + skip, length - skip);
+	return 0;
+
+restore:
+	*map = orig;
+	return ret;
+}
+
+/*
+ * Read the compressed data of the mapped extents, merging those which are
+ * contiguous on the device into a single read, then decompress them all.
+ * Extents are mapped from the end of the range, so ext[] runs backwards.
+ */
+static int z_erofs_read_batch(struct z_erofs_extent *ext, unsigned int nr,
+			      char **raw, unsigned int *bufsize)
+{
+	struct erofs_map_dev mdev;
+	erofs_off_t start, pos;
+	unsigned int total, off;
+	int i, first, ret;
+
+	total = 0;
+	for (i = 0; i < nr; ++i)
+		total += ext[i].plen;
+	ret = z_erofs_reserve_raw(raw, bufsize, total);
+	if (ret)
 		return ret;
+
+	off = 0;
+	for (first = nr - 1; first >= 0; first = i) {
+		mdev = (struct erofs_map_dev) {
+			.m_pa = ext[first].pa,
+		};
+		ret = erofs_map_dev(&mdev);
+		if (ret)
+			return ret;
+		start = mdev.m_pa;
+		pos = ext[first].pa + ext[first].plen;
+		for (i = first - 1; i >= 0 && ext[i].pa == pos; --i)
+			pos += ext[i].plen;
+
+		ret = erofs_dev_read(mdev.m_deviceid, *raw + off, start,
+				     pos - ext[first].pa);
+		if (ret < 0)
+			return ret;
+		off += pos - ext[first].pa;
+	}
+
+	off = 0;
+	for (i = nr - 1; i >= 0; --i) {
+		ret = z_erofs_decompress_extent(&ext[i], *raw + off);
+		if (ret < 0)
+			return ret;
+		off += ext[i].plen;
+	}
 	return 0;
 }
 
 static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 			     erofs_off_t size, erofs_off_t offset)
 {
+	struct z_erofs_extent ext[Z_EROFS_BATCH_EXTENTS];
 	erofs_off_t end, length, skip;
 	struct erofs_map_blocks map = {
 		.index = UINT_MAX,
 	};
+	unsigned int bufsize = 0, nr = 0, batchsize = 0;
 	bool trimmed;
-	unsigned int bufsize = 0;
 	char *raw = NULL;
 	int ret = 0;
 
@@ -318,21 +557,42 @@ static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 			continue;
 		}
 
-		if (map.m_plen > bufsize) {
-			bufsize = map.m_plen;
-			raw = realloc(raw, bufsize);
-			if (!raw) {
-				ret = -ENOMEM;
+		if (map.m_flags & EROFS_MAP_FRAGMENT) {
+			ret = z_erofs_read_one_data(inode, &map, NULL,
+						    buffer + end - offset,
+						    skip, length, trimmed);
+			if (ret < 0)
 				break;
+			continue;
+		}
+
+		/* only part of the extent is wanted, so keep all of it */
+		if (trimmed || skip) {
+			ret = z_erofs_read_cached(inode, &map, &raw, &bufsize,
+						  buffer + end - offset, skip,
+						  length);
+			if (ret != -ENOENT) {
+				if (ret < 0)
+					break;
+				continue;
 			}
 		}
 
-		ret = z_erofs_read_one_data(inode, &map, raw,
-					    buffer + end - offset, skip, length,
-					    trimmed);
-		if (ret < 0)
-			break;
+		/* queue the extent, reading the ones before it first if full */
+		if (nr == Z_EROFS_BATCH_EXTENTS ||
+		    (nr && batchsize + map.m_plen > Z_EROFS_BATCH_SIZE)) {
+			ret = z_erofs_read_batch(ext, nr, &raw, &bufsize);
+			if (ret < 0)
+				break;
+			nr = 0;
+			batchsize = 0;
+		}
+		z_erofs_extent_init(&ext[nr++], &map, buffer + end - offset,
+				    skip, length, trimmed);
+		batchsize += map.m_plen;
 	}
+	if (ret >= 0 && nr)
+		ret = z_erofs_read_batch(ext, nr, &raw, &bufsize);
 	if (raw)
 		free(raw);
 	return ret < 0 ? ret : 0;
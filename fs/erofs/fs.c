@@ -258,6 +258,7 @@ int erofs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 
 void erofs_close(void)
 {
+	z_erofs_drop_pclusters();
 	ctxt.cur_dev = NULL;
 }
 
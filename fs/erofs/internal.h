@@ -344,6 +344,7 @@ int erofs_read_one_data(struct erofs_map_blocks *map, char *buffer, u64 offset,
 int z_erofs_read_one_data(struct erofs_inode *inode,
 			  struct erofs_map_blocks *map, char *raw, char *buffer,
 			  erofs_off_t skip, erofs_off_t length, bool trimmed);
+void z_erofs_drop_pclusters(void);
 
 static inline int erofs_get_occupied_size(const struct erofs_inode *inode,
 					  erofs_off_t *size)
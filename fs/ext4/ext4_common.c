@@ -1995,6 +1995,149 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	return blknr;
 }
 
+/* Resolved extents of the inode last read through ext4fs_get_extent_map() */
+static struct ext4_extent_map ext4fs_extent_map;
+
+static void ext4fs_free_extent_map(void)
+{
+	free(ext4fs_extent_map.runs);
+	memset(&ext4fs_extent_map, '\0', sizeof(ext4fs_extent_map));
+}
+
+static int ext4fs_extent_map_add(struct ext4_extent_map *map,
+				 const struct ext4_extent *extent)
+{
+	struct ext4_extent_run *run;
+	uint64_t start;
+	uint32_t len;
+	bool uninit;
+
+	len = le16_to_cpu(extent->ee_len);
+	uninit = len > EXT_INIT_MAX_LEN;
+	if (uninit)
+		len -= EXT_INIT_MAX_LEN;
+	if (!len)
+		return 0;
+	start = le16_to_cpu(extent->ee_start_hi);
+	start = (start << 32) + le32_to_cpu(extent->ee_start_lo);
+
+	/* merge with the previous run if nothing separates them on disk */
+	if (map->count) {
+		run = &map->runs[map->count - 1];
+		if (run->block + run->len == le32_to_cpu(extent->ee_block) &&
+		    run->start + run->len == start && run->uninit == uninit) {
+			run->len += len;
+			return 0;
+		}
+	}
+
+	if (map->count == map->alloc) {
+		uint alloc = map->alloc ? map->alloc * 2 : 16;
+
+		run = realloc(map->runs, alloc * sizeof(*run));
+		if (!run)
+			return -ENOMEM;
+		map->runs = run;
+		map->alloc = alloc;
+	}
+	run = &map->runs[map->count++];
+	run->block = le32_to_cpu(extent->ee_block);
+	run->len = len;
+	run->start = start;
+	run->uninit = uninit;
+
+	return 0;
+}
+
+static int ext4fs_extent_map_walk(struct ext4_extent_map *map,
+				  struct ext4_extent_header *ext_block,
+				  int depth)
+{
+	struct ext4_extent_idx *index;
+	int blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	int log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+			 get_fs()->dev_desc->log2blksz;
+	unsigned long long block;
+	char *buf;
+	int i, ret;
+
+	if (le16_to_cpu(ext_block->eh_magic) != EXT4_EXT_MAGIC ||
+	    le16_to_cpu(ext_block->eh_entries) >
+	    le16_to_cpu(ext_block->eh_max) ||
+	    le16_to_cpu(ext_block->eh_depth) != depth ||
+	    depth > EXT4_EXT_MAX_DEPTH)
+		return -EINVAL;
+
+	if (!depth) {
+		struct ext4_extent *extent;
+
+		extent = (struct ext4_extent *)(ext_block + 1);
+		for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
+			ret = ext4fs_extent_map_add(map, &extent[i]);
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+
+	buf = memalign(ARCH_DMA_MINALIGN, blksz);
+	if (!buf)
+		return -ENOMEM;
+	index = (struct ext4_extent_idx *)(ext_block + 1);
+	for (i = 0, ret = 0; !ret && i < le16_to_cpu(ext_block->eh_entries);
+	     i++) {
+		block = le16_to_cpu(index[i].ei_leaf_hi);
+		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
+		if (!ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
+				    buf))
+			ret = -EIO;
+		else
+			ret = ext4fs_extent_map_walk(map,
+					(struct ext4_extent_header *)buf,
+					depth - 1);
+	}
+	free(buf);
+
+	return ret;
+}
+
+/**
+ * ext4fs_get_extent_map() - Get the resolved extents of an extent-mapped inode
+ *
+ * The extent tree is walked once and the result kept until another inode is
+ * mapped or ext4fs_reinit_global() is called, so that reading a file (or a
+ * directory, one entry at a time) does not go back to the tree for each block.
+ *
+ * @node:	Node to map, which must have EXT4_EXTENTS_FL set
+ * Return:	extent map, or NULL if the tree is invalid or cannot be read
+ */
+const struct ext4_extent_map *ext4fs_get_extent_map(struct ext2fs_node *node)
+{
+	struct ext4_extent_map *map = &ext4fs_extent_map;
+	struct ext4_extent_header *ext_block;
+	int ret;
+
+	if (map->valid && map->data == node->data && map->ino == node->ino &&
+	    !memcmp(&map->inode, &node->inode, sizeof(map->inode)))
+		return map;
+
+	map->valid = false;
+	map->count = 0;
+	ext_block = (struct ext4_extent_header *)node->inode.b.blocks.dir_blocks;
+	ret = ext4fs_extent_map_walk(map, ext_block,
+				     le16_to_cpu(ext_block->eh_depth));
+	if (ret) {
+		printf("invalid extent block\n");
+		return NULL;
+	}
+	map->data = node->data;
+	map->ino = node->ino;
+	map->inode = node->inode;
+	map->valid = true;
+
+	return map;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -2009,6 +2152,7 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
  */
 void ext4fs_reinit_global(void)
 {
+	ext4fs_free_extent_map();
 	if (ext4fs_indir1_block != NULL) {
 		free(ext4fs_indir1_block);
 		ext4fs_indir1_block = NULL;
@@ -28,6 +28,7 @@
 #include <malloc.h>
 #include <part.h>
 #include <rtc.h>
+#include <linux/sizes.h>
 #include <u-boot/uuid.h>
 #include "ext4_common.h"
 
@@ -63,6 +64,72 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/* Largest read passed to ext4fs_devread(), which takes an int length */
+#define EXT4_MAX_DEVREAD	SZ_1G
+
+/*
+ * Read part of an extent-mapped file, with one device read for each
+ * physically contiguous run of blocks. The runs come from the extent map, so
+ * the tree is only walked once however many blocks are read.
+ */
+static int ext4fs_read_extents(struct ext2fs_node *node, loff_t pos,
+			       loff_t len, char *buf)
+{
+	const struct ext4_extent_map *map;
+	const struct ext4_extent_run *run;
+	int log2blksz = get_fs()->dev_desc->log2blksz;
+	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data);
+	loff_t end = pos + len;
+	loff_t run_pos, run_end, n, off;
+	uint lo, hi, mid;
+
+	map = ext4fs_get_extent_map(node);
+	if (!map)
+		return -1;
+
+	/* find the first run which ends after @pos */
+	lo = 0;
+	hi = map->count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		run = &map->runs[mid];
+		if (((loff_t)run->block + run->len) << log2_fs_blocksize > pos)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	for (; pos < end; pos += n, buf += n) {
+		run = lo < map->count ? &map->runs[lo] : NULL;
+		run_pos = run ? (loff_t)run->block << log2_fs_blocksize : end;
+
+		/* sparse file */
+		if (pos < run_pos) {
+			n = min(run_pos, end) - pos;
+			memset(buf, '\0', n);
+			continue;
+		}
+
+		run_end = ((loff_t)run->block + run->len) << log2_fs_blocksize;
+		n = min(min(run_end, end) - pos, (loff_t)EXT4_MAX_DEVREAD);
+		if (run->uninit) {
+			memset(buf, '\0', n);
+		} else {
+			off = pos - run_pos;
+			if (!ext4fs_devread((run->start <<
+					     (log2_fs_blocksize - log2blksz)) +
+					    (off >> log2blksz),
+					    off & ((1 << log2blksz) - 1), n,
+					    buf))
+				return -1;
+		}
+		if (pos + n == run_end)
+			lo++;
+	}
+
+	return 0;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
@@ -99,6 +166,14 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		return -1;
 	}
 
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		ext_cache_fini(&cache);
+		if (ext4fs_read_extents(node, pos, len, buf))
+			return -1;
+		*actread = len;
+		return 0;
+	}
+
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
 	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
@@ -376,6 +451,74 @@ int ext4fs_read(char *buf, loff_t offset, loff_t len, loff_t *actread)
 	return ext4fs_read_file(ext4fs_file, offset, len, buf, actread);
 }
 
+int ext4fs_extents(const char *filename, fs_extent_fn fn, void *priv)
+{
+	const struct ext4_extent_map *map;
+	const struct ext4_extent_run *run;
+	struct ext2fs_node *node;
+	struct ext_block_cache cache;
+	lbaint_t i, nblocks, first = 0, count = 0;
+	long start = 0, blknr;
+	int log2_fs_blocksize;
+	loff_t size;
+	int ret = 0;
+
+	if (ext4fs_open(filename, &size) < 0)
+		return -ENOENT;
+
+	node = ext4fs_file;
+	log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data);
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		map = ext4fs_get_extent_map(node);
+		if (!map)
+			return -EIO;
+
+		for (run = map->runs; run < map->runs + map->count; run++) {
+			/* unwritten blocks read as zeroes */
+			if (run->uninit)
+				continue;
+			ret = fn(priv, (loff_t)run->block << log2_fs_blocksize,
+				 run->start << log2_fs_blocksize,
+				 (u64)run->len << log2_fs_blocksize);
+			if (ret)
+				return ret;
+		}
+
+		return 0;
+	}
+
+	/* merge physically consecutive blocks into one extent */
+	ext_cache_init(&cache);
+	nblocks = lldiv(size + (1 << log2_fs_blocksize) - 1,
+			1 << log2_fs_blocksize);
+	for (i = 0; i <= nblocks; i++) {
+		blknr = i < nblocks ?
+			read_allocated_block(&node->inode, i, &cache) : 0;
+		if (blknr < 0) {
+			ret = -EIO;
+			break;
+		}
+		if (count && blknr == start + count) {
+			count++;
+			continue;
+		}
+		if (count) {
+			ret = fn(priv, (loff_t)first << log2_fs_blocksize,
+				 (u64)start << log2_fs_blocksize,
+				 (u64)count << log2_fs_blocksize);
+			if (ret)
+				break;
+		}
+		/* block 0 is a hole */
+		first = i;
+		start = blknr;
+		count = blknr ? 1 : 0;
+	}
+	ext_cache_fini(&cache);
+
+	return ret;
+}
+
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 struct disk_partition *fs_partition)
 {
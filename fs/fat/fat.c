@@ -12,6 +12,7 @@
 
 #include <blk.h>
 #include <config.h>
+#include <div64.h>
 #include <exports.h>
 #include <fat.h>
 #include <fs.h>
@@ -25,7 +26,9 @@
 #include <asm/cache.h>
 #include <linux/compiler.h>
 #include <linux/ctype.h>
+#include <linux/list.h>
 #include <linux/log2.h>
+#include <linux/sizes.h>
 
 /* maximum number of clusters for FAT12 */
 #define MAX_FAT12	0xFF4
@@ -151,15 +154,35 @@ static void get_name(dir_entry *dirent, char *s_name)
 		*s_name = DELETED_FLAG;
 }
 
-static int flush_dirty_fat_buffer(fsdata *mydata);
+static int read_fat_buffer(fsdata *mydata, __u32 bufnum);
+static void fat_space_invalidate(void);
 
 #if !CONFIG_IS_ENABLED(FAT_WRITE)
-/* Stub for read only operation */
-int flush_dirty_fat_buffer(fsdata *mydata)
+/*
+ * Read block 'bufnum' of FAT entries into fatbuf
+ */
+static int read_fat_buffer(fsdata *mydata, __u32 bufnum)
 {
-	(void)(mydata);
+	__u32 getsize = FATBUFBLOCKS;
+	__u32 startblock = bufnum * FATBUFBLOCKS;
+
+	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+	if (startblock + getsize > mydata->fatlength)
+		getsize = mydata->fatlength - startblock;
+
+	startblock += mydata->fat_sect;	/* Offset from start of disk */
+
+	if (disk_read(startblock, getsize, mydata->fatbuf) < 0)
+		return -1;
+	mydata->fatbufnum = bufnum;
+
 	return 0;
 }
+
+/* Stub for read only operation */
+static void fat_space_invalidate(void)
+{
+}
 #endif
 
 /*
@@ -200,27 +223,10 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	       mydata->fatsize, entry, entry, offset, offset);
 
 	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
-
-		/* Write back the fatbuf to the disk */
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
-		}
-		mydata->fatbufnum = bufnum;
+	if (bufnum != mydata->fatbufnum &&
+	    read_fat_buffer(mydata, bufnum) < 0) {
+		debug("Error reading FAT blocks\n");
+		return ret;
 	}
 
 	/* Get the actual entry from the table */
@@ -246,6 +252,298 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	return ret;
 }
 
+/* Number of cluster chains held by the chain cache */
+#define FAT_CHAIN_CACHE_SIZE	4
+
+/* Size of the window into the FAT used when decoding chains */
+#define FAT_CHAIN_BUFSIZE	SZ_32K
+
+/**
+ * struct fat_run - consecutive clusters in a cluster chain
+ *
+ * @start:	First cluster of the run
+ * @len:	Number of clusters in the run
+ */
+struct fat_run {
+	__u32 start;
+	__u32 len;
+};
+
+/**
+ * struct fat_chain - decoded cluster chain of a file or directory
+ *
+ * Chains are decoded from the FAT on demand, so that reading the start of a
+ * large file does not walk the whole of its chain.
+ *
+ * @sibling:	Entry in fat_chains, most recently used first
+ * @mydata:	Filesystem the chain was decoded through. The write code uses
+ *		several copies of fsdata, each with its own FAT buffer, so a
+ *		chain is only used with the copy which decoded it.
+ * @first:	First cluster of the chain
+ * @count:	Number of clusters decoded so far
+ * @end:	FAT entry ending the chain (end-of-chain marker or bad value)
+ *		once it has been reached, else 0
+ * @nruns:	Number of runs in @runs
+ * @alloc:	Number of runs allocated in @runs
+ * @hint:	Index of the run last looked up by fat_chain_next()
+ * @runs:	Runs of consecutive clusters, in chain order
+ */
+struct fat_chain {
+	struct list_head sibling;
+	fsdata *mydata;
+	__u32 first;
+	__u32 count;
+	__u32 end;
+	__u32 nruns;
+	__u32 alloc;
+	__u32 hint;
+	struct fat_run *runs;
+};
+
+static LIST_HEAD(fat_chains);
+static int fat_chain_entries;
+
+/*
+ * Window into the FAT, much larger than fatbuf, so that decoding a long chain
+ * only reads each part of the FAT once. It is not used while fatbuf holds
+ * changes which are not yet on disk.
+ */
+static __u8 *fat_chain_buf;
+static __u32 fat_chain_buf_start;
+static __u32 fat_chain_buf_len;
+
+static void fat_chain_drop(struct fat_chain *chain)
+{
+	list_del(&chain->sibling);
+	free(chain->runs);
+	free(chain);
+	fat_chain_entries--;
+}
+
+/*
+ * Forget decoded chains other than those decoded through 'keep', which may be
+ * NULL, and the FAT window.
+ */
+static void fat_chain_drop_others(fsdata *keep)
+{
+	struct fat_chain *chain, *n;
+
+	list_for_each_entry_safe(chain, n, &fat_chains, sibling) {
+		if (chain->mydata != keep)
+			fat_chain_drop(chain);
+	}
+	free(fat_chain_buf);
+	fat_chain_buf = NULL;
+	fat_chain_buf_len = 0;
+}
+
+/*
+ * Forget all decoded chains. This must be called whenever the FAT is changed
+ * or another filesystem is accessed.
+ */
+static void fat_chain_invalidate(void)
+{
+	fat_chain_drop_others(NULL);
+}
+
+/*
+ * Get the chain starting at cluster 'first', adding an empty one if it has
+ * not been seen yet. Return NULL if no memory is available.
+ */
+static struct fat_chain *fat_chain_get(fsdata *mydata, __u32 first)
+{
+	struct fat_chain *chain;
+
+	list_for_each_entry(chain, &fat_chains, sibling) {
+		if (chain->mydata == mydata && chain->first == first) {
+			list_move(&chain->sibling, &fat_chains);
+			return chain;
+		}
+	}
+
+	if (fat_chain_entries == FAT_CHAIN_CACHE_SIZE)
+		fat_chain_drop(list_last_entry(&fat_chains, struct fat_chain,
+					       sibling));
+
+	chain = calloc(1, sizeof(*chain));
+	if (!chain) {
+		debug("Error: allocating cluster chain\n");
+		return NULL;
+	}
+	chain->mydata = mydata;
+	chain->first = first;
+	list_add(&chain->sibling, &fat_chains);
+	fat_chain_entries++;
+
+	return chain;
+}
+
+/*
+ * Get the entry at index 'entry' in the FAT, reading it through the chain
+ * window. Fall back to get_fatent() when fatbuf is dirty or no memory is
+ * available.
+ */
+static __u32 fat_chain_fatent(fsdata *mydata, __u32 entry)
+{
+	__u32 offset, startblock, getsize;
+	__u32 ret;
+
+	if (mydata->fat_dirty || CHECK_CLUST(entry, mydata->fatsize))
+		return get_fatent(mydata, entry);
+
+	offset = mydata->fatsize == 12 ? entry * 3 / 2 :
+		 entry * (mydata->fatsize / 8);
+	if (!fat_chain_buf_len ||
+	    offset < fat_chain_buf_start * mydata->sect_size ||
+	    offset + mydata->fatsize / 8 + 1 >
+	    (fat_chain_buf_start * mydata->sect_size) + fat_chain_buf_len) {
+		startblock = offset / mydata->sect_size;
+		getsize = FAT_CHAIN_BUFSIZE / mydata->sect_size;
+		if (startblock >= mydata->fatlength)
+			return get_fatent(mydata, entry);
+		/* Cap length if the window goes past the end of the FAT */
+		if (startblock + getsize > mydata->fatlength)
+			getsize = mydata->fatlength - startblock;
+
+		if (!fat_chain_buf) {
+			fat_chain_buf = malloc_cache_aligned(FAT_CHAIN_BUFSIZE);
+			if (!fat_chain_buf)
+				return get_fatent(mydata, entry);
+		}
+		fat_chain_buf_len = 0;
+		if (disk_read(mydata->fat_sect + startblock, getsize,
+			      fat_chain_buf) < 0) {
+			debug("Error reading FAT blocks\n");
+			return 0;
+		}
+		fat_chain_buf_start = startblock;
+		fat_chain_buf_len = getsize * mydata->sect_size;
+	}
+	offset -= fat_chain_buf_start * mydata->sect_size;
+
+	switch (mydata->fatsize) {
+	case 32:
+		ret = get_unaligned_le32(fat_chain_buf + offset);
+		break;
+	case 16:
+		ret = get_unaligned_le16(fat_chain_buf + offset);
+		break;
+	default:
+		ret = get_unaligned_le16(fat_chain_buf + offset);
+		if (entry & 0x1)
+			ret >>= 4;
+		ret &= 0xfff;
+	}
+
+	return ret;
+}
+
+/*
+ * Decode the chain until it holds at least 'count' clusters or its end is
+ * reached. Return 0 if 'count' clusters are available, -1 otherwise.
+ */
+static int fat_chain_extend(fsdata *mydata, struct fat_chain *chain,
+			    __u32 count)
+{
+	__u32 maxclust = (mydata->total_sect - mydata->data_begin) /
+			 mydata->clust_size;
+	struct fat_run *run = NULL;
+	__u32 clust;
+
+	while (chain->count < count) {
+		if (chain->end)
+			return -1;
+		if (chain->count > maxclust) {
+			/* there are more clusters than the filesystem holds */
+			debug("Loop in cluster chain at %#x\n", chain->first);
+			chain->end = ~0;
+			return -1;
+		}
+
+		if (chain->nruns) {
+			run = &chain->runs[chain->nruns - 1];
+			clust = fat_chain_fatent(mydata,
+						 run->start + run->len - 1);
+		} else {
+			clust = chain->first;
+		}
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			chain->end = clust ? clust : ~0;
+			return -1;
+		}
+
+		if (run && run->start + run->len == clust) {
+			run->len++;
+		} else {
+			if (chain->nruns == chain->alloc) {
+				__u32 alloc = chain->alloc ? chain->alloc * 2 :
+					      16;
+
+				run = realloc(chain->runs,
+					      alloc * sizeof(*run));
+				if (!run) {
+					debug("Error: allocating runs\n");
+					return -1;
+				}
+				chain->runs = run;
+				chain->alloc = alloc;
+			}
+			run = &chain->runs[chain->nruns++];
+			run->start = clust;
+			run->len = 1;
+		}
+		chain->count++;
+	}
+
+	return 0;
+}
+
+/*
+ * Get the cluster following 'clust' in the chain starting at 'first'. The
+ * return value is the same as get_fatent(mydata, clust), but the FAT is only
+ * read the first time the chain is walked.
+ */
+static __u32 fat_chain_next(fsdata *mydata, __u32 first, __u32 clust)
+{
+	struct fat_chain *chain = fat_chain_get(mydata, first);
+	struct fat_run *run = NULL;
+	__u32 i, idx = 0;
+
+	if (!chain || fat_chain_extend(mydata, chain, 1))
+		return get_fatent(mydata, clust);
+
+	/* callers step through the chain, so start from the last run used */
+	for (i = 0; i < chain->nruns; i++) {
+		idx = (chain->hint + i) % chain->nruns;
+		run = &chain->runs[idx];
+		if (clust >= run->start && clust - run->start < run->len)
+			break;
+	}
+	if (i == chain->nruns) {
+		/* not decoded yet, e.g. after the FAT was changed */
+		do {
+			if (fat_chain_extend(mydata, chain, chain->count + 1))
+				return get_fatent(mydata, clust);
+			idx = chain->nruns - 1;
+			run = &chain->runs[idx];
+		} while (clust != run->start + run->len - 1);
+	}
+	chain->hint = idx;
+
+	if (clust + 1 < run->start + run->len)
+		return clust + 1;
+	if (idx + 1 == chain->nruns) {
+		/* 'clust' is the last cluster decoded so far */
+		if (fat_chain_extend(mydata, chain, chain->count + 1))
+			return chain->end;
+		run = &chain->runs[idx];
+		if (clust + 1 < run->start + run->len)
+			return clust + 1;
+	}
+
+	return chain->runs[idx + 1].start;
+}
+
 /*
  * Read at most 'size' bytes from the specified cluster into 'buffer'.
  * Return 0 on success, -1 otherwise.
@@ -329,8 +627,9 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_chain *chain;
+	struct fat_run *run;
+	__u32 skip;
 	loff_t actsize;
 
 	*gotsize = 0;
@@ -346,21 +645,24 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
+	/* decode the chain as far as the read goes */
+	chain = fat_chain_get(mydata, START(dentptr));
+	if (!chain)
+		return -1;
+	if (fat_chain_extend(mydata, chain,
+			     lldiv(filesize + bytesperclust - 1,
+				   bytesperclust))) {
+		debug("curclust: 0x%x\n", chain->end);
+		printf("Invalid FAT entry\n");
+		return -1;
+	}
 
 	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize += bytesperclust;
-	}
+	skip = lldiv(pos, bytesperclust);
+	actsize = (loff_t)skip * bytesperclust;
+	for (run = chain->runs; skip >= run->len; run++)
+		skip -= run->len;
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
 	filesize -= actsize;
 	pos -= actsize;
 
@@ -375,7 +677,8 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 			return -1;
 		}
 
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
+		if (get_cluster(mydata, run->start + skip, tmp_buffer,
+				actsize) != 0) {
 			printf("Error reading cluster\n");
 			free(tmp_buffer);
 			return -1;
@@ -385,62 +688,29 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 		memcpy(buffer, tmp_buffer + pos, actsize);
 		free(tmp_buffer);
 		*gotsize += actsize;
-		if (!filesize)
-			return 0;
 		buffer += actsize;
 
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
+		if (++skip == run->len) {
+			run++;
+			skip = 0;
 		}
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
-				return -1;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
-
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+	/* one read for each run of consecutive clusters */
+	for (; filesize; run++, skip = 0) {
+		actsize = min(filesize, (loff_t)(run->len - skip) *
+			      bytesperclust);
+		if (get_cluster(mydata, run->start + skip, buffer,
+				actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -684,6 +954,8 @@ static int get_fs_info(fsdata *mydata)
 		mydata->root_cluster = 0;
 	}
 
+	fat_chain_invalidate();
+	fat_space_invalidate();
 	mydata->fatbufnum = -1;
 	mydata->fat_dirty = 0;
 	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
@@ -923,7 +1195,8 @@ void *fat_next_cluster(fat_itr *itr, unsigned int *nbytes)
 			itr->last_cluster = 1;
 		}
 	} else {
-		itr->next_clust = get_fatent(itr->fsdata, itr->next_clust);
+		itr->next_clust = fat_chain_next(itr->fsdata, itr->start_clust,
+						 itr->next_clust);
 		if (CHECK_CLUST(itr->next_clust, itr->fsdata->fatsize)) {
 			debug("nextclust: 0x%x\n", itr->next_clust);
 			itr->last_cluster = 1;
@@ -1335,6 +1608,60 @@ out_free_itr:
 	return ret;
 }
 
+int fat_extents(const char *filename, fs_extent_fn fn, void *priv)
+{
+	fsdata fsdata, *mydata = &fsdata;
+	unsigned int bytesperclust;
+	struct fat_chain *chain;
+	struct fat_run *run;
+	loff_t size, offset;
+	u64 len;
+	fat_itr *itr;
+	int ret;
+
+	itr = malloc_cache_aligned(sizeof(fat_itr));
+	if (!itr)
+		return -ENOMEM;
+	ret = fat_itr_root(itr, &fsdata);
+	if (ret)
+		goto out_free_itr;
+
+	ret = fat_itr_resolve(itr, filename, TYPE_FILE);
+	if (ret)
+		goto out_free_both;
+
+	size = FAT2CPU32(itr->dent->size);
+	if (!size)
+		goto out_free_both;
+
+	bytesperclust = mydata->clust_size * mydata->sect_size;
+	chain = fat_chain_get(mydata, START(itr->dent));
+	if (!chain || fat_chain_extend(mydata, chain,
+				       lldiv(size + bytesperclust - 1,
+					     bytesperclust))) {
+		ret = -EIO;
+		goto out_free_both;
+	}
+
+	/* one extent for each run of consecutive clusters */
+	for (offset = 0, run = chain->runs; offset < size; run++) {
+		len = min((u64)run->len * bytesperclust,
+			  (u64)roundup(size - offset, bytesperclust));
+		ret = fn(priv, offset,
+			 (u64)clust_to_sect(mydata, run->start) *
+			 mydata->sect_size, len);
+		if (ret)
+			break;
+		offset += len;
+	}
+
+out_free_both:
+	free(fsdata.fatbuf);
+out_free_itr:
+	free(itr);
+	return ret;
+}
+
 int file_fat_read(const char *filename, void *buffer, int maxsize)
 {
 	loff_t actread;
@@ -1422,6 +1749,8 @@ void fat_closedir(struct fs_dir_stream *dirs)
 
 void fat_close(void)
 {
+	fat_chain_invalidate();
+	fat_space_invalidate();
 }
 
 int fat_uuid(char *uuid_str)
@@ -18,8 +18,10 @@
 #include <asm/byteorder.h>
 #include <asm/cache.h>
 #include <dm/uclass.h>
+#include <linux/bitmap.h>
 #include <linux/ctype.h>
 #include <linux/math64.h>
+#include <linux/sizes.h>
 #include "fat.c"
 
 static dir_entry *find_directory_entry(fat_itr *itr, char *filename);
@@ -212,26 +214,29 @@ static int disk_write(__u32 block, __u32 nr_blocks, void *buf)
 	return ret;
 }
 
+/* Size of the write-back window onto the FAT */
+#define FAT_WB_BUFSIZE		SZ_64K
+
 /*
- * Write fat buffer into block device
+ * Write-back window onto the FAT. Blocks of FAT entries are loaded into fatbuf
+ * from here and changes to them are kept here, so that allocating a long run
+ * of clusters reads and writes the FAT in large pieces. Sector numbers are
+ * relative to the start of the FAT and the window always starts on a fatbuf
+ * boundary, so that a block of entries is either wholly inside it or not.
  */
-static int flush_dirty_fat_buffer(fsdata *mydata)
-{
-	int getsize = FATBUFBLOCKS;
-	__u32 fatlength = mydata->fatlength;
-	__u8 *bufptr = mydata->fatbuf;
-	__u32 startblock = mydata->fatbufnum * FATBUFBLOCKS;
-
-	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
-	      (int)mydata->fat_dirty);
-
-	if ((!mydata->fat_dirty) || (mydata->fatbufnum == -1))
-		return 0;
-
-	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-	if (startblock + getsize > fatlength)
-		getsize = fatlength - startblock;
+static __u8 *fat_wb_buf;
+static __u32 fat_wb_start;
+static __u32 fat_wb_len;
+static __u32 fat_wb_dirty_start;
+static __u32 fat_wb_dirty_end;
 
+/*
+ * Write 'getsize' sectors of the FAT, starting at 'startblock', to each copy
+ * of the FAT
+ */
+static int write_fat_sectors(fsdata *mydata, __u32 startblock, __u32 getsize,
+			     __u8 *bufptr)
+{
 	startblock += mydata->fat_sect;
 
 	/* Write FAT buf */
@@ -248,11 +253,321 @@ static int flush_dirty_fat_buffer(fsdata *mydata)
 			return -1;
 		}
 	}
+
+	return 0;
+}
+
+/*
+ * Get the first sector and number of sectors of FAT block 'bufnum'
+ */
+static __u32 fat_buffer_sectors(fsdata *mydata, __u32 bufnum,
+				__u32 *startblock)
+{
+	*startblock = bufnum * FATBUFBLOCKS;
+
+	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+	return min_t(__u32, FATBUFBLOCKS, mydata->fatlength - *startblock);
+}
+
+/*
+ * Write the changed part of the write-back window to the device
+ */
+static int fat_wb_flush(fsdata *mydata)
+{
+	__u32 start = fat_wb_dirty_start, end = fat_wb_dirty_end;
+
+	if (start == end)
+		return 0;
+
+	fat_wb_dirty_start = 0;
+	fat_wb_dirty_end = 0;
+
+	return write_fat_sectors(mydata, fat_wb_start + start, end - start,
+				 fat_wb_buf + start * mydata->sect_size);
+}
+
+/*
+ * Copy fatbuf into the write-back window. Return -ENOENT if the window does
+ * not hold the block of entries in fatbuf.
+ */
+static int fat_wb_put(fsdata *mydata)
+{
+	__u32 startblock, getsize;
+
+	getsize = fat_buffer_sectors(mydata, mydata->fatbufnum, &startblock);
+	if (startblock < fat_wb_start ||
+	    startblock + getsize > fat_wb_start + fat_wb_len)
+		return -ENOENT;
+
+	startblock -= fat_wb_start;
+	memcpy(fat_wb_buf + startblock * mydata->sect_size, mydata->fatbuf,
+	       getsize * mydata->sect_size);
+	if (fat_wb_dirty_start == fat_wb_dirty_end) {
+		fat_wb_dirty_start = startblock;
+		fat_wb_dirty_end = startblock + getsize;
+	} else {
+		fat_wb_dirty_start = min(fat_wb_dirty_start, startblock);
+		fat_wb_dirty_end = max(fat_wb_dirty_end, startblock + getsize);
+	}
+
+	return 0;
+}
+
+/*
+ * Copy FAT block 'bufnum' from the write-back window into fatbuf, moving the
+ * window first if it does not hold that block
+ */
+static int fat_wb_get(fsdata *mydata, __u32 bufnum)
+{
+	__u32 startblock, getsize;
+
+	getsize = fat_buffer_sectors(mydata, bufnum, &startblock);
+	if (startblock < fat_wb_start ||
+	    startblock + getsize > fat_wb_start + fat_wb_len) {
+		if (fat_wb_flush(mydata) < 0)
+			return -1;
+
+		if (FAT_WB_BUFSIZE < FATBUFSIZE)
+			return -ENOMEM;
+		if (!fat_wb_buf) {
+			fat_wb_buf = malloc_cache_aligned(FAT_WB_BUFSIZE);
+			if (!fat_wb_buf)
+				return -ENOMEM;
+		}
+		fat_wb_len = 0;
+
+		/* Cap length if the window goes past the end of the FAT */
+		getsize = FAT_WB_BUFSIZE / FATBUFSIZE * FATBUFBLOCKS;
+		if (startblock + getsize > mydata->fatlength)
+			getsize = mydata->fatlength - startblock;
+
+		if (disk_read(mydata->fat_sect + startblock, getsize,
+			      fat_wb_buf) < 0)
+			return -1;
+		fat_wb_start = startblock;
+		fat_wb_len = getsize;
+
+		getsize = fat_buffer_sectors(mydata, bufnum, &startblock);
+	}
+
+	memcpy(mydata->fatbuf,
+	       fat_wb_buf + (startblock - fat_wb_start) * mydata->sect_size,
+	       getsize * mydata->sect_size);
+
+	return 0;
+}
+
+/*
+ * Write fat buffer into block device
+ */
+static int flush_dirty_fat_buffer(fsdata *mydata)
+{
+	__u32 startblock, getsize;
+
+	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
+	      (int)mydata->fat_dirty);
+
+	if (!mydata->fat_dirty)
+		return 0;
+
+	if (mydata->fatbufnum != -1 && fat_wb_put(mydata)) {
+		getsize = fat_buffer_sectors(mydata, mydata->fatbufnum,
+					     &startblock);
+		if (write_fat_sectors(mydata, startblock, getsize,
+				      mydata->fatbuf) < 0)
+			return -1;
+	}
+	if (fat_wb_flush(mydata) < 0)
+		return -1;
 	mydata->fat_dirty = 0;
 
+	/*
+	 * Other copies of fsdata may have decoded chains from the old FAT. The
+	 * chains of this one are still valid, and may be in use, as this can
+	 * be called while decoding one.
+	 */
+	fat_chain_drop_others(mydata);
+
 	return 0;
 }
 
+/*
+ * Read block 'bufnum' of FAT entries into fatbuf. Changes to the block in
+ * fatbuf are kept in the write-back window if it holds the block, and only
+ * written to the device by flush_dirty_fat_buffer(), so fat_dirty stays set.
+ */
+static int read_fat_buffer(fsdata *mydata, __u32 bufnum)
+{
+	__u32 startblock, getsize;
+	int ret;
+
+	if (mydata->fat_dirty && mydata->fatbufnum != -1 &&
+	    fat_wb_put(mydata) && flush_dirty_fat_buffer(mydata) < 0)
+		return -1;
+
+	/* The block about to be overwritten may hold changes */
+	mydata->fatbufnum = -1;
+
+	ret = fat_wb_get(mydata, bufnum);
+	if (ret == -ENOMEM) {
+		getsize = fat_buffer_sectors(mydata, bufnum, &startblock);
+		ret = disk_read(mydata->fat_sect + startblock, getsize,
+				mydata->fatbuf);
+	}
+	if (ret < 0)
+		return -1;
+	mydata->fatbufnum = bufnum;
+
+	return 0;
+}
+
+/*
+ * Free space of the filesystem being written to, as a bitmap with a bit set
+ * for each free cluster. It is filled in from the FAT in chunks of
+ * FAT_SPACE_CHUNK entries when first searched and then kept up to date by
+ * set_fatent_value(), so that finding a free cluster does not read the FAT.
+ * New clusters are allocated next-fit, starting from fat_space_next, so that
+ * files written one after another each get long runs of clusters.
+ */
+#define FAT_SPACE_CHUNK		4096
+
+static unsigned long *fat_space_map;
+static unsigned long *fat_space_known;
+static __u32 fat_space_entries;
+static __u32 fat_space_next;
+
+static bool fat_space_test(unsigned long *map, __u32 nr)
+{
+	return map[BIT_WORD(nr)] & BIT_MASK(nr);
+}
+
+/*
+ * Drop the free space bitmap and the write-back window, e.g. once another
+ * filesystem is accessed. Changes not yet flushed are lost.
+ */
+static void fat_space_invalidate(void)
+{
+	free(fat_space_map);
+	free(fat_space_known);
+	fat_space_map = NULL;
+	fat_space_known = NULL;
+	fat_space_entries = 0;
+	fat_space_next = 0;
+
+	free(fat_wb_buf);
+	fat_wb_buf = NULL;
+	fat_wb_len = 0;
+	fat_wb_dirty_start = 0;
+	fat_wb_dirty_end = 0;
+}
+
+/*
+ * Get the number of FAT entries which may describe a cluster, counting the
+ * reserved entries 0 and 1
+ */
+static __u32 fat_space_count(fsdata *mydata)
+{
+	__u32 entries, fatents;
+
+	entries = (mydata->total_sect - mydata->data_begin) /
+		  mydata->clust_size;
+	fatents = lldiv((u64)mydata->fatlength * mydata->sect_size * 8,
+			mydata->fatsize);
+	entries = min(entries, fatents);
+	if (mydata->fatsize == 32)
+		return min(entries, 0xffffff0U);
+
+	return min(entries, mydata->fatsize == 16 ? 0xfff0U : 0xff0U);
+}
+
+/*
+ * Allocate the free space bitmap, which is empty until chunks are scanned.
+ * Return 0 on success, -1 otherwise.
+ */
+static int fat_space_init(fsdata *mydata)
+{
+	__u32 entries;
+
+	if (fat_space_map)
+		return 0;
+
+	entries = fat_space_count(mydata);
+
+	fat_space_map = calloc(BITS_TO_LONGS(entries), sizeof(long));
+	fat_space_known = calloc(BITS_TO_LONGS(DIV_ROUND_UP(entries,
+				 FAT_SPACE_CHUNK)), sizeof(long));
+	if (!fat_space_map || !fat_space_known) {
+		debug("Error: allocating free space bitmap\n");
+		fat_space_invalidate();
+		return -1;
+	}
+	fat_space_entries = entries;
+	fat_space_next = 2;
+
+	return 0;
+}
+
+/*
+ * Fill in the free space bitmap for chunk 'chunk' of FAT entries
+ */
+static void fat_space_scan(fsdata *mydata, __u32 chunk)
+{
+	__u32 entry = max(chunk * FAT_SPACE_CHUNK, 2U);
+	__u32 end = min(entry + FAT_SPACE_CHUNK, fat_space_entries);
+	__u32 mask = mydata->fatsize == 32 ? 0x0fffffff : ~0;
+
+	for (; entry < end; entry++) {
+		if (!(fat_chain_fatent(mydata, entry) & mask))
+			__set_bit(entry, fat_space_map);
+	}
+	__set_bit(chunk, fat_space_known);
+}
+
+/*
+ * Find the first free cluster at or after 'entry'. Return 0 if there is none.
+ */
+static __u32 fat_space_find(fsdata *mydata, __u32 entry)
+{
+	__u32 chunk, end;
+
+	if (fat_space_init(mydata)) {
+		/* no memory, so read the FAT */
+		for (entry = max(entry, 2U); entry < fat_space_count(mydata);
+		     entry++) {
+			if (!get_fatent(mydata, entry))
+				return entry;
+		}
+		return 0;
+	}
+
+	for (entry = max(entry, 2U); entry < fat_space_entries; entry = end) {
+		chunk = entry / FAT_SPACE_CHUNK;
+		if (!fat_space_test(fat_space_known, chunk))
+			fat_space_scan(mydata, chunk);
+		end = min((chunk + 1) * FAT_SPACE_CHUNK, fat_space_entries);
+		entry = find_next_bit(fat_space_map, end, entry);
+		if (entry < end)
+			return entry;
+	}
+
+	return 0;
+}
+
+/*
+ * Note the new value of FAT entry 'entry' in the free space bitmap
+ */
+static void fat_space_update(__u32 entry, __u32 entry_value)
+{
+	if (!fat_space_map || entry >= fat_space_entries ||
+	    !fat_space_test(fat_space_known, entry / FAT_SPACE_CHUNK))
+		return;
+
+	if (entry_value)
+		__clear_bit(entry, fat_space_map);
+	else
+		__set_bit(entry, fat_space_map);
+}
+
 /**
  * fat_find_empty_dentries() - find a sequence of available directory entries
  *
@@ -461,31 +776,19 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		return -1;
 	}
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		startblock += mydata->fat_sect;
+	/* chains decoded before this change may be wrong now */
+	fat_chain_invalidate();
 
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return -1;
-		}
-		mydata->fatbufnum = bufnum;
+	/* Read a new block of FAT entries into the cache. */
+	if (bufnum != mydata->fatbufnum &&
+	    read_fat_buffer(mydata, bufnum) < 0) {
+		debug("Error reading FAT blocks\n");
+		return -1;
 	}
 
 	/* Mark as dirty */
 	mydata->fat_dirty = 1;
+	fat_space_update(entry, entry_value);
 
 	/* Set the actual entry */
 	switch (mydata->fatsize) {
@@ -544,20 +847,21 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 /*
  * Determine the next free cluster after 'entry' in a FAT (12/16/32) table
  * and link it to 'entry'. EOC marker is not set on returned entry.
+ * Return 0 if there is no free cluster left.
  */
 static __u32 determine_fatent(fsdata *mydata, __u32 entry)
 {
-	__u32 next_fat, next_entry = entry + 1;
+	__u32 next_entry;
 
-	while (1) {
-		next_fat = get_fatent(mydata, next_entry);
-		if (next_fat == 0) {
-			/* found free entry, link to entry */
-			set_fatent_value(mydata, entry, next_entry);
-			break;
-		}
-		next_entry++;
-	}
+	next_entry = fat_space_find(mydata, entry + 1);
+	if (!next_entry)
+		next_entry = fat_space_find(mydata, 2);
+	if (!next_entry)
+		return 0;
+
+	/* found free entry, link to entry */
+	set_fatent_value(mydata, entry, next_entry);
+	fat_space_next = next_entry + 1;
 	debug("FAT%d: entry: %08x, entry_value: %04x\n",
 	       mydata->fatsize, entry, next_entry);
 
@@ -800,18 +1104,19 @@ get_set_cluster(fsdata *mydata, __u32 clustnum, loff_t pos, __u8 *buffer,
 }
 
 /*
- * Find the first empty cluster
+ * Find an empty cluster, searching on from the one allocated last
+ * Return the cluster number or -ENOSPC if the filesystem is full
  */
 static int find_empty_cluster(fsdata *mydata)
 {
-	__u32 fat_val, entry = 3;
+	__u32 entry;
 
-	while (1) {
-		fat_val = get_fatent(mydata, entry);
-		if (fat_val == 0)
-			break;
-		entry++;
-	}
+	entry = fat_space_find(mydata, fat_space_next);
+	if (!entry)
+		entry = fat_space_find(mydata, 2);
+	if (!entry)
+		return -ENOSPC;
+	fat_space_next = entry + 1;
 
 	return entry;
 }
@@ -820,7 +1125,7 @@ static int find_empty_cluster(fsdata *mydata)
  * new_dir_table() - allocate a cluster for additional directory entries
  *
  * @itr:	directory iterator
- * Return:	0 on success, -EIO otherwise
+ * Return:	0 on success, -ENOSPC if the filesystem is full, -EIO otherwise
  */
 static int new_dir_table(fat_itr *itr)
 {
@@ -830,6 +1135,8 @@ static int new_dir_table(fat_itr *itr)
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
 
 	dir_newclust = find_empty_cluster(mydata);
+	if (dir_newclust < 0)
+		return dir_newclust;
 
 	/*
 	 * Flush before updating FAT to ensure valid directory structure
@@ -934,6 +1241,7 @@ set_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos, __u8 *buffer,
 	__u32 endclust = 0, newclust = 0;
 	u64 cur_pos, filesize;
 	loff_t offset, actsize, wsize;
+	int ret;
 
 	*gotsize = 0;
 	filesize = pos + maxsize;
@@ -1071,14 +1379,23 @@ set_clusters:
 
 	/* Assure that curclust is valid */
 	if (!curclust) {
-		curclust = find_empty_cluster(mydata);
+		ret = find_empty_cluster(mydata);
+		if (ret < 0) {
+			printf("Error: no space left: %llu\n", filesize);
+			return -1;
+		}
+		curclust = ret;
 		set_start_cluster(mydata, dentptr, curclust);
 	} else {
 		newclust = get_fatent(mydata, curclust);
 
 		if (IS_LAST_CLUST(newclust, mydata->fatsize)) {
 			newclust = determine_fatent(mydata, curclust);
-			set_fatent_value(mydata, curclust, newclust);
+			if (!newclust) {
+				printf("Error: no space left: %llu\n",
+				       filesize);
+				return -1;
+			}
 			curclust = newclust;
 		} else {
 			debug("error: something wrong\n");
@@ -1098,6 +1415,19 @@ set_clusters:
 		/* search for consecutive clusters */
 		while (actsize < filesize) {
 			newclust = determine_fatent(mydata, endclust);
+			if (!newclust) {
+				printf("Error: no space left: %llu\n",
+				       filesize);
+				/* Mark end of the clusters allocated so far */
+				if (mydata->fatsize == 12)
+					newclust = 0xfff;
+				else if (mydata->fatsize == 16)
+					newclust = 0xffff;
+				else if (mydata->fatsize == 32)
+					newclust = 0xfffffff;
+				set_fatent_value(mydata, endclust, newclust);
+				return -1;
+			}
 
 			if ((newclust - 1) != endclust)
 				/* write to <curclust..endclust> */
@@ -40,6 +40,7 @@ static struct blk_desc *fs_dev_desc;
 static int fs_dev_part;
 static struct disk_partition fs_partition;
 static int fs_type = FS_TYPE_ANY;
+static bool fs_probing;
 
 void fs_set_type(int type)
 {
@@ -119,6 +120,12 @@ static inline int fs_ln_unsupported(const char *filename, const char *target)
 	return -1;
 }
 
+static inline int fs_extents_unsupported(const char *filename,
+					 fs_extent_fn fn, void *priv)
+{
+	return -EOPNOTSUPP;
+}
+
 static inline void fs_close_unsupported(void)
 {
 }
@@ -191,6 +198,11 @@ struct fstype_info {
 	int (*mkdir)(const char *dirname);
 	int (*ln)(const char *filename, const char *target);
 	int (*rename)(const char *old_path, const char *new_path);
+	/*
+	 * Report the extents of a file, with their position relative to
+	 * the start of the partition. See fs_get_extents().
+	 */
+	int (*extents)(const char *filename, fs_extent_fn fn, void *priv);
 };
 
 static struct fstype_info fstypes[] = {
@@ -224,6 +236,7 @@ static struct fstype_info fstypes[] = {
 #else
 		.rename = fs_rename_unsupported,
 #endif
+		.extents = fat_extents,
 	},
 #endif
 
@@ -252,6 +265,7 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.rename = fs_rename_unsupported,
+		.extents = ext4fs_extents,
 	},
 #endif
 #if IS_ENABLED(CONFIG_SANDBOX) && !IS_ENABLED(CONFIG_XPL_BUILD)
@@ -272,6 +286,7 @@ static struct fstype_info fstypes[] = {
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
 		.rename = fs_rename_unsupported,
+		.extents = fs_extents_unsupported,
 	},
 #endif
 #if CONFIG_IS_ENABLED(SEMIHOSTING)
@@ -292,6 +307,7 @@ static struct fstype_info fstypes[] = {
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
 		.rename = fs_rename_unsupported,
+		.extents = fs_extents_unsupported,
 	},
 #endif
 #ifndef CONFIG_XPL_BUILD
@@ -313,6 +329,7 @@ static struct fstype_info fstypes[] = {
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
 		.rename = fs_rename_unsupported,
+		.extents = fs_extents_unsupported,
 	},
 #endif
 #endif
@@ -335,6 +352,7 @@ static struct fstype_info fstypes[] = {
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
 		.rename = fs_rename_unsupported,
+		.extents = fs_extents_unsupported,
 	},
 #endif
 #endif
@@ -358,6 +376,7 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.rename = fs_rename_unsupported,
+		.extents = fs_extents_unsupported,
 	},
 #endif
 #if IS_ENABLED(CONFIG_FS_EROFS)
@@ -380,6 +399,7 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.rename = fs_rename_unsupported,
+		.extents = fs_extents_unsupported,
 	},
 #endif
 #if IS_ENABLED(CONFIG_FS_EXFAT)
@@ -402,6 +422,7 @@ static struct fstype_info fstypes[] = {
 		.unlink = exfat_fs_unlink,
 		.mkdir = exfat_fs_mkdir,
 		.rename = exfat_fs_rename,
+		.extents = fs_extents_unsupported,
 	},
 #endif
 	{
@@ -421,6 +442,7 @@ static struct fstype_info fstypes[] = {
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
 		.rename = fs_rename_unsupported,
+		.extents = fs_extents_unsupported,
 	},
 };
 
@@ -467,7 +489,7 @@ const char *fs_get_type_name(void)
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
-	int part, i;
+	int part, ret, i;
 
 	part = part_get_info_by_dev_and_name_or_num(ifname, dev_part_str, &fs_dev_desc,
 						    &fs_partition, 1);
@@ -482,7 +504,10 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 		if (!fs_dev_desc && !info->null_dev_desc_ok)
 			continue;
 
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
+		fs_probing = true;
+		ret = info->probe(fs_dev_desc, &fs_partition);
+		fs_probing = false;
+		if (!ret) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
 			return 0;
@@ -507,7 +532,10 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 	fs_dev_desc = desc;
 
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
+		fs_probing = true;
+		ret = info->probe(fs_dev_desc, &fs_partition);
+		fs_probing = false;
+		if (!ret) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
 			return 0;
@@ -517,6 +545,11 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 	return -1;
 }
 
+bool fs_in_use(void)
+{
+	return fs_probing || fs_type != FS_TYPE_ANY;
+}
+
 void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
@@ -572,6 +605,43 @@ int fs_size(const char *filename, loff_t *size)
 	return ret;
 }
 
+/**
+ * struct fs_extents_ctx - Context of fs_get_extents()
+ *
+ * @fn: Function to call for each extent
+ * @priv: Private data for @fn
+ */
+struct fs_extents_ctx {
+	fs_extent_fn fn;
+	void *priv;
+};
+
+/* Turn the position of an extent in the partition into one on the device */
+static int fs_extent_on_dev(void *priv, loff_t offset, u64 pos, u64 len)
+{
+	struct fs_extents_ctx *ctx = priv;
+
+	pos += (u64)fs_partition.start << fs_dev_desc->log2blksz;
+
+	return ctx->fn(ctx->priv, offset, pos, len);
+}
+
+int fs_get_extents(const char *filename, fs_extent_fn fn, void *priv)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	struct fs_extents_ctx ctx = {
+		.fn = fn,
+		.priv = priv,
+	};
+	int ret;
+
+	ret = info->extents(filename, fs_extent_on_dev, &ctx);
+
+	fs_close();
+
+	return ret;
+}
+
 #if CONFIG_IS_ENABLED(LMB)
 /* Check if a file may be read to the given address */
 static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
@@ -628,7 +698,9 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * means read the whole file.
 	 */
 	buf = map_sysmem(addr, len);
+	blk_readahead_start(fs_dev_desc);
 	ret = info->read(filename, buf, offset, len, actread);
+	blk_readahead_stop(fs_dev_desc);
 	unmap_sysmem(buf);
 
 	/* If we requested a specific number of bytes, check we got it */
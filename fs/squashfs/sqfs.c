@@ -8,12 +8,15 @@
  */
 
 #include <asm/unaligned.h>
+#include <blk.h>
 #include <div64.h>
 #include <errno.h>
 #include <fs.h>
 #include <linux/types.h>
 #include <asm/byteorder.h>
 #include <linux/compat.h>
+#include <linux/list.h>
+#include <linux/sizes.h>
 #include <memalign.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,8 +29,61 @@
 
 #define MAX_SYMLINK_NEST 8
 
+/* Number of bytes of data blocks read from the device at a time */
+#define SQFS_READ_CHUNK SZ_256K
+
+/**
+ * struct sqfs_cache_entry - a decompressed block kept for later reads
+ *
+ * @sibling:	Entry in sqfs_cache.entries, most recently used first
+ * @start:	Position of the block in the image, in bytes
+ * @len:	Size of @data, in bytes
+ * @data:	Contents of the block
+ */
+struct sqfs_cache_entry {
+	struct list_head sibling;
+	u64 start;
+	u32 len;
+	char data[] __aligned(8);
+};
+
+/**
+ * struct sqfs_cache - cache of fragment blocks and fragment table blocks
+ *
+ * The cache is emptied by sqfs_close().
+ *
+ * @size:	Number of bytes of data held
+ * @entries:	Cached blocks, most recently used first
+ */
+struct sqfs_cache {
+	size_t size;
+	struct list_head entries;
+};
+
+/**
+ * struct sqfs_chunk - consecutive data blocks of a file, read in one go
+ *
+ * @count:	Number of data blocks held, 0 if the chunk is empty
+ * @offset:	Offset of the first data block in @buf
+ * @blkcnt:	Number of device blocks read into @buf
+ * @busy:	true while @req may still be in flight
+ * @req:	Request filling @buf
+ * @buf:	Buffer for the compressed data blocks
+ */
+struct sqfs_chunk {
+	int count;
+	u32 offset;
+	lbaint_t blkcnt;
+	bool busy;
+	struct blk_req req;
+	char *buf;
+};
+
 static struct squashfs_ctxt ctxt;
 static int symlinknest;
+static struct sqfs_cache sqfs_cache = {
+	.entries = LIST_HEAD_INIT(sqfs_cache.entries),
+};
 
 static int sqfs_readdir_nest(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp);
 
@@ -47,6 +103,62 @@ static int sqfs_disk_read(__u32 block, __u32 nr_blocks, void *buf)
 	return ret;
 }
 
+static void sqfs_cache_drop(struct sqfs_cache_entry *entry)
+{
+	list_del(&entry->sibling);
+	sqfs_cache.size -= entry->len;
+	free(entry);
+}
+
+static void sqfs_cache_free(void)
+{
+	struct sqfs_cache_entry *entry, *n;
+
+	list_for_each_entry_safe(entry, n, &sqfs_cache.entries, sibling)
+		sqfs_cache_drop(entry);
+}
+
+static struct sqfs_cache_entry *sqfs_cache_find(u64 start)
+{
+	struct sqfs_cache_entry *entry;
+
+	list_for_each_entry(entry, &sqfs_cache.entries, sibling) {
+		if (entry->start == start) {
+			list_move(&entry->sibling, &sqfs_cache.entries);
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Add an entry of 'len' bytes for the block at 'start', evicting the least
+ * recently used blocks to make room. The caller fills in the data, or drops
+ * the entry if it cannot.
+ */
+static struct sqfs_cache_entry *sqfs_cache_add(u64 start, u32 len)
+{
+	struct sqfs_cache_entry *entry;
+
+	while (!list_empty(&sqfs_cache.entries) &&
+	       sqfs_cache.size + len > CONFIG_SQUASHFS_CACHE_SIZE)
+		sqfs_cache_drop(list_last_entry(&sqfs_cache.entries,
+						struct sqfs_cache_entry,
+						sibling));
+
+	entry = malloc(sizeof(*entry) + len);
+	if (!entry)
+		return NULL;
+
+	entry->start = start;
+	entry->len = len;
+	list_add(&entry->sibling, &sqfs_cache.entries);
+	sqfs_cache.size += len;
+
+	return entry;
+}
+
 static int sqfs_read_sblk(struct squashfs_super_block **sblk)
 {
 	*sblk = malloc_cache_aligned(ctxt.cur_dev->blksz);
@@ -109,12 +221,12 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	unsigned char *metadata_buffer, *metadata, *table;
 	struct squashfs_fragment_block_entry *entries;
 	struct squashfs_super_block *sblk = ctxt.sblk;
+	struct sqfs_cache_entry *entry;
 	unsigned long dest_len;
 	int block, offset, ret;
 	u16 header;
 
 	metadata_buffer = NULL;
-	entries = NULL;
 	table = NULL;
 
 	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
@@ -154,6 +266,10 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	start_block = get_unaligned_le64(table + table_offset + block *
 					 sizeof(u64));
 
+	entry = sqfs_cache_find(start_block);
+	if (entry)
+		goto found;
+
 	start = start_block / ctxt.cur_dev->blksz;
 	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
 				  sblk->fragment_table_start, &table_offset);
@@ -178,8 +294,8 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		goto out;
 	}
 
-	entries = malloc(SQFS_METADATA_BLOCK_SIZE);
-	if (!entries) {
+	entry = sqfs_cache_add(start_block, SQFS_METADATA_BLOCK_SIZE);
+	if (!entry) {
 		ret = -ENOMEM;
 		goto out;
 	}
@@ -187,21 +303,23 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	if (SQFS_COMPRESSED_METADATA(header)) {
 		src_len = SQFS_METADATA_SIZE(header);
 		dest_len = SQFS_METADATA_BLOCK_SIZE;
-		ret = sqfs_decompress(&ctxt, entries, &dest_len, metadata,
+		ret = sqfs_decompress(&ctxt, entry->data, &dest_len, metadata,
 				      src_len);
 		if (ret) {
+			sqfs_cache_drop(entry);
 			ret = -EINVAL;
 			goto out;
 		}
 	} else {
-		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
+		memcpy(entry->data, metadata, SQFS_METADATA_SIZE(header));
 	}
 
+found:
+	entries = (struct squashfs_fragment_block_entry *)entry->data;
 	*e = entries[offset];
 	ret = SQFS_COMPRESSED_BLOCK(e->size);
 
 out:
-	free(entries);
 	free(metadata_buffer);
 	free(table);
 
@@ -1284,6 +1402,245 @@ out:
 	return ret;
 }
 
+/*
+ * Start reading as many data blocks as fit in a chunk, from block 'first' at
+ * position '*pos' in the image. '*pos' is moved past the blocks taken.
+ */
+static int sqfs_chunk_read(struct sqfs_chunk *chunk,
+			   struct squashfs_file_info *finfo, int first,
+			   int datablk_count, u64 *pos, size_t size)
+{
+	u32 blksz = ctxt.cur_dev->blksz;
+	u64 start, bytes;
+	int j;
+
+	start = lldiv(*pos, blksz);
+	chunk->offset = *pos - start * blksz;
+	bytes = chunk->offset;
+	for (j = first; j < datablk_count; j++) {
+		u32 table_size = SQFS_BLOCK_SIZE(finfo->blk_sizes[j]);
+
+		if (bytes + table_size > size) {
+			if (j == first)
+				return -EINVAL;
+			break;
+		}
+		bytes += table_size;
+	}
+	chunk->count = j - first;
+	*pos += bytes - chunk->offset;
+
+	/* sparse blocks have no data on the device */
+	chunk->blkcnt = 0;
+	if (bytes == chunk->offset)
+		return 0;
+	chunk->blkcnt = DIV_ROUND_UP(bytes, blksz);
+
+#if CONFIG_IS_ENABLED(BLK)
+	if (!blk_submit_read(ctxt.cur_dev->bdev,
+			     ctxt.cur_part_info.start + start, chunk->blkcnt,
+			     chunk->buf, &chunk->req)) {
+		chunk->busy = true;
+		return 0;
+	}
+#endif
+
+	return sqfs_disk_read(start, chunk->blkcnt, chunk->buf) < 0 ? -EIO : 0;
+}
+
+static int sqfs_chunk_wait(struct sqfs_chunk *chunk)
+{
+#if CONFIG_IS_ENABLED(BLK)
+	long ret;
+
+	if (!chunk->busy)
+		return 0;
+
+	chunk->busy = false;
+	ret = blk_wait(&chunk->req);
+	if (ret != chunk->blkcnt)
+		return ret < 0 ? ret : -EIO;
+#endif
+
+	return 0;
+}
+
+/*
+ * Read the data blocks of a file into 'buf', stopping after 'len' bytes.
+ *
+ * The blocks are read in chunks of SQFS_READ_CHUNK bytes. Where the device
+ * supports it, the next chunk is read while the current one is being
+ * decompressed. Whole blocks are decompressed straight into 'buf'.
+ */
+static int sqfs_read_data(struct squashfs_file_info *finfo, int datablk_count,
+			  void *buf, loff_t len, loff_t *actread)
+{
+	u32 block_size = get_unaligned_le32(&ctxt.sblk->block_size);
+	u32 blksz = ctxt.cur_dev->blksz;
+	struct sqfs_chunk chunks[2] = {}, *cur, *next;
+	char *datablock = NULL, *data;
+	unsigned long dest_len;
+	u64 pos = finfo->start;
+	u32 table_size, blk;
+	int i, j, next_blk;
+	size_t size;
+	int ret;
+
+	size = max_t(size_t, SQFS_READ_CHUNK,
+		     ALIGN(block_size, blksz) + blksz);
+	cur = &chunks[0];
+	next = &chunks[1];
+	cur->buf = malloc_cache_aligned(size);
+	if (!cur->buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	/* without a second buffer the chunks are just not read ahead */
+	next->buf = malloc_cache_aligned(size);
+
+	ret = 0;
+	for (j = 0; j < datablk_count && *actread < len; j = next_blk) {
+		if (!cur->count)
+			ret = sqfs_chunk_read(cur, finfo, j, datablk_count,
+					      &pos, size);
+		if (!ret)
+			ret = sqfs_chunk_wait(cur);
+		next_blk = j + cur->count;
+
+		/* queue the next chunk, if it is wanted, while this one is used */
+		if (!ret && next->buf && next_blk < datablk_count &&
+		    (u64)next_blk * block_size < len)
+			ret = sqfs_chunk_read(next, finfo, next_blk,
+					      datablk_count, &pos, size);
+		if (ret) {
+			/*
+			 * Possible causes: too many data blocks or too large
+			 * SquashFS block size. Tip: re-compile the SquashFS
+			 * image with mksquashfs's -b <block_size> option.
+			 */
+			printf("Error: too many data blocks to be read.\n");
+			goto out;
+		}
+
+		data = cur->buf + cur->offset;
+		for (i = 0; i < cur->count && *actread < len; i++) {
+			blk = finfo->blk_sizes[j + i];
+			table_size = SQFS_BLOCK_SIZE(blk);
+
+			if (!blk) {
+				/* This is a sparse block */
+				dest_len = min_t(loff_t, block_size,
+						 len - *actread);
+				memset(buf + *actread, 0, dest_len);
+			} else if (!SQFS_COMPRESSED_BLOCK(blk)) {
+				dest_len = min_t(loff_t, table_size,
+						 len - *actread);
+				memcpy(buf + *actread, data, dest_len);
+			} else if (len - *actread >= block_size) {
+				dest_len = block_size;
+				ret = sqfs_decompress(&ctxt, buf + *actread,
+						      &dest_len, data,
+						      table_size);
+				if (ret)
+					goto out;
+			} else {
+				/* the end of the block is not wanted */
+				if (!datablock) {
+					datablock = malloc(block_size);
+					if (!datablock) {
+						ret = -ENOMEM;
+						goto out;
+					}
+				}
+				dest_len = block_size;
+				ret = sqfs_decompress(&ctxt, datablock,
+						      &dest_len, data,
+						      table_size);
+				if (ret)
+					goto out;
+				dest_len = min_t(loff_t, dest_len,
+						 len - *actread);
+				memcpy(buf + *actread, datablock, dest_len);
+			}
+			*actread += dest_len;
+			data += table_size;
+		}
+
+		cur->count = 0;
+		if (next->buf)
+			swap(cur, next);
+	}
+
+out:
+	for (i = 0; i < ARRAY_SIZE(chunks); i++) {
+		sqfs_chunk_wait(&chunks[i]);
+		free(chunks[i].buf);
+	}
+	free(datablock);
+
+	return ret;
+}
+
+/* Get the contents of a fragment block, from the cache if possible */
+static int sqfs_read_fragment(struct squashfs_fragment_block_entry *frag_entry,
+			      bool comp, struct sqfs_cache_entry **entryp)
+{
+	u64 start, n_blks, table_size, table_offset;
+	struct sqfs_cache_entry *entry;
+	unsigned long dest_len;
+	char *fragment;
+	size_t buf_size;
+	int ret;
+
+	entry = sqfs_cache_find(frag_entry->start);
+	if (entry) {
+		*entryp = entry;
+		return 0;
+	}
+
+	start = lldiv(frag_entry->start, ctxt.cur_dev->blksz);
+	table_size = SQFS_BLOCK_SIZE(frag_entry->size);
+	table_offset = frag_entry->start - (start * ctxt.cur_dev->blksz);
+	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
+
+	if (__builtin_mul_overflow(n_blks, ctxt.cur_dev->blksz, &buf_size))
+		return -EINVAL;
+
+	fragment = malloc_cache_aligned(buf_size);
+	if (!fragment)
+		return -ENOMEM;
+
+	ret = sqfs_disk_read(start, n_blks, fragment);
+	if (ret < 0)
+		goto out;
+
+	dest_len = comp ? get_unaligned_le32(&ctxt.sblk->block_size) :
+		   table_size;
+	entry = sqfs_cache_add(frag_entry->start, dest_len);
+	if (!entry) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = 0;
+	if (comp) {
+		ret = sqfs_decompress(&ctxt, entry->data, &dest_len,
+				      fragment + table_offset, table_size);
+		if (ret) {
+			sqfs_cache_drop(entry);
+			goto out;
+		}
+	} else {
+		memcpy(entry->data, fragment + table_offset, table_size);
+	}
+	*entryp = entry;
+
+out:
+	free(fragment);
+
+	return ret;
+}
+
 static int sqfs_get_regfile_info(struct squashfs_reg_inode *reg,
 				 struct squashfs_file_info *finfo,
 				 struct squashfs_fragment_block_entry *fentry,
@@ -1363,12 +1720,11 @@ static int sqfs_get_lregfile_info(struct squashfs_lreg_inode *lreg,
 static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 			  loff_t len, loff_t *actread)
 {
-	char *dir = NULL, *fragment_block, *datablock = NULL;
-	char *fragment = NULL, *file = NULL, *resolved, *data;
-	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
-	int ret, j, i_number, datablk_count = 0;
+	char *dir = NULL, *file = NULL, *resolved;
+	int ret, i_number, datablk_count = 0;
 	struct squashfs_super_block *sblk = ctxt.sblk;
 	struct squashfs_fragment_block_entry frag_entry;
+	struct sqfs_cache_entry *entry;
 	struct squashfs_file_info finfo = {0};
 	struct squashfs_symlink_inode *symlink;
 	struct fs_dir_stream *dirsp = NULL;
@@ -1376,10 +1732,8 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 	struct squashfs_lreg_inode *lreg;
 	struct squashfs_base_inode *base;
 	struct squashfs_reg_inode *reg;
-	unsigned long dest_len;
 	struct fs_dirent *dent;
 	unsigned char *ipos;
-	size_t buf_size;
 
 	*actread = 0;
 
@@ -1493,83 +1847,9 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 		len = finfo.size;
 	}
 
-	if (datablk_count) {
-		data_offset = finfo.start;
-		datablock = malloc(get_unaligned_le32(&sblk->block_size));
-		if (!datablock) {
-			ret = -ENOMEM;
-			goto out;
-		}
-	}
-
-	for (j = 0; j < datablk_count; j++) {
-		char *data_buffer;
-
-		start = lldiv(data_offset, ctxt.cur_dev->blksz);
-		table_size = SQFS_BLOCK_SIZE(finfo.blk_sizes[j]);
-		table_offset = data_offset - (start * ctxt.cur_dev->blksz);
-		n_blks = DIV_ROUND_UP(table_size + table_offset,
-				      ctxt.cur_dev->blksz);
-
-		/* Don't load any data for sparse blocks */
-		if (finfo.blk_sizes[j] == 0) {
-			n_blks = 0;
-			table_offset = 0;
-			data_buffer = NULL;
-			data = NULL;
-		} else {
-			data_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-			if (!data_buffer) {
-				ret = -ENOMEM;
-				goto out;
-			}
-
-			ret = sqfs_disk_read(start, n_blks, data_buffer);
-			if (ret < 0) {
-				/*
-				 * Possible causes: too many data blocks or too large
-				 * SquashFS block size. Tip: re-compile the SquashFS
-				 * image with mksquashfs's -b <block_size> option.
-				 */
-				printf("Error: too many data blocks to be read.\n");
-				goto out;
-			}
-
-			data = data_buffer + table_offset;
-		}
-
-		/* Load the data */
-		if (finfo.blk_sizes[j] == 0) {
-			/* This is a sparse block */
-			sparse_size = get_unaligned_le32(&sblk->block_size);
-			if ((*actread + sparse_size) > len)
-				sparse_size = len - *actread;
-			memset(buf + *actread, 0, sparse_size);
-			*actread += sparse_size;
-		} else if (SQFS_COMPRESSED_BLOCK(finfo.blk_sizes[j])) {
-			dest_len = get_unaligned_le32(&sblk->block_size);
-			ret = sqfs_decompress(&ctxt, datablock, &dest_len,
-					      data, table_size);
-			if (ret)
-				goto out;
-
-			if ((*actread + dest_len) > len)
-				dest_len = len - *actread;
-			memcpy(buf + *actread, datablock, dest_len);
-			*actread += dest_len;
-		} else {
-			if ((*actread + table_size) > len)
-				table_size = len - *actread;
-			memcpy(buf + *actread, data, table_size);
-			*actread += table_size;
-		}
-
-		data_offset += table_size;
-		free(data_buffer);
-		if (*actread >= len)
-			break;
-	}
+	ret = sqfs_read_data(&finfo, datablk_count, buf, len, actread);
+	if (ret)
+		goto out;
 
 	/*
 	 * There is no need to continue if the file is not fragmented.
@@ -1579,57 +1859,18 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 		goto out;
 	}
 
-	start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
-	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
-	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
-	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
-
-	if (__builtin_mul_overflow(n_blks, ctxt.cur_dev->blksz, &buf_size))
-		return -EINVAL;
-
-	fragment = malloc_cache_aligned(buf_size);
-
-	if (!fragment) {
-		ret = -ENOMEM;
+	ret = sqfs_read_fragment(&frag_entry, finfo.comp, &entry);
+	if (ret)
 		goto out;
-	}
 
-	ret = sqfs_disk_read(start, n_blks, fragment);
-	if (ret < 0)
+	if (finfo.offset + finfo.size - *actread > entry->len) {
+		ret = -EINVAL;
 		goto out;
-
-	/* File compressed and fragmented */
-	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
-		fragment_block = malloc(dest_len);
-		if (!fragment_block) {
-			ret = -ENOMEM;
-			goto out;
-		}
-
-		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
-				      (void *)fragment  + table_offset,
-				      frag_entry.size);
-		if (ret) {
-			free(fragment_block);
-			goto out;
-		}
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-
-		free(fragment_block);
-
-	} else if (finfo.frag && !finfo.comp) {
-		fragment_block = (void *)fragment + table_offset;
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
 	}
+	memcpy(buf + *actread, &entry->data[finfo.offset], finfo.size - *actread);
+	*actread = finfo.size;
 
 out:
-	free(fragment);
-	free(datablock);
 	free(file);
 	free(dir);
 	free(finfo.blk_sizes);
@@ -1794,6 +2035,7 @@ int sqfs_size(const char *filename, loff_t *size)
 
 void sqfs_close(void)
 {
+	sqfs_cache_free();
 	sqfs_decompressor_cleanup(&ctxt);
 	free(ctxt.sblk);
 	ctxt.sblk = NULL;
@@ -8,6 +8,7 @@
 #define BLK_H
 
 #include <bouncebuf.h>
+#include <errno.h>
 #include <dm/uclass-id.h>
 #include <efi.h>
 
@@ -23,6 +24,8 @@ typedef ulong lbaint_t;
 
 #define DEFAULT_BLKSZ		512
 
+struct blk_readahead;
+struct block_cache;
 struct udevice;
 
 static inline bool blk_enabled(void)
@@ -101,6 +104,47 @@ struct blk_desc {
 				       lbaint_t blkcnt);
 	void		*priv;		/* driver private struct pointer */
 #endif
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+	struct block_cache *cache;	/* block cache, allocated on first fill */
+#endif
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+	struct blk_readahead *ra;	/* readahead state, while reading a file */
+#endif
+};
+
+/**
+ * struct blk_req - an asynchronous block I/O request
+ *
+ * This is set up by blk_submit_read() or blk_submit_write() and stays owned by
+ * the caller, who must keep it (and the buffer) alive until blk_poll() returns
+ * 0 or blk_wait() returns.
+ *
+ * @dev:	Block device the request was submitted to
+ * @start:	Start block number
+ * @blkcnt:	Number of blocks to transfer
+ * @buffer:	Data buffer
+ * @write:	true for a write, false for a read
+ * @done:	true once the request has completed
+ * @result:	Number of blocks transferred, or -ve error, once @done is set
+ * @issued:	Number of blocks handed to the hardware so far (driver use)
+ * @pending:	Number of hardware commands in flight (driver use)
+ * @err:	First error seen by the driver, or 0 (driver use)
+ * @timestamp:	Time at which the request was submitted (driver use)
+ * @priv:	Driver-private data
+ */
+struct blk_req {
+	struct udevice *dev;
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	bool write;
+	bool done;
+	long result;
+	lbaint_t issued;
+	uint pending;
+	int err;
+	ulong timestamp;
+	void *priv;
 };
 
 #define BLOCK_CNT(size, blk_desc) (PAD_COUNT(size, blk_desc->blksz))
@@ -111,51 +155,51 @@ struct blk_desc {
 /**
  * blkcache_read() - attempt to read a set of blocks from cache
  *
- * @param iftype - uclass_id_x for type of device
- * @param dev - device index of particular type
- * @param start - starting block number
- * @param blkcnt - number of blocks to read
- * @param blksz - size in bytes of each block
- * @param buffer - buffer to contain cached data
+ * The blocks are returned if they lie anywhere within a cached run, not only
+ * if they match a previous fill exactly.
  *
- * Return: - 1 if block returned from cache, 0 otherwise.
+ * @desc: block device to read from
+ * @start: starting block number
+ * @blkcnt: number of blocks to read
+ * @buffer: buffer to contain cached data
+ *
+ * Return: 1 if block returned from cache, 0 otherwise.
  */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
+int blkcache_read(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		  void *buffer);
 
 /**
  * blkcache_fill() - make data read from a block device available
  * to the block cache
  *
- * @param iftype - uclass_id_x for type of device
- * @param dev - device index of particular type
- * @param start - starting block number
- * @param blkcnt - number of blocks available
- * @param blksz - size in bytes of each block
- * @param buffer - buffer containing data to cache
+ * The least-recently used entries of the device's cache are dropped as needed
+ * to keep it within the configured size.
  *
+ * @desc: block device the data was read from
+ * @start: starting block number
+ * @blkcnt: number of blocks available
+ * @buffer: buffer containing data to cache
  */
-void blkcache_fill(int iftype, int dev,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer);
+void blkcache_fill(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		   void const *buffer);
 
 /**
- * blkcache_invalidate() - discard the cache for a set of blocks
+ * blkcache_invalidate() - discard the cache for a block device
  * because of a write or device (re)initialization.
  *
- * @iftype - UCLASS_ID_ for type of device, or -1 for any
- * @dev - device index of particular type, if @iftype is not -1
+ * This also frees the per-device cache itself.
+ *
+ * @desc: block device whose cache should be discarded
  */
-void blkcache_invalidate(int iftype, int dev);
+void blkcache_invalidate(struct blk_desc *desc);
 
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @blocks: maximum blocks per entry
+ * @size: maximum number of bytes cached for each block device
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(unsigned blocks, unsigned long size);
 
 /*
  * statistics of the block cache
@@ -163,9 +207,11 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
-	unsigned entries; /* current entry count */
+	unsigned evictions; /* entries dropped to make room */
+	unsigned entries; /* current entry count, over all devices */
+	unsigned long size; /* bytes currently cached, over all devices */
 	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	unsigned long max_size; /* maximum bytes cached per device */
 };
 
 /**
@@ -180,23 +226,90 @@ void blkcache_free(void);
 
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline int blkcache_read(struct blk_desc *desc, lbaint_t start,
+				lbaint_t blkcnt, void *buffer)
 {
 	return 0;
 }
 
-static inline void blkcache_fill(int iftype, int dev,
-				 lbaint_t start, lbaint_t blkcnt,
-				 unsigned long blksz, void const *buffer) {}
+static inline void blkcache_fill(struct blk_desc *desc, lbaint_t start,
+				 lbaint_t blkcnt, void const *buffer) {}
 
-static inline void blkcache_invalidate(int iftype, int dev) {}
+static inline void blkcache_invalidate(struct blk_desc *desc) {}
 
 static inline void blkcache_free(void) {}
 
 #endif
 
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+/**
+ * blk_readahead_start() - start detecting sequential reads on a device
+ *
+ * This is called by fs_read() before a file is read. Nothing is read ahead
+ * until the reads are seen to be sequential.
+ *
+ * @desc: block device the file is on, or NULL if none
+ */
+void blk_readahead_start(struct blk_desc *desc);
+
+/**
+ * blk_readahead_stop() - stop reading ahead and free the readahead windows
+ *
+ * @desc: block device passed to blk_readahead_start(), or NULL
+ */
+void blk_readahead_stop(struct blk_desc *desc);
+
+/**
+ * blk_readahead_read() - attempt to read blocks through the readahead
+ *
+ * @desc: block device to read from
+ * @start: starting block number
+ * @blkcnt: number of blocks to read
+ * @buffer: buffer to contain the data
+ * Return: number of blocks read, -ENOENT if the caller should read the blocks
+ * from the device itself, other -ve on error
+ */
+long blk_readahead_read(struct blk_desc *desc, lbaint_t start,
+			lbaint_t blkcnt, void *buffer);
+
+/**
+ * blk_readahead_invalidate() - discard data read ahead from a device
+ *
+ * @desc: block device which is being written to
+ */
+void blk_readahead_invalidate(struct blk_desc *desc);
+
+/*
+ * statistics of the readahead
+ */
+struct blk_readahead_stats {
+	unsigned requests; /* reads seen while reading ahead */
+	unsigned merged; /* reads served entirely from a window */
+	unsigned reads; /* windows read from the device */
+};
+
+/**
+ * blk_readahead_stats() - return readahead statistics and reset them
+ *
+ * @stats: statistics are copied here
+ */
+void blk_readahead_stats(struct blk_readahead_stats *stats);
+
+#else
+
+static inline void blk_readahead_start(struct blk_desc *desc) {}
+static inline void blk_readahead_stop(struct blk_desc *desc) {}
+
+static inline long blk_readahead_read(struct blk_desc *desc, lbaint_t start,
+				      lbaint_t blkcnt, void *buffer)
+{
+	return -ENOENT;
+}
+
+static inline void blk_readahead_invalidate(struct blk_desc *desc) {}
+
+#endif
+
 struct udevice;
 
 /* Operations on block devices */
@@ -258,6 +371,37 @@ struct blk_ops {
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
 
+	/**
+	 * submit() - start an asynchronous read or write
+	 *
+	 * The request must be accepted even if the hardware queue is full at
+	 * present. Any part which cannot be issued yet should be issued from
+	 * poll() once there is room. This method is optional. Without it, or
+	 * if it returns -ENOSYS, the request is carried out synchronously by
+	 * read() or write().
+	 *
+	 * @dev:	Block device to use
+	 * @req:	Request to start. Only the fields set by the uclass are
+	 *		valid; the driver-use fields are zero
+	 * @return 0 if OK, -ENOSYS to fall back to synchronous I/O, other -ve
+	 * on error
+	 */
+	int (*submit)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * poll() - check for progress on an asynchronous request
+	 *
+	 * This should reap any completions available from the hardware, for
+	 * this and any other outstanding request, and issue more of @req if it
+	 * could not all be issued by submit(). It must not wait.
+	 *
+	 * @dev:	Block device to use
+	 * @req:	Request to check
+	 * @return 0 if @req has completed, with @req->result set, -EBUSY if it
+	 * is still in progress, other -ve on error
+	 */
+	int (*poll)(struct udevice *dev, struct blk_req *req);
+
 #if IS_ENABLED(CONFIG_BOUNCE_BUFFER)
 	/**
 	 * buffer_aligned() - test memory alignment of block operation buffer
@@ -331,6 +475,55 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
  */
 long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt);
 
+/**
+ * blk_submit_read() - Start reading from a block device
+ *
+ * This starts a read and returns without waiting for it to complete, so that
+ * the caller can submit further requests or do other work meanwhile. Devices
+ * which do not support asynchronous I/O complete the read before returning.
+ *
+ * @dev: Device to read from
+ * @start: Start block for the read
+ * @blkcnt: Number of blocks to read
+ * @buffer: Place to put the data
+ * @req: Returns the request, which must be passed to blk_poll() or blk_wait()
+ * Return: 0 if OK, -ve on error
+ */
+int blk_submit_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		    void *buffer, struct blk_req *req);
+
+/**
+ * blk_submit_write() - Start writing to a block device
+ *
+ * See blk_submit_read() for details
+ *
+ * @dev: Device to write to
+ * @start: Start block for the write
+ * @blkcnt: Number of blocks to write
+ * @buffer: Data to write, which must not change until the write completes
+ * @req: Returns the request, which must be passed to blk_poll() or blk_wait()
+ * Return: 0 if OK, -ve on error
+ */
+int blk_submit_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		     const void *buffer, struct blk_req *req);
+
+/**
+ * blk_poll() - Check whether an asynchronous request has completed
+ *
+ * @req: Request to check
+ * Return: 0 if completed (see @req->result), -EBUSY if still in progress
+ */
+int blk_poll(struct blk_req *req);
+
+/**
+ * blk_wait() - Wait for an asynchronous request to complete
+ *
+ * @req: Request to wait for
+ * Return: number of blocks transferred (which may be less than requested),
+ * or -ve on error
+ */
+long blk_wait(struct blk_req *req);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -528,8 +721,7 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
 	ulong blks_read;
-	if (blkcache_read(block_dev->uclass_id, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+	if (blkcache_read(block_dev, start, blkcnt, buffer))
 		return blkcnt;
 
 	/*
@@ -539,8 +731,7 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	 */
 	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->uclass_id, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
+		blkcache_fill(block_dev, start, blkcnt, buffer);
 
 	return blks_read;
 }
@@ -548,14 +739,14 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
-	blkcache_invalidate(block_dev->uclass_id, block_dev->devnum);
+	blkcache_invalidate(block_dev);
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
 static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
-	blkcache_invalidate(block_dev->uclass_id, block_dev->devnum);
+	blkcache_invalidate(block_dev);
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
@@ -68,6 +68,80 @@ int blkmap_map_mem(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
 int blkmap_map_pmem(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
 		    phys_addr_t paddr, bool preserve);
 
+/**
+ * blkmap_map_zero() - Map a sparse region reading as zeroes
+ *
+ * The region takes no memory. Writes to it fail.
+ *
+ * @dev: Blkmap to create the mapping on
+ * @blknr: Start block number of the mapping
+ * @blkcnt: Number of blocks to map
+ * Returns: 0 on success, negative error code on failure
+ */
+int blkmap_map_zero(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt);
+
+/**
+ * typedef blkmap_fill_fn - Fetch data backing a lazily populated mapping
+ *
+ * @priv: Private data passed to blkmap_map_lazy()
+ * @offset: Byte offset of the data from the start of the mapping
+ * @len: Number of bytes to fetch
+ * @buf: Buffer to store the data to
+ * Returns: 0 on success, negative error code on failure
+ */
+typedef int (*blkmap_fill_fn)(void *priv, u64 offset, ulong len, void *buf);
+
+/**
+ * blkmap_map_lazy() - Map a region populated on first access
+ *
+ * Data is fetched from the backing source with @fill when it is first
+ * read, in chunks of 1MiB. Up to CONFIG_BLKMAP_LAZY_CACHE_SIZE bytes of
+ * chunks are kept in memory, and the least recently used ones are
+ * dropped, so the whole region never needs to be resident. Reads of
+ * whole chunks which are not cached are fetched straight into the
+ * caller's buffer. Writes to the region fail.
+ *
+ * @dev: Blkmap to create the mapping on
+ * @blknr: Start block number of the mapping
+ * @blkcnt: Number of blocks to map
+ * @fill: Function fetching the backing data
+ * @release: Function called with @priv when the mapping is torn down,
+ *	     may be NULL
+ * @priv: Private data passed to @fill and @release
+ * Returns: 0 on success, negative error code on failure
+ */
+int blkmap_map_lazy(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
+		    blkmap_fill_fn fill, void (*release)(void *priv),
+		    void *priv);
+
+/**
+ * blkmap_map_file() - Map a file, e.g. an installer image
+ *
+ * If the filesystem can tell where the file is stored (see
+ * fs_get_extents()), the file is mapped as linear mappings of the device
+ * holding it, so that it is read without going through the filesystem.
+ * Holes in the file are mapped as zeroes. The mapping is only valid while
+ * the file is not changed.
+ *
+ * Otherwise this creates a lazily populated mapping (see blkmap_map_lazy())
+ * which reads the file with fs_read() as needed. Filesystems are not
+ * reentrant, so data which is not cached yet cannot be fetched while a
+ * filesystem is in use, e.g. while one stored on the blkmap itself is being
+ * read. Such reads fail with -EBUSY.
+ *
+ * Blocks past the end of the file read as zeroes. Writes to the mapping fail.
+ *
+ * @dev: Blkmap to create the mapping on
+ * @blknr: Start block number of the mapping
+ * @blkcnt: Number of blocks to map
+ * @desc: Block device holding the file
+ * @part: Partition holding the file, 0 for the whole device
+ * @path: Path to the file
+ * Returns: 0 on success, negative error code on failure
+ */
+int blkmap_map_file(struct udevice *dev, lbaint_t blknr, lbaint_t blkcnt,
+		    struct blk_desc *desc, int part, const char *path);
+
 /**
  * blkmap_from_label() - Find blkmap from label
  *
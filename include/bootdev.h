@@ -77,6 +77,9 @@ typedef int (*bootdev_hunter_func)(struct bootdev_hunter *info, bool show);
  * @uclass: Uclass ID for the media associated with this bootdev
  * @drv: bootdev driver for the things found by this hunter
  * @hunt: Function to call to hunt for bootdevs of this type (NULL if none)
+ * @serial: true if this hunter must not run alongside other hunters, e.g.
+ *	because it removes devices which they may be using. See
+ *	CONFIG_BOOTDEV_HUNT_PARALLEL
  *
  * Some bootdevs are not visible until other devices are enumerated. For
  * example, USB bootdevs only appear when the USB bus is enumerated.
@@ -93,6 +96,7 @@ struct bootdev_hunter {
 	enum uclass_id uclass;
 	struct driver *drv;
 	bootdev_hunter_func hunt;
+	bool serial;
 };
 
 /* declare a new bootdev hunter */
@@ -294,6 +298,18 @@ int bootdev_hunt(const char *spec, bool show);
  */
 int bootdev_hunt_prio(enum bootdev_prio_t prio, bool show);
 
+/**
+ * bootdev_hunt_upto() - Hunt for bootdevs up to a particular priority
+ *
+ * This runs all hunters which can find bootdevs of the given priority or a
+ * more preferred one, in parallel if CONFIG_BOOTDEV_HUNT_PARALLEL is enabled.
+ *
+ * @prio: Least preferred priority to hunt for
+ * @show: true to show each hunter as it is used
+ * Returns: 0 if OK, -ve on error
+ */
+int bootdev_hunt_upto(enum bootdev_prio_t prio, bool show);
+
 /**
  * bootdev_unhunt() - Mark a device as needing to be hunted again
  *
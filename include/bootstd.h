@@ -41,6 +41,8 @@ struct udevice;
  * @theme: Node containing the theme information
  * @hunters_used: Bitmask of used hunters, indexed by their position in the
  * linker list. The bit is set if the hunter has been used already
+ * @hunt_parallel: true to run hunters in their own threads when several are
+ * needed at once. This is set by CONFIG_BOOTDEV_HUNT_PARALLEL
  */
 struct bootstd_priv {
 	const char **prefixes;
@@ -54,6 +56,7 @@ struct bootstd_priv {
 	struct udevice *vbe_bootmeth;
 	ofnode theme;
 	uint hunters_used;
+	bool hunt_parallel;
 };
 
 /**
@@ -11,6 +11,7 @@
 
 #include <linux/bitops.h>
 #include <linux/errno.h>
+#include <linux/string.h>
 #include <linux/types.h>
 
 struct udevice;
@@ -342,4 +343,50 @@ static inline int dma_memcpy(void *dst, void *src, size_t len)
 	return -ENOSYS;
 }
 #endif /* CONFIG_DMA */
+
+#if CONFIG_IS_ENABLED(DMA_BULK_COPY)
+/**
+ * dma_bulk_copy_try() - copy a large area of memory with a DMA engine
+ *
+ * The area is only copied if the DMA engine can take it, as described for
+ * dma_bulk_copy(). Otherwise nothing is copied, so that the caller can copy
+ * it with the CPU in its own way.
+ *
+ * @dst:	Destination
+ * @src:	Source
+ * @len:	Number of bytes to copy
+ * Return: 0 if the area was copied, -EINVAL if it is too short, overlaps or
+ * is not equally aligned, other -ve value if no DMA engine could copy it
+ */
+int dma_bulk_copy_try(void *dst, const void *src, size_t len);
+
+/**
+ * dma_bulk_copy() - copy a large area of memory, using DMA where possible
+ *
+ * This is intended for moving images into place. Areas of at least
+ * CONFIG_DMA_BULK_COPY_MIN bytes are copied by a DMA engine supporting
+ * memory-to-memory transfers, if there is one. The caches are cleaned and
+ * invalidated as needed; since that works on whole cache lines, only the part
+ * of the destination made of whole lines is given to the DMA engine and the
+ * partial lines at either end are copied by the CPU. Overlapping areas, areas
+ * which are not equally aligned, and failed transfers are copied by the CPU.
+ *
+ * @dst:	Destination
+ * @src:	Source
+ * @len:	Number of bytes to copy
+ * Return: @dst
+ */
+void *dma_bulk_copy(void *dst, const void *src, size_t len);
+#else
+static inline int dma_bulk_copy_try(void *dst, const void *src, size_t len)
+{
+	return -ENOSYS;
+}
+
+static inline void *dma_bulk_copy(void *dst, const void *src, size_t len)
+{
+	return memmove(dst, src, len);
+}
+#endif
+
 #endif	/* _DMA_H_ */
@@ -35,6 +35,9 @@ struct disk_partition;
 #define EXT4_TOPDIR_FL		0x00020000 /* Top of directory hierarchies*/
 #define EXT4_EXTENTS_FL		0x00080000 /* Inode uses extents */
 #define EXT4_EXT_MAGIC			0xf30a
+#define EXT4_EXT_MAX_DEPTH		5
+/* Extents longer than this are uninitialised, with ee_len - EXT_INIT_MAX_LEN */
+#define EXT_INIT_MAX_LEN		(1 << 15)
 
 #define EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER  0x0001
 #define EXT4_FEATURE_RO_COMPAT_LARGE_FILE    0x0002
@@ -178,6 +181,45 @@ struct ext_block_cache {
 	int size;
 };
 
+/**
+ * struct ext4_extent_run - physically contiguous run of file blocks
+ *
+ * @block:	First logical block of the run
+ * @len:	Number of blocks in the run
+ * @start:	First physical block of the run
+ * @uninit:	true if the blocks are allocated but unwritten, so read as zero
+ */
+struct ext4_extent_run {
+	uint32_t block;
+	uint32_t len;
+	uint64_t start;
+	bool uninit;
+};
+
+/**
+ * struct ext4_extent_map - resolved extent tree of an inode
+ *
+ * Adjacent extents which are also adjacent on disk are merged into one run.
+ * Runs are sorted by logical block; blocks not covered by a run are holes.
+ *
+ * @valid:	true if the map describes @ino
+ * @data:	Filesystem holding the inode
+ * @ino:	Inode number
+ * @inode:	Copy of the inode the map was built from
+ * @count:	Number of runs
+ * @alloc:	Number of runs allocated in @runs
+ * @runs:	Runs, sorted by logical block
+ */
+struct ext4_extent_map {
+	bool valid;
+	struct ext2_data *data;
+	int ino;
+	struct ext2_inode inode;
+	uint count;
+	uint alloc;
+	struct ext4_extent_run *runs;
+};
+
 extern struct ext2_data *ext4fs_root;
 extern struct ext2fs_node *ext4fs_file;
 
@@ -205,11 +247,13 @@ void ext4fs_reinit_global(void);
 int ext4fs_ls(const char *dirname);
 int ext4fs_exists(const char *filename);
 int ext4fs_size(const char *filename, loff_t *size);
+int ext4fs_extents(const char *filename, fs_extent_fn fn, void *priv);
 void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot);
 int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, struct disk_partition *info);
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache);
+const struct ext4_extent_map *ext4fs_get_extent_map(struct ext2fs_node *node);
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 struct disk_partition *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
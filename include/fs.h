@@ -101,6 +101,18 @@ void fs_close(void);
  */
 int fs_get_type(void);
 
+/**
+ * fs_in_use() - Check whether a filesystem operation is in progress
+ *
+ * Filesystem drivers keep their state in global variables, so a filesystem
+ * must not be accessed while another one is being probed or used, e.g. from
+ * the read method of a block device.
+ *
+ * Return: true if a filesystem is being probed or has been set up with
+ * fs_set_blk_dev() and not closed yet, false otherwise
+ */
+bool fs_in_use(void);
+
 /**
  * fs_get_type_name() - Get type of current filesystem
  *
@@ -135,6 +147,36 @@ int fs_exists(const char *filename);
  */
 int fs_size(const char *filename, loff_t *size);
 
+/**
+ * typedef fs_extent_fn - Report a part of a file stored contiguously
+ *
+ * @priv: Private data passed to fs_get_extents()
+ * @offset: Offset of the extent in the file, in bytes
+ * @pos: Offset of the extent on the block device, in bytes
+ * @len: Length of the extent in bytes
+ * Return: 0 to go on, negative error code to stop
+ */
+typedef int (*fs_extent_fn)(void *priv, loff_t offset, u64 pos, u64 len);
+
+/**
+ * fs_get_extents() - Find where the data of a file is stored
+ *
+ * Calls @fn for each part of the file which is stored contiguously on the
+ * block device set by fs_set_blk_dev(), in file order. Parts without any data,
+ * which read as zeroes, are not reported. The last extent may run past the end
+ * of the file, up to the end of the filesystem block holding it.
+ *
+ * This lets the data of a file be read later without going through the
+ * filesystem. The extents are only valid while the file is not changed.
+ *
+ * @filename: Name of the file
+ * @fn: Function called for each extent
+ * @priv: Private data passed to @fn
+ * Return: 0 if OK, -EOPNOTSUPP if the filesystem does not support this, other
+ * negative error code on error, or the error returned by @fn
+ */
+int fs_get_extents(const char *filename, fs_extent_fn fn, void *priv);
+
 /**
  * fs_read() - read file from the partition previously set by fs_set_blk_dev()
  *
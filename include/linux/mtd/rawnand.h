@@ -43,6 +43,7 @@ int nand_scan_ident(struct mtd_info *mtd, int max_chips,
 int nand_scan_tail(struct mtd_info *mtd);
 
 /* Free resources held by the NAND device */
+void nand_cleanup(struct nand_chip *chip);
 void nand_release(struct mtd_info *mtd);
 
 /* Internal helper for board drivers which need to override command function */
@@ -100,6 +101,8 @@ void nand_wait_ready(struct mtd_info *mtd);
 #define NAND_CMD_READSTART	0x30
 #define NAND_CMD_RNDOUTSTART	0xE0
 #define NAND_CMD_CACHEDPROG	0x15
+#define NAND_CMD_READCACHESEQ	0x31
+#define NAND_CMD_READCACHEEND	0x3f
 
 /* Extended commands for AG-AND device */
 /*
@@ -200,6 +203,8 @@ enum nand_ecc_algo {
 #define NAND_CACHEPRG		0x00000008
 /* Chip has copy back function */
 #define NAND_COPYBACK		0x00000010
+/* Chip has cache read (READ CACHE SEQUENTIAL) function */
+#define NAND_CACHERD		0x00000020
 /*
  * Chip requires ready check on read (for auto-incremented sequential read).
  * True only for small page devices; large page devices do not support
@@ -233,6 +238,7 @@ enum nand_ecc_algo {
 
 /* Macros to identify the above */
 #define NAND_HAS_CACHEPROG(chip) ((chip->options & NAND_CACHEPRG))
+#define NAND_HAS_CACHEREAD(chip) ((chip->options & NAND_CACHERD))
 #define NAND_HAS_SUBPAGE_READ(chip) ((chip->options & NAND_SUBPAGE_READ))
 #define NAND_HAS_SUBPAGE_WRITE(chip) !((chip)->options & NAND_NO_SUBPAGE_WRITE)
 
@@ -304,7 +310,8 @@ enum nand_ecc_algo {
 /* ONFI subfeature parameters length */
 #define ONFI_SUBFEATURE_PARAM_LEN	4
 
-/* ONFI optional commands SET/GET FEATURES supported? */
+/* ONFI optional commands READ CACHE and SET/GET FEATURES supported? */
+#define ONFI_OPT_CMD_READ_CACHE		(1 << 1)
 #define ONFI_OPT_CMD_SET_GET_FEATURES	(1 << 2)
 
 struct nand_onfi_params {
@@ -671,6 +678,20 @@ struct nand_buffers {
 			      ARCH_DMA_MINALIGN)];
 };
 
+/**
+ * struct nand_cached_page - a decoded page held in the page cache
+ * @page:	page number, -1 if the entry is unused
+ * @bitflips:	maximum number of bitflips corrected in an ECC step
+ * @age:	value of the page cache tick when the entry was last used
+ * @data:	page data, after ECC correction
+ */
+struct nand_cached_page {
+	int page;
+	unsigned int bitflips;
+	unsigned int age;
+	uint8_t *data;
+};
+
 /**
  * struct nand_sdr_timings - SDR NAND chip timings
  *
@@ -864,6 +885,7 @@ struct nand_manufacturer_ops {
  *			bad block marker position; i.e., BBM == 11110111b is
  *			not bad when badblockbits == 7
  * @bits_per_cell:	[INTERN] number of bits per cell. i.e., 1 means SLC.
+ * @luns:		[INTERN] number of LUNs in one chip, 0 if not known
  * @ecc_strength_ds:	[INTERN] ECC correctability from the datasheet.
  *			Minimum amount of bit errors per @ecc_step_ds guaranteed
  *			to be correctable. If unknown, set to zero.
@@ -881,6 +903,11 @@ struct nand_manufacturer_ops {
  *			data_buf.
  * @pagebuf_bitflips:	[INTERN] holds the bitflip count for the page which is
  *			currently in data_buf.
+ * @page_cache:		[INTERN] decoded pages kept for partial reads, see
+ *			CONFIG_SYS_NAND_PAGE_CACHE
+ * @page_cache_size:	[INTERN] number of entries in @page_cache
+ * @page_cache_tick:	[INTERN] counter used to find the least recently used
+ *			entry of @page_cache
  * @subpagesize:	[INTERN] holds the subpagesize
  * @onfi_version:	[INTERN] holds the chip ONFI version (BCD encoded),
  *			non 0 if ONFI supported.
@@ -959,8 +986,12 @@ struct nand_chip {
 	int pagemask;
 	int pagebuf;
 	unsigned int pagebuf_bitflips;
+	struct nand_cached_page *page_cache;
+	int page_cache_size;
+	unsigned int page_cache_tick;
 	int subpagesize;
 	uint8_t bits_per_cell;
+	uint8_t luns;
 	uint16_t ecc_strength_ds;
 	uint16_t ecc_step_ds;
 	int onfi_timing_mode_default;
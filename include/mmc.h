@@ -66,6 +66,7 @@ struct bd_info;
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+#define MMC_CAP_CMD23		BIT(17)
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -73,6 +74,7 @@ struct bd_info;
 #define MMC_MODE_SPI		BIT(27)
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_CMD23_SUPPORT	0x00000002
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -483,6 +485,23 @@ struct dm_mmc_ops {
 	int (*send_cmd)(struct udevice *dev, struct mmc_cmd *cmd,
 			struct mmc_data *data);
 
+	/**
+	 * send_cmd_sbc() - Send a multi-block data command with a pre-defined
+	 *		    block count
+	 *
+	 * The host sends SET_BLOCK_COUNT (CMD23) for @data->blocks itself
+	 * right before @cmd, e.g. as an SDHCI auto-CMD23. If this method is
+	 * not provided, or returns -ENOSYS, CMD23 is sent as a command of its
+	 * own instead.
+	 *
+	 * @dev:	Device to receive the command
+	 * @cmd:	Read or write command to send
+	 * @data:	Data to send/receive
+	 * @return 0 if OK, -ENOSYS if not supported, other -ve on error
+	 */
+	int (*send_cmd_sbc)(struct udevice *dev, struct mmc_cmd *cmd,
+			    struct mmc_data *data);
+
 	/**
 	 * set_ios() - Set the I/O speed/width for an MMC device
 	 *
@@ -524,6 +543,25 @@ struct dm_mmc_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*execute_tuning)(struct udevice *dev, uint opcode);
+
+	/**
+	 * get_tuning() - Read back the result of the last tuning
+	 *
+	 * @dev:	Device to check
+	 * @tuning:	Returns a host-specific value which set_tuning() takes
+	 *		to restore the tuning
+	 * @return 0 if OK, -ENOSYS if not supported, other -ve on error
+	 */
+	int (*get_tuning)(struct udevice *dev, u32 *tuning);
+
+	/**
+	 * set_tuning() - Restore a result read back by get_tuning()
+	 *
+	 * @dev:	Device to update
+	 * @tuning:	Value returned by get_tuning() in the same bus mode
+	 * @return 0 if OK, -ENOSYS if not supported, other -ve on error
+	 */
+	int (*set_tuning)(struct udevice *dev, u32 tuning);
 #endif
 
 	/**
@@ -582,6 +620,8 @@ void mmc_send_init_stream(struct mmc *mmc);
 int mmc_getcd(struct mmc *mmc);
 int mmc_getwp(struct mmc *mmc);
 int mmc_execute_tuning(struct mmc *mmc, uint opcode);
+int mmc_get_tuning(struct mmc *mmc, u32 *tuning);
+int mmc_set_tuning(struct mmc *mmc, u32 tuning);
 int mmc_wait_dat0(struct mmc *mmc, int state, int timeout_us);
 int mmc_set_enhanced_strobe(struct mmc *mmc);
 int mmc_host_power_cycle(struct mmc *mmc);
@@ -590,6 +630,8 @@ int mmc_reinit(struct mmc *mmc);
 int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt);
 int mmc_hs400_prepare_ddr(struct mmc *mmc);
 int mmc_send_stop_transmission(struct mmc *mmc, bool write);
+int mmc_send_cmd_sbc(struct mmc *mmc, struct mmc_cmd *cmd,
+		     struct mmc_data *data);
 
 #else
 struct mmc_ops {
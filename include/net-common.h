@@ -5,6 +5,7 @@
 
 #include <asm/cache.h>
 #include <command.h>
+#include <errno.h>
 #include <hexdump.h>
 #include <linux/if_ether.h>
 #include <linux/sizes.h>
@@ -255,6 +256,10 @@ enum eth_recv_flags {
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
  *	     when the network stack is finished processing it. This will only be
  *	     called when no error was returned from recv - optional
+ * rx_refill: Give the buffers released with free_pkt back to the hardware.
+ *	      This is called once a burst of packets has been processed, so
+ *	      that the receive ring can be refilled in one go rather than
+ *	      after each packet - optional
  * stop: Stop the hardware from looking for packets - may be called even if
  *	 state == PASSIVE
  * mcast: Join or leave a multicast group (for TFTP) - optional
@@ -271,12 +276,19 @@ enum eth_recv_flags {
  * get_sset_count: Number of statistics counters
  * get_string: Names of the statistic counters
  * get_stats: The values of the statistic counters
+ * rx_place_stop: Take back the receive buffers which were set up with
+ *		  eth_rx_place_get() and have not been returned by recv() yet,
+ *		  so that nothing more is written to their destinations. Needed
+ *		  by drivers which keep such buffers posted after recv() returns
+ *		  - optional. Returns 0 if OK, or a negative error if the
+ *		  buffers could not be taken back
  */
 struct eth_ops {
 	int (*start)(struct udevice *dev);
 	int (*send)(struct udevice *dev, void *packet, int length);
 	int (*recv)(struct udevice *dev, int flags, uchar **packetp);
 	int (*free_pkt)(struct udevice *dev, uchar *packet, int length);
+	void (*rx_refill)(struct udevice *dev);
 	void (*stop)(struct udevice *dev);
 	int (*mcast)(struct udevice *dev, const u8 *enetaddr, int join);
 	int (*write_hwaddr)(struct udevice *dev);
@@ -285,6 +297,7 @@ struct eth_ops {
 	int (*get_sset_count)(struct udevice *dev);
 	void (*get_strings)(struct udevice *dev, u8 *data);
 	void (*get_stats)(struct udevice *dev, u64 *data);
+	int (*rx_place_stop)(struct udevice *dev);
 };
 
 #define eth_get_ops(dev) ((struct eth_ops *)(dev)->driver->ops)
@@ -301,6 +314,207 @@ int eth_initialize(void);		/* Initialize network subsystem */
 void eth_try_another(int first_restart);	/* Change the device */
 void eth_set_current(void);		/* set nterface to ethcur var */
 
+/**
+ * struct net_rx_place - where the payload of expected UDP packets belongs
+ *
+ * A protocol which knows where the data of the packets it is about to receive
+ * ends up describes them with this, so that drivers able to do so can receive
+ * the data straight into its destination. Each packet carries a sequence
+ * number, counting from 1, which identifies its destination.
+ *
+ * @hdr_len:	Number of bytes of UDP payload before the data, must be even
+ * @len:	Number of bytes of data in each packet, only packets of exactly
+ *		this size are placed
+ * @port:	Local UDP port the packets are sent to
+ * @next:	Returns the sequence number of the next packet expected
+ * @dest:	Returns the destination of the data of a packet, or NULL if it
+ *		has none (e.g. it is beyond the end of the file)
+ * @check:	Returns true if a packet is the one with the given sequence
+ *		number. The UDP header and the first @hdr_len bytes of the
+ *		payload can be inspected
+ */
+struct net_rx_place {
+	int hdr_len;
+	int len;
+	u16 port;
+	ulong (*next)(void);
+	void *(*dest)(ulong seq);
+	bool (*check)(struct ip_udp_hdr *ip, ulong seq);
+};
+
+/**
+ * struct eth_rx_dest - a destination handed to a driver for a receive buffer
+ *
+ * The first @hdr_len bytes of the frame go to the driver's packet buffer, the
+ * next @len bytes to @data and anything left over to the packet buffer again,
+ * straight after the header.
+ *
+ * @data:	Destination of the data
+ * @hdr_len:	Number of bytes of the frame before the data
+ * @len:	Number of bytes of data
+ * @seq:	Sequence number of the packet expected
+ */
+struct eth_rx_dest {
+	void *data;
+	int hdr_len;
+	int len;
+	ulong seq;
+};
+
+#if IS_ENABLED(CONFIG_NET_RX_PLACE)
+/**
+ * net_set_rx_place() - set where the payload of expected packets belongs
+ *
+ * Any receive buffer still set up for the previous description is taken back
+ * from the driver. If that fails, the driver may still write to the old
+ * destinations, so the data received there cannot be trusted.
+ *
+ * @place: Description of the packets, or NULL to stop placing them
+ * Return: 0 if OK, or a negative error if the driver could not take back its
+ * receive buffers
+ */
+int net_set_rx_place(const struct net_rx_place *place);
+
+/**
+ * net_rx_place_claim() - check that a received packet can be used
+ *
+ * A protocol must call this for each packet it is going to store. A packet
+ * whose destination is still handed out to the driver must not be stored
+ * there, since the driver may yet write another frame over it. It can be
+ * handed to net_rx_place_defer() instead, or dropped and sent again like any
+ * lost packet.
+ *
+ * @seq: Sequence number of the packet
+ * Return: true if the packet can be stored, false if its destination is busy
+ */
+bool net_rx_place_claim(ulong seq);
+
+/**
+ * net_rx_place_defer() - keep a packet until its destination is free
+ *
+ * The data is written to the destination of @seq once the receive buffer set
+ * up there has come back from the driver, or when placing stops. The protocol
+ * then treats the packet as stored, without writing it itself.
+ *
+ * @seq:	Sequence number of a packet refused by net_rx_place_claim()
+ * @data:	Payload of the packet
+ * @len:	Length of the payload
+ * Return: true if the data is kept, false if the packet must be dropped
+ */
+bool net_rx_place_defer(ulong seq, const void *data, int len);
+
+/**
+ * net_rx_payload() - find received data which may have been placed
+ *
+ * @ptr: Pointer into the packet being processed
+ * Return: where the byte at @ptr really is
+ */
+void *net_rx_payload(void *ptr);
+
+/**
+ * net_rx_hdr_len() - get the size of the UDP part of a placed packet header
+ *
+ * Return: number of bytes from the UDP header which are in the packet buffer,
+ * or 0 if the payload of the packet being processed was not placed
+ */
+int net_rx_hdr_len(void);
+
+/**
+ * eth_rx_place_get() - get a destination for a receive buffer
+ *
+ * @dev:	Ethernet device
+ * @ahead:	Number of packets the driver expects to receive before this
+ *		buffer is filled
+ * @dest:	Returns the destination
+ * Return: 0 if OK, -ENOENT if the buffer should be set up as usual
+ */
+int eth_rx_place_get(struct udevice *dev, int ahead, struct eth_rx_dest *dest);
+
+/**
+ * eth_rx_place_split() - report that a received frame was split
+ *
+ * Drivers call this from recv() when the frame returned was received into a
+ * buffer set up with eth_rx_place_get().
+ *
+ * @dest: Destination the buffer was set up with
+ */
+void eth_rx_place_split(const struct eth_rx_dest *dest);
+
+/**
+ * eth_rx_place_put() - give back a destination which was not received into
+ *
+ * Drivers call this for a destination from eth_rx_place_get() which they did
+ * not set up a receive buffer with, or whose buffer got part of a frame other
+ * than the one returned by recv(). Anything received there is ignored.
+ *
+ * @dest: Destination to give back
+ */
+void eth_rx_place_put(const struct eth_rx_dest *dest);
+
+/**
+ * eth_rx_place_prepare() - get ready for the next call to recv()
+ *
+ * This takes back the destination of a frame which recv() split but did not
+ * return, such as one dropped by a DSA tagger.
+ */
+void eth_rx_place_prepare(void);
+
+/**
+ * eth_rx_place_resolve() - get the packet to process after recv()
+ *
+ * @pkt:	Packet returned by recv()
+ * @len:	Length of the frame
+ * Return: packet to process, or NULL to drop it
+ */
+uchar *eth_rx_place_resolve(uchar *pkt, int len);
+
+/**
+ * eth_rx_place_done() - finish with the packet returned by recv()
+ */
+void eth_rx_place_done(void);
+#else
+static inline int net_set_rx_place(const struct net_rx_place *place)
+{
+	return 0;
+}
+
+static inline bool net_rx_place_claim(ulong seq)
+{
+	return true;
+}
+
+static inline bool net_rx_place_defer(ulong seq, const void *data, int len)
+{
+	return false;
+}
+
+static inline void *net_rx_payload(void *ptr)
+{
+	return ptr;
+}
+
+static inline int net_rx_hdr_len(void)
+{
+	return 0;
+}
+
+static inline int eth_rx_place_get(struct udevice *dev, int ahead,
+				   struct eth_rx_dest *dest)
+{
+	return -ENOENT;
+}
+
+static inline void eth_rx_place_split(const struct eth_rx_dest *dest) {}
+static inline void eth_rx_place_put(const struct eth_rx_dest *dest) {}
+static inline void eth_rx_place_prepare(void) {}
+static inline uchar *eth_rx_place_resolve(uchar *pkt, int len)
+{
+	return pkt;
+}
+
+static inline void eth_rx_place_done(void) {}
+#endif
+
 enum eth_state_t {
 	ETH_STATE_INIT,
 	ETH_STATE_PASSIVE,
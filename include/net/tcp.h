@@ -86,7 +86,6 @@ struct ip_tcp_hdr {
 #define TCP_OPT_LEN_8	0x08
 #define TCP_OPT_LEN_A	0x0a		/* Timestamp Length		*/
 #define TCP_MSS		1460		/* Max segment size		*/
-#define TCP_SCALE	0x01		/* Scale			*/
 
 /**
  * struct tcp_mss - TCP option structure for MSS (Max segment size)
@@ -352,12 +351,20 @@ enum tcp_status {
  *
  * @irs:		Initial receive sequence number
  * @rcv_nxt:		Receive next
- * @rcv_wnd:		Receive window (in bytes)
+ * @rcv_wnd:		Receive window (in bytes). The user may set it from
+ *			  the on_create() callback; the window scale sent in
+ *			  our SYN is chosen to cover it.
+ * @rcv_mss:		Largest segment received so far, used to tell
+ *			  full-sized segments for delayed ACKs
+ * @ack_pending:	Non-zero if an ACK has been delayed
+ * @ack_time:		Arrival time of the segment whose ACK is delayed (ticks)
  *
  * @loc_timestamp:	Local timestamp
  * @rmt_timestamp:	Remote timestamp
  *
+ * @loc_win_scale:	Local window scale factor
  * @rmt_win_scale:	Remote window scale factor
+ * @win_scale_ok:	Non-zero if the remote sent a window scale option
  *
  * @lost:		Used for SACK
  *
@@ -413,13 +420,20 @@ struct tcp_stream {
 	u32		irs;
 	u32		rcv_nxt;
 	u32		rcv_wnd;
+	u32		rcv_mss;
+
+	/* delayed ACK */
+	int		ack_pending;
+	ulong		ack_time;
 
 	/* TCP option timestamp */
 	u32		loc_timestamp;
 	u32		rmt_timestamp;
 
 	/* TCP window scale */
+	u8		loc_win_scale;
 	u8		rmt_win_scale;
+	u8		win_scale_ok;
 
 	/* TCP sliding window control used to request re-TX */
 	struct tcp_sack_v lost;
@@ -468,7 +482,9 @@ struct tcp_stream *tcp_stream_get(int is_new, struct in_addr rhost,
  * @rport:	Remote port, host byte order
  *
  * Returns: TCP new stream structure or NULL (if not created).
- *          Random local port will be used.
+ *          Random local port will be used, one which no other
+ *          stream uses. Up to CONFIG_PROT_TCP_STREAMS streams may
+ *          be open at the same time.
  */
 struct tcp_stream *tcp_stream_connect(struct in_addr rhost, u16 rport);
 
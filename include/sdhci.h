@@ -21,6 +21,7 @@
  */
 
 #define SDHCI_DMA_ADDRESS	0x00
+#define SDHCI_ARGUMENT2		SDHCI_DMA_ADDRESS
 
 #define SDHCI_BLOCK_SIZE	0x04
 #define  SDHCI_MAKE_BLKSZ(dma, blksz) (((dma & 0x7) << 12) | (blksz & 0xFFF))
@@ -33,6 +34,7 @@
 #define  SDHCI_TRNS_DMA		BIT(0)
 #define  SDHCI_TRNS_BLK_CNT_EN	BIT(1)
 #define  SDHCI_TRNS_ACMD12	BIT(2)
+#define  SDHCI_TRNS_AUTO_CMD23	BIT(3)
 #define  SDHCI_TRNS_READ	BIT(4)
 #define  SDHCI_TRNS_MULTI	BIT(5)
 
@@ -253,6 +255,10 @@
 #define SDHCI_QUIRK_SUPPORT_SINGLE	(1 << 10)
 /* Capability register bit-63 indicates HS400 support */
 #define SDHCI_QUIRK_CAPS_BIT63_FOR_HS400	BIT(11)
+/* The host cannot send SET_BLOCK_COUNT (CMD23) at all */
+#define SDHCI_QUIRK_NO_CMD23		BIT(12)
+/* Auto-CMD23 does not work, so CMD23 is sent as a command of its own */
+#define SDHCI_QUIRK_BROKEN_AUTO_CMD23	BIT(13)
 
 /* to make gcc happy */
 struct sdhci_host;
@@ -358,6 +364,7 @@ struct sdhci_host {
 #define USE_ADMA	(0x1 << 1)
 #define USE_ADMA64	(0x1 << 2)
 #define USE_DMA		(USE_SDMA | USE_ADMA | USE_ADMA64)
+#define USE_AUTO_CMD23	(0x1 << 3)
 	dma_addr_t adma_addr;
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	struct sdhci_adma_desc *adma_desc_table;
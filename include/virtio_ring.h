@@ -63,6 +63,10 @@ struct vring_desc_shadow {
 	u16 next;
 	/* Metadata about the descriptor. */
 	bool chain_head;
+	/* Buffer handed back by virtqueue_get_buf() for a chain head */
+	void *data;
+	/* Indirect descriptor table of a chain head, or NULL */
+	struct vring_desc *indir;
 };
 
 struct vring_avail {
@@ -103,6 +107,7 @@ struct vring {
  * @vring: actual memory layout for this queue
  * @vring_desc_shadow: guest-only copy of descriptors
  * @event: host publishes avail event idx
+ * @indirect: indirect descriptor tables can be used
  * @free_head: head of free buffer list
  * @num_added: number we've added since last sync
  * @last_used_idx: last used index we've seen
@@ -117,6 +122,7 @@ struct virtqueue {
 	struct vring vring;
 	struct vring_desc_shadow *vring_desc_shadow;
 	bool event;
+	bool indirect;
 	unsigned int free_head;
 	unsigned int num_added;
 	u16 last_used_idx;
@@ -187,6 +193,11 @@ struct virtio_sg;
  * @in_sgs:	the number of scatterlists which are writable
  *		(after readable ones)
  *
+ * If VIRTIO_RING_F_INDIRECT_DESC was negotiated, a chain of more than one
+ * buffer is placed in a separate descriptor table so that it only takes up
+ * a single slot of the ring. The other side is not notified; call
+ * virtqueue_kick() once all the buffers of a batch have been added.
+ *
  * Caller must ensure we don't call this with other virtqueue operations
  * at the same time (except where noted).
  *
@@ -201,7 +212,9 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
  * @vq:		the struct virtqueue
  *
  * After one or more virtqueue_add() calls, invoke this to kick
- * the other side.
+ * the other side. Nothing is done if no buffers were added since the last
+ * kick, or if the other side has said it does not need to be notified (see
+ * VIRTIO_RING_F_EVENT_IDX).
  *
  * Caller must ensure we don't call this with other virtqueue
  * operations at the same time (except where noted).
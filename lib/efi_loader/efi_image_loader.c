@@ -10,6 +10,7 @@
 #define LOG_CATEGORY LOGC_EFI
 
 #include <cpu_func.h>
+#include <dma.h>
 #include <efi_loader.h>
 #include <log.h>
 #include <malloc.h>
@@ -963,9 +964,8 @@ efi_status_t efi_load_pe(struct efi_loaded_image_obj *handle,
 			memset(efi_reloc + sec->VirtualAddress, 0,
 			       sec->Misc.VirtualSize);
 		}
-		memcpy(efi_reloc + sec->VirtualAddress,
-		       efi + sec->PointerToRawData,
-		       copy_size);
+		dma_bulk_copy(efi_reloc + sec->VirtualAddress,
+			      efi + sec->PointerToRawData, copy_size);
 	}
 
 	/* Run through relocations */
@@ -218,6 +218,14 @@ static int dsa_port_free_pkt(struct udevice *pdev, uchar *packet, int length)
 	return 0;
 }
 
+static void dsa_port_rx_refill(struct udevice *pdev)
+{
+	struct udevice *master = dsa_get_master(dev_get_parent(pdev));
+
+	if (eth_get_ops(master)->rx_refill)
+		eth_get_ops(master)->rx_refill(master);
+}
+
 static int dsa_port_of_to_pdata(struct udevice *pdev)
 {
 	struct dsa_port_pdata *port_pdata;
@@ -255,6 +263,7 @@ static const struct eth_ops dsa_port_ops = {
 	.recv		= dsa_port_recv,
 	.stop		= dsa_port_stop,
 	.free_pkt	= dsa_port_free_pkt,
+	.rx_refill	= dsa_port_rx_refill,
 };
 
 /*
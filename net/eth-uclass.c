@@ -438,7 +438,7 @@ int eth_send(void *packet, int length)
 int eth_rx(void)
 {
 	struct udevice *current;
-	uchar *packet;
+	uchar *packet, *pkt;
 	int flags;
 	int ret;
 	int i;
@@ -450,13 +450,19 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
-	/* Process up to 32 packets at one time */
+	/* Process up to CONFIG_NET_RX_BUDGET packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
+	for (i = 0; i < CONFIG_NET_RX_BUDGET; i++) {
+		eth_rx_place_prepare();
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
-		if (ret > 0)
-			net_process_received_packet(packet, ret);
+		if (ret > 0) {
+			/* the payload may have been received in place */
+			pkt = eth_rx_place_resolve(packet, ret);
+			if (pkt)
+				net_process_received_packet(pkt, ret);
+			eth_rx_place_done();
+		}
 		if (ret >= 0 && eth_get_ops(current)->free_pkt)
 			eth_get_ops(current)->free_pkt(current, packet, ret);
 		if (ret <= 0)
@@ -464,6 +470,9 @@ int eth_rx(void)
 		if (!eth_is_active(current))
 			break;
 	}
+	/* Hand the buffers of the whole burst back to the hardware */
+	if (eth_get_ops(current)->rx_refill)
+		eth_get_ops(current)->rx_refill(current);
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
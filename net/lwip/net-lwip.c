@@ -332,7 +332,7 @@ int net_lwip_rx(struct udevice *udev, struct netif *netif)
 		return -EINVAL;
 
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
+	for (i = 0; i < CONFIG_NET_RX_BUDGET; i++) {
 		len = eth_get_ops(udev)->recv(udev, flags, &packet);
 		flags = 0;
 
@@ -353,6 +353,8 @@ int net_lwip_rx(struct udevice *udev, struct netif *netif)
 		if (len <= 0)
 			break;
 	}
+	if (eth_get_ops(udev)->rx_refill)
+		eth_get_ops(udev)->rx_refill(udev);
 	if (len == -EAGAIN)
 		len = 0;
 
@@ -392,6 +392,7 @@ static void net_clear_handlers(void)
 	net_set_udp_handler(NULL);
 	net_set_arp_handler(NULL);
 	net_set_timeout_handler(0, NULL);
+	net_set_rx_place(NULL);
 }
 
 static void net_cleanup_loop(void)
@@ -1208,6 +1209,21 @@ static void receive_icmp(struct ip_udp_hdr *ip, int len,
 	}
 }
 
+/* Add bytes to a UDP checksum, @len is even unless this is the last call */
+static ulong udp_csum_add(ulong xsum, const u8 *sumptr, ushort sumlen)
+{
+	while (sumlen > 1) {
+		/* inlined ntohs() to avoid alignment errors */
+		xsum += (sumptr[0] << 8) + sumptr[1];
+		sumptr += 2;
+		sumlen -= 2;
+	}
+	if (sumlen > 0)
+		xsum += (sumptr[0] << 8) + sumptr[0];
+
+	return xsum;
+}
+
 void net_process_received_packet(uchar *in_packet, int len)
 {
 	struct ethernet_hdr *et;
@@ -1426,6 +1442,7 @@ void net_process_received_packet(uchar *in_packet, int len)
 			ulong   xsum;
 			u8 *sumptr;
 			ushort  sumlen;
+			int split;
 
 			xsum  = ip->ip_p;
 			xsum += (ntohs(ip->udp_len));
@@ -1437,14 +1454,14 @@ void net_process_received_packet(uchar *in_packet, int len)
 			sumlen = ntohs(ip->udp_len);
 			sumptr = (u8 *)&ip->udp_src;
 
-			while (sumlen > 1) {
-				/* inlined ntohs() to avoid alignment errors */
-				xsum += (sumptr[0] << 8) + sumptr[1];
-				sumptr += 2;
-				sumlen -= 2;
+			/* a placed payload is apart from the header */
+			split = net_rx_hdr_len();
+			if (split) {
+				xsum = udp_csum_add(xsum, sumptr, split);
+				sumptr = net_rx_payload(sumptr + split);
+				sumlen -= split;
 			}
-			if (sumlen > 0)
-				xsum += (sumptr[0] << 8) + sumptr[0];
+			xsum = udp_csum_add(xsum, sumptr, sumlen);
 			while ((xsum >> 16) != 0) {
 				xsum = (xsum & 0x0000ffff) +
 				       ((xsum >> 16) & 0x0000ffff);
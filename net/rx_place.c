@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Receiving the payload of UDP packets in place
+ *
+ * A protocol which knows where the data of upcoming packets belongs describes
+ * them with a struct net_rx_place. A driver which can scatter a frame over
+ * several buffers asks for the destination of a packet it expects with
+ * eth_rx_place_get() and sets up a receive buffer whose data part is that
+ * destination, so the data does not have to be copied out of a packet buffer.
+ *
+ * The destination is only a guess. If the frame received is not the packet
+ * expected, it is put back together in a packet buffer and handled as usual;
+ * the destination is written again once the right packet arrives. A packet
+ * which arrives while its own destination is still handed out is kept aside
+ * and written there once that buffer comes back.
+ */
+
+#include <dm.h>
+#include <log.h>
+#include <malloc.h>
+#include <net.h>
+#include <net/pcap.h>
+#include <linux/kernel.h>
+
+/* Maximum number of destinations handed out at once */
+#define RX_PLACE_MAX_POSTED	64
+/* Maximum number of packets kept until their destination comes back */
+#define RX_PLACE_MAX_DEFERRED	16
+
+/**
+ * struct rx_place_deferred - a packet waiting for its destination
+ *
+ * @seq:	Sequence number of the packet, 0 if the entry is free
+ * @dest:	Destination of the packet
+ * @len:	Length of the payload
+ */
+struct rx_place_deferred {
+	ulong seq;
+	void *dest;
+	int len;
+};
+
+static const struct net_rx_place *rx_place;
+/* Device holding the destinations handed out */
+static struct udevice *rx_place_dev;
+/* Highest sequence number claimed by the protocol */
+static ulong rx_place_claimed;
+/* Sequence numbers handed out and not received yet */
+static ulong rx_posted[RX_PLACE_MAX_POSTED];
+static int rx_nposted;
+/* Destination of the frame returned by the last recv(), if split */
+static struct eth_rx_dest rx_split;
+static bool rx_split_valid;
+/* Packet being processed, if its data was placed */
+static uchar *rx_placed_pkt;
+static struct eth_rx_dest rx_placed;
+/* Buffer to put split frames back together */
+static uchar rx_place_buf[PKTSIZE_ALIGN] __aligned(PKTALIGN);
+/* Packets kept until their destination comes back, with their payloads */
+static struct rx_place_deferred rx_deferred[RX_PLACE_MAX_DEFERRED];
+static uchar *rx_deferred_buf;
+
+/* Write a kept packet to its destination, or just forget it */
+static void rx_place_put_deferred(ulong seq, bool write)
+{
+	struct rx_place_deferred *def;
+	int i;
+
+	for (i = 0; i < RX_PLACE_MAX_DEFERRED; i++) {
+		def = &rx_deferred[i];
+		if (!def->seq || (seq && def->seq != seq))
+			continue;
+		if (write)
+			memcpy(def->dest, rx_deferred_buf + i * PKTSIZE_ALIGN,
+			       def->len);
+		def->seq = 0;
+	}
+}
+
+int net_set_rx_place(const struct net_rx_place *place)
+{
+	struct udevice *dev = rx_place_dev;
+	int ret = 0;
+
+	rx_place = NULL;
+	if (rx_nposted && eth_get_ops(dev)->rx_place_stop) {
+		ret = eth_get_ops(dev)->rx_place_stop(dev);
+		if (ret)
+			log_err("%s: Cannot take back receive buffers (err=%d)\n",
+				dev->name, ret);
+	}
+	/* the driver no longer writes to any destination */
+	rx_place_put_deferred(0, true);
+	if (!place) {
+		free(rx_deferred_buf);
+		rx_deferred_buf = NULL;
+	}
+	rx_nposted = 0;
+	rx_place_dev = NULL;
+	rx_place_claimed = 0;
+	/* never hand out more destinations to a driver in that state */
+	if (!ret)
+		rx_place = place;
+
+	return ret;
+}
+
+static int rx_place_find(ulong seq)
+{
+	int i;
+
+	for (i = 0; i < rx_nposted; i++) {
+		if (rx_posted[i] == seq)
+			return i;
+	}
+
+	return -ENOENT;
+}
+
+bool net_rx_place_claim(ulong seq)
+{
+	if (rx_place_find(seq) >= 0)
+		return false;
+	rx_place_claimed = max(rx_place_claimed, seq);
+
+	return true;
+}
+
+bool net_rx_place_defer(ulong seq, const void *data, int len)
+{
+	struct rx_place_deferred *def = NULL;
+	void *dest;
+	int i;
+
+	if (!rx_place || len > rx_place->len || len > PKTSIZE_ALIGN ||
+	    rx_place_find(seq) < 0)
+		return false;
+
+	if (!rx_deferred_buf) {
+		rx_deferred_buf = malloc(RX_PLACE_MAX_DEFERRED * PKTSIZE_ALIGN);
+		if (!rx_deferred_buf)
+			return false;
+	}
+
+	for (i = 0; i < RX_PLACE_MAX_DEFERRED; i++) {
+		if (rx_deferred[i].seq == seq) {
+			def = &rx_deferred[i];
+			break;
+		}
+		if (!def && !rx_deferred[i].seq)
+			def = &rx_deferred[i];
+	}
+	if (!def)
+		return false;
+
+	dest = rx_place->dest(seq);
+	if (!dest)
+		return false;
+
+	memcpy(rx_deferred_buf + (def - rx_deferred) * PKTSIZE_ALIGN, data,
+	       len);
+	def->seq = seq;
+	def->dest = dest;
+	def->len = len;
+	/* the packet counts as stored, so its destination is not handed out */
+	rx_place_claimed = max(rx_place_claimed, seq);
+
+	return true;
+}
+
+void *net_rx_payload(void *ptr)
+{
+	uchar *end;
+
+	if (!rx_placed_pkt)
+		return ptr;
+	end = rx_placed_pkt + rx_placed.hdr_len;
+	if ((uchar *)ptr < end)
+		return ptr;
+
+	return rx_placed.data + ((uchar *)ptr - end);
+}
+
+int net_rx_hdr_len(void)
+{
+	if (!rx_placed_pkt)
+		return 0;
+
+	return rx_placed.hdr_len - ETHER_HDR_SIZE - IP_HDR_SIZE;
+}
+
+int eth_rx_place_get(struct udevice *dev, int ahead, struct eth_rx_dest *dest)
+{
+	ulong seq;
+	void *data;
+
+	/*
+	 * Only the current device is handled: frames received by a DSA master
+	 * are not handed to the stack as they came in
+	 */
+	if (!rx_place || rx_nposted == RX_PLACE_MAX_POSTED ||
+	    dev != eth_get_dev() || (rx_place_dev && rx_place_dev != dev))
+		return -ENOENT;
+
+	/*
+	 * Never hand out the destination of a packet which may have been
+	 * stored already, since another frame may be written over it
+	 */
+	seq = max(rx_place->next() + ahead, rx_place_claimed + 1);
+	while (rx_place_find(seq) >= 0)
+		seq++;
+	data = rx_place->dest(seq);
+	if (!data)
+		return -ENOENT;
+
+	rx_posted[rx_nposted++] = seq;
+	rx_place_dev = dev;
+	dest->data = data;
+	dest->hdr_len = ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + rx_place->hdr_len;
+	dest->len = rx_place->len;
+	dest->seq = seq;
+
+	return 0;
+}
+
+void eth_rx_place_split(const struct eth_rx_dest *dest)
+{
+	rx_split = *dest;
+	rx_split_valid = true;
+}
+
+static void rx_place_unpost(ulong seq)
+{
+	int i = rx_place_find(seq);
+
+	if (i < 0)
+		return;
+	rx_posted[i] = rx_posted[--rx_nposted];
+	if (!rx_nposted)
+		rx_place_dev = NULL;
+}
+
+void eth_rx_place_put(const struct eth_rx_dest *dest)
+{
+	rx_place_unpost(dest->seq);
+	rx_place_put_deferred(dest->seq, true);
+}
+
+/* Check that a split frame is the packet expected in its destination */
+static bool rx_place_match(uchar *pkt, int len, const struct eth_rx_dest *dest)
+{
+	struct ethernet_hdr *et = (struct ethernet_hdr *)pkt;
+	struct ip_udp_hdr *ip = (struct ip_udp_hdr *)(pkt + ETHER_HDR_SIZE);
+
+	if (!rx_place || (rx_place->hdr_len & 1) ||
+	    dest->hdr_len != ETHER_HDR_SIZE + IP_UDP_HDR_SIZE +
+			     rx_place->hdr_len ||
+	    dest->len != rx_place->len || len < dest->hdr_len + dest->len)
+		return false;
+
+	/* the capture needs the whole frame in one piece */
+	if (IS_ENABLED(CONFIG_CMD_PCAP) && pcap_active())
+		return false;
+
+	if (ntohs(et->et_protlen) != PROT_IP || ip->ip_hl_v != 0x45 ||
+	    ip->ip_p != IPPROTO_UDP ||
+	    (ntohs(ip->ip_off) & (IP_OFFS | IP_FLAGS_MFRAG)))
+		return false;
+	if (ntohs(ip->udp_dst) != rx_place->port ||
+	    ntohs(ip->udp_len) != UDP_HDR_SIZE + rx_place->hdr_len +
+				  rx_place->len)
+		return false;
+
+	return rx_place->check(ip, dest->seq);
+}
+
+uchar *eth_rx_place_resolve(uchar *pkt, int len)
+{
+	const struct eth_rx_dest *dest = &rx_split;
+	int hdr, data;
+
+	if (!rx_split_valid)
+		return pkt;
+	rx_split_valid = false;
+	rx_place_unpost(dest->seq);
+
+	if (rx_place_match(pkt, len, dest)) {
+		/* the packet is in place again, so a kept copy is not needed */
+		rx_place_put_deferred(dest->seq, false);
+		rx_placed = *dest;
+		rx_placed_pkt = pkt;
+		return pkt;
+	}
+
+	/* not the packet expected, so put the frame back together */
+	if (len > PKTSIZE_ALIGN) {
+		log_debug("Dropping split frame of %d bytes\n", len);
+		rx_place_put_deferred(dest->seq, true);
+		return NULL;
+	}
+	hdr = min(len, dest->hdr_len);
+	data = min(len - hdr, dest->len);
+	memcpy(rx_place_buf, pkt, hdr);
+	memcpy(rx_place_buf + hdr, dest->data, data);
+	memcpy(rx_place_buf + hdr + data, pkt + hdr, len - hdr - data);
+	rx_place_put_deferred(dest->seq, true);
+
+	return rx_place_buf;
+}
+
+void eth_rx_place_prepare(void)
+{
+	if (!rx_split_valid)
+		return;
+
+	/* recv() dropped the frame, so its buffer is back */
+	rx_split_valid = false;
+	rx_place_unpost(rx_split.seq);
+	rx_place_put_deferred(rx_split.seq, true);
+}
+
+void eth_rx_place_done(void)
+{
+	rx_placed_pkt = NULL;
+}
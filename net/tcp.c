@@ -36,6 +36,9 @@
 #define TCP_SEND_RETRY		3
 #define TCP_SEND_TIMEOUT	2000UL
 #define TCP_RX_INACTIVE_TIMEOUT	30000UL
+#define TCP_DELAYED_ACK_TIMEOUT	20UL
+#define TCP_MAX_WIN_SCALE	14
+#define TCP_DEFAULT_RCV_MSS	536	/* RFC 1122, section 4.2.2.6 */
 #if PKTBUFSRX != 0
   #define TCP_RCV_WND_SIZE	(PKTBUFSRX * TCP_MSS)
 #else
@@ -45,7 +48,7 @@
 #define TCP_PACKET_OK		0
 #define TCP_PACKET_DROP		1
 
-static struct tcp_stream tcp_stream;
+static struct tcp_stream tcp_streams[CONFIG_PROT_TCP_STREAMS];
 
 static int (*tcp_stream_on_create)(struct tcp_stream *tcp);
 
@@ -76,6 +79,40 @@ static uint random_port(void)
 	return RANDOM_PORT_START + (get_timer(0) % RANDOM_PORT_RANGE);
 }
 
+/*
+ * A stream is in use until it has been destroyed, which keeps it from being
+ * handed out again while its on_closed() callback runs
+ */
+static bool tcp_stream_is_free(struct tcp_stream *tcp)
+{
+	return tcp->state == TCP_CLOSED && !tcp->rhost.s_addr;
+}
+
+static bool tcp_port_in_use(u16 lport)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tcp_streams); i++) {
+		if (!tcp_stream_is_free(&tcp_streams[i]) &&
+		    tcp_streams[i].lport == lport)
+			return true;
+	}
+
+	return false;
+}
+
+/* Pick a local port which no other stream uses */
+static uint tcp_new_port(void)
+{
+	uint port = random_port();
+
+	while (tcp_port_in_use(port))
+		port = RANDOM_PORT_START +
+		       (port + 1 - RANDOM_PORT_START) % RANDOM_PORT_RANGE;
+
+	return port;
+}
+
 static inline s32 tcp_seq_cmp(u32 a, u32 b)
 {
 	return (s32)(a - b);
@@ -156,6 +193,7 @@ static void tcp_stream_init(struct tcp_stream *tcp,
 	tcp->state = TCP_CLOSED;
 	tcp->lost.len = TCP_OPT_LEN_2;
 	tcp->rcv_wnd = TCP_RCV_WND_SIZE;
+	tcp->rcv_mss = TCP_DEFAULT_RCV_MSS;
 	tcp->max_retry_count = TCP_SEND_RETRY;
 	tcp->initial_timeout = TCP_SEND_TIMEOUT;
 	tcp->rx_inactiv_timeout = TCP_RX_INACTIVE_TIMEOUT;
@@ -172,17 +210,21 @@ static void tcp_stream_destroy(struct tcp_stream *tcp)
 void tcp_init(void)
 {
 	static int initialized;
-	struct tcp_stream *tcp = &tcp_stream;
+	struct tcp_stream *tcp;
+	int i;
 
 	tcp_stream_on_create = NULL;
 	if (!initialized) {
 		initialized = 1;
-		memset(tcp, 0, sizeof(struct tcp_stream));
+		memset(tcp_streams, 0, sizeof(tcp_streams));
 	}
 
-	tcp_stream_set_state(tcp, TCP_CLOSED);
-	tcp_stream_set_status(tcp, TCP_ERR_RST);
-	tcp_stream_destroy(tcp);
+	for (i = 0; i < ARRAY_SIZE(tcp_streams); i++) {
+		tcp = &tcp_streams[i];
+		tcp_stream_set_state(tcp, TCP_CLOSED);
+		tcp_stream_set_status(tcp, TCP_ERR_RST);
+		tcp_stream_destroy(tcp);
+	}
 }
 
 void tcp_stream_set_on_create_handler(int (*on_create)(struct tcp_stream *))
@@ -193,28 +235,42 @@ void tcp_stream_set_on_create_handler(int (*on_create)(struct tcp_stream *))
 static struct tcp_stream *tcp_stream_add(struct in_addr rhost,
 					 u16 rport, u16 lport)
 {
-	struct tcp_stream *tcp = &tcp_stream;
+	struct tcp_stream *tcp;
+	int i;
 
-	if (!tcp_stream_on_create ||
-	    tcp->state != TCP_CLOSED)
+	if (!tcp_stream_on_create)
 		return NULL;
 
-	tcp_stream_init(tcp, rhost, rport, lport);
-	if (!tcp_stream_on_create(tcp))
-		return NULL;
+	for (i = 0; i < ARRAY_SIZE(tcp_streams); i++) {
+		tcp = &tcp_streams[i];
+		if (!tcp_stream_is_free(tcp))
+			continue;
 
-	return tcp;
+		tcp_stream_init(tcp, rhost, rport, lport);
+		if (!tcp_stream_on_create(tcp)) {
+			memset(tcp, 0, sizeof(struct tcp_stream));
+			return NULL;
+		}
+
+		return tcp;
+	}
+
+	return NULL;
 }
 
 struct tcp_stream *tcp_stream_get(int is_new, struct in_addr rhost,
 				  u16 rport, u16 lport)
 {
-	struct tcp_stream *tcp = &tcp_stream;
+	struct tcp_stream *tcp;
+	int i;
 
-	if (tcp->rhost.s_addr == rhost.s_addr &&
-	    tcp->rport == rport &&
-	    tcp->lport == lport)
-		return tcp;
+	for (i = 0; i < ARRAY_SIZE(tcp_streams); i++) {
+		tcp = &tcp_streams[i];
+		if (tcp->rhost.s_addr == rhost.s_addr &&
+		    tcp->rport == rport &&
+		    tcp->lport == lport)
+			return tcp;
+	}
 
 	return is_new ? tcp_stream_add(rhost, rport, lport) : NULL;
 }
@@ -281,6 +337,8 @@ static void tcp_stream_set_time_handler(struct tcp_stream *tcp, ulong msec,
 static void tcp_send_packet(struct tcp_stream *tcp, u8 action,
 			    u32 tcp_seq_num, u32 tcp_ack_num, u32 tx_len)
 {
+	/* every segment carries rcv_nxt, so nothing is left to acknowledge */
+	tcp->ack_pending = 0;
 	tcp->tx_packets++;
 	net_send_tcp_packet(tx_len, tcp->rhost, tcp->rport,
 			    tcp->lport, action, tcp_seq_num,
@@ -417,6 +475,12 @@ static void tcp_stream_poll(struct tcp_stream *tcp, ulong time)
 		return;
 	}
 
+	/* handle delayed ACK timeout */
+	if (tcp->ack_pending &&
+	    time - tcp->ack_time >= msec_to_ticks(TCP_DELAYED_ACK_TIMEOUT))
+		tcp_send_packet(tcp, tcp_stream_fin_needed(tcp, tcp->snd_una) |
+				TCP_ACK, tcp->snd_una, tcp->rcv_nxt, 0);
+
 	/* handle retransmit timeout */
 	if (tcp->time_handler &&
 	    time - tcp->time_start >= tcp->time_delta) {
@@ -431,11 +495,11 @@ static void tcp_stream_poll(struct tcp_stream *tcp, ulong time)
 void tcp_streams_poll(void)
 {
 	ulong			time;
-	struct tcp_stream	*tcp;
+	int			i;
 
 	time = get_timer(0);
-	tcp = &tcp_stream;
-	tcp_stream_poll(tcp, time);
+	for (i = 0; i < ARRAY_SIZE(tcp_streams); i++)
+		tcp_stream_poll(&tcp_streams[i], time);
 }
 
 /**
@@ -548,8 +612,14 @@ void net_set_syn_options(struct tcp_stream *tcp, union tcp_build_pkt *b)
 	b->ip.mss.kind = TCP_O_MSS;
 	b->ip.mss.len = TCP_OPT_LEN_4;
 	b->ip.mss.mss = htons(TCP_MSS);
+
+	/* smallest scale which lets the whole window be advertised */
+	tcp->rcv_wnd = min_t(u32, tcp->rcv_wnd, U16_MAX << TCP_MAX_WIN_SCALE);
+	tcp->loc_win_scale = 0;
+	while (tcp->rcv_wnd >> tcp->loc_win_scale > U16_MAX)
+		tcp->loc_win_scale++;
 	b->ip.scale.kind = TCP_O_SCL;
-	b->ip.scale.scale = TCP_SCALE;
+	b->ip.scale.scale = tcp->loc_win_scale;
 	b->ip.scale.len = TCP_OPT_LEN_3;
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK)) {
 		b->ip.sack_p.kind = TCP_P_SACK;
@@ -589,6 +659,26 @@ const char *tcpflags_to_str(char tcpflags, char *buf, int size)
 	return buf;
 }
 
+/**
+ * tcp_rcv_wnd_field() - receive window as advertised in a segment
+ * @tcp: tcp stream
+ * @action: TCP flags of the segment
+ *
+ * The window in a SYN segment is never scaled (RFC 7323). Afterwards our
+ * scale is only used if the peer sent a window scale option as well.
+ *
+ * Return: value for the window field of the TCP header
+ */
+static u16 tcp_rcv_wnd_field(struct tcp_stream *tcp, u8 action)
+{
+	u32 wnd = tcp->rcv_wnd;
+
+	if (!(action & TCP_SYN) && tcp->win_scale_ok)
+		wnd >>= tcp->loc_win_scale;
+
+	return min_t(u32, wnd, U16_MAX);
+}
+
 int tcp_set_tcp_header(struct tcp_stream *tcp, uchar *pkt, int payload_len,
 		       u8 action, u32 tcp_seq_num, u32 tcp_ack_num)
 {
@@ -656,7 +746,7 @@ int tcp_set_tcp_header(struct tcp_stream *tcp, uchar *pkt, int payload_len,
 	 * it is, then the u-boot tftp or nfs kernel netboot should be
 	 * considered.
 	 */
-	b->ip.hdr.tcp_win = htons(tcp->rcv_wnd >> TCP_SCALE);
+	b->ip.hdr.tcp_win = htons(tcp_rcv_wnd_field(tcp, action));
 
 	b->ip.hdr.tcp_xsum = 0;
 	b->ip.hdr.tcp_ugr = 0;
@@ -795,7 +885,9 @@ void tcp_parse_options(struct tcp_stream *tcp, uchar *o, int o_len)
 			break;
 		case TCP_O_SCL:
 			wsopt = (struct tcp_scale *)p;
-			tcp->rmt_win_scale = wsopt->scale;
+			tcp->rmt_win_scale = min_t(u8, wsopt->scale,
+						   TCP_MAX_WIN_SCALE);
+			tcp->win_scale_ok = 1;
 			break;
 		case TCP_O_TS:
 			tsopt = (struct tcp_t_opt *)p;
@@ -922,6 +1014,7 @@ static int tcp_rx_user_data(struct tcp_stream *tcp, u32 tcp_seq_num,
 {
 	int tmp_len;
 	u32 buf_offs, old_offs, new_offs;
+	bool in_order;
 	u8 action;
 
 	if (!len)
@@ -937,6 +1030,7 @@ static int tcp_rx_user_data(struct tcp_stream *tcp, u32 tcp_seq_num,
 	}
 
 	tmp_len = len;
+	in_order = tcp_seq_num == tcp->rcv_nxt;
 	old_offs = tcp_stream_rx_offs(tcp);
 	buf_offs = tcp_seq_num - tcp->irs - 1;
 	if (tcp->rx) {
@@ -958,6 +1052,21 @@ static int tcp_rx_user_data(struct tcp_stream *tcp, u32 tcp_seq_num,
 	if (tcp->on_rcv_nxt_update && old_offs != new_offs)
 		tcp->on_rcv_nxt_update(tcp, new_offs);
 
+	/*
+	 * Delay the ACK of an in-order, full-sized segment until the next
+	 * one arrives (RFC 5681, section 4.2). Out-of-order segments and
+	 * those filling a hole are acknowledged at once, so that the peer
+	 * sees the SACK blocks and can recover quickly.
+	 */
+	if (len > tcp->rcv_mss)
+		tcp->rcv_mss = len;
+	if (in_order && len == tcp->rcv_mss &&
+	    tcp->lost.len <= TCP_OPT_LEN_2 && !tcp->ack_pending) {
+		tcp->ack_pending = 1;
+		tcp->ack_time = get_timer(0);
+		return TCP_PACKET_OK;
+	}
+
 	action = tcp_stream_fin_needed(tcp, tcp->snd_una) | TCP_ACK;
 	tcp_send_packet(tcp, action, tcp->snd_una, tcp->rcv_nxt, 0);
 
@@ -1009,6 +1118,10 @@ void tcp_rx_state_machine(struct tcp_stream *tcp,
 		tcp->irs = tcp_seq_num;
 		tcp->rcv_nxt = tcp->irs + 1;
 
+		/* our SYN-ACK carries no window scale, so none is in use */
+		tcp->rmt_win_scale = 0;
+		tcp->win_scale_ok = 0;
+
 		tcp->iss = tcp_get_start_seq();
 		tcp->snd_una = tcp->iss;
 		tcp->snd_nxt = tcp->iss + 1;
@@ -1212,7 +1325,7 @@ struct tcp_stream *tcp_stream_connect(struct in_addr rhost, u16 rport)
 {
 	struct tcp_stream *tcp;
 
-	tcp = tcp_stream_add(rhost, rport, random_port());
+	tcp = tcp_stream_add(rhost, rport, tcp_new_port());
 	if (!tcp)
 		return NULL;
 
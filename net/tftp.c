@@ -28,6 +28,13 @@ DECLARE_GLOBAL_DATA_PTR;
 #define TIMEOUT		5000UL
 /* Number of "loading" hashes per line (for checking the image size) */
 #define HASHES_PER_LINE	65
+/*
+ * Lower bound of the retransmission timeout while data is flowing (ms), as
+ * for TCP in Linux, so that a short stall of the server is not taken for loss
+ */
+#define RTO_MIN		200UL
+/* Most blocks which can be held beyond a lost one */
+#define OOO_BLOCKS	64
 
 /*
  *	TFTP operations.
@@ -95,6 +102,25 @@ static ushort	tftp_windowsize;
 static ushort	tftp_next_ack;
 /* Last nack block we send */
 static ushort	tftp_last_nack;
+/* Window size to ask for in the next transfer */
+static ushort	tftp_window_size_next;
+/* tftp_window_size_option which that size was worked out for */
+static ushort	tftp_window_size_next_opt;
+/* A block was lost during this transfer */
+static bool	tftp_lost;
+/* Blocks held beyond a lost one, bit n for block tftp_cur_block + 2 + n */
+static u64	tftp_ooo_held;
+/* Which of the held blocks is the last one of the file */
+static u64	tftp_ooo_last;
+/* Smoothed round-trip time and its variation, scaled by 8 and 4 (ms) */
+static ulong	tftp_srtt;
+static ulong	tftp_rttvar;
+/* Retransmission timeout while data is flowing (ms) */
+static ulong	tftp_rto;
+/* Block expected in reply to the ACK being timed, -1 if none */
+static int	tftp_rtt_block;
+/* Time at which that ACK was sent */
+static ulong	tftp_rtt_start;
 #ifdef CONFIG_CMD_TFTPPUT
 /* 1 if writing, else 0 */
 static int	tftp_put_active;
@@ -168,7 +194,9 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 	}
 
 	ptr = map_sysmem(store_addr, len);
-	memcpy(ptr, src, len);
+	/* the data may have been received in place already, or be on its way */
+	if (src && ptr != src)
+		memcpy(ptr, src, len);
 	unmap_sysmem(ptr);
 
 	if (net_boot_file_size < newsize)
@@ -183,6 +211,8 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	tftp_ooo_held = 0;
+	tftp_ooo_last = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -277,9 +307,174 @@ static void update_block_number(void)
 	show_block_marker();
 }
 
+/* Absolute number of the next block expected, counting wraparounds */
+static ulong tftp_next_block(void)
+{
+	return tftp_block_wrap * TFTP_SEQUENCE_SIZE + tftp_cur_block + 1;
+}
+
+#ifdef CONFIG_TFTP_TSIZE
+static void *tftp_place_dest(ulong seq)
+{
+	ulong offset = (seq - 1) * tftp_block_size;
+
+	/* only full blocks are placed */
+	if (offset + tftp_block_size > tftp_tsize)
+		return NULL;
+
+	return map_sysmem(tftp_load_addr + offset, tftp_block_size);
+}
+
+static bool tftp_place_check(struct ip_udp_hdr *ip, ulong seq)
+{
+	__be16 *s = (__be16 *)(ip + 1);
+
+	return ntohs(ip->udp_src) == tftp_remote_port &&
+	       ntohs(s[0]) == TFTP_DATA && ntohs(s[1]) == (ushort)seq;
+}
+
+static struct net_rx_place tftp_place = {
+	.hdr_len	= 4,
+	.next		= tftp_next_block,
+	.dest		= tftp_place_dest,
+	.check		= tftp_place_check,
+};
+
+/* Let the driver receive the data blocks in place, once the size is known */
+static void tftp_place_data(void)
+{
+	if (tftp_put_active || !tftp_tsize || tftp_place.port)
+		return;
+	/*
+	 * Check the whole file once, rather than each block as its receive
+	 * buffer is set up. If this fails, store_block() reports it.
+	 */
+	if (CONFIG_IS_ENABLED(LMB) && lmb_read_check(tftp_load_addr, tftp_tsize))
+		return;
+
+	tftp_place.len = tftp_block_size;
+	tftp_place.port = tftp_our_port;
+	net_set_rx_place(&tftp_place);
+}
+
+static int tftp_place_stop(void)
+{
+	tftp_place.port = 0;
+
+	return net_set_rx_place(NULL);
+}
+#else
+static inline void tftp_place_data(void) {}
+static inline int tftp_place_stop(void)
+{
+	return 0;
+}
+#endif
+
+/**
+ * hold_block() - keep a block which arrived ahead of the next expected one
+ *
+ * The block is stored in place straight away, so that once the blocks before
+ * it arrive, it does not have to be sent again.
+ *
+ * @ahead:	Distance from the next expected block
+ * @src:	Block data, NULL if it is written in place later
+ * @len:	Length of the block
+ * Return: 0 if OK (including if the block was dropped), -1 on error
+ */
+static int hold_block(uint ahead, uchar *src, unsigned int len)
+{
+	u64 bit;
+
+	if (ahead > OOO_BLOCKS)
+		return 0;
+	bit = 1ULL << (ahead - 1);
+	if (tftp_ooo_held & bit)
+		return 0;
+	if (store_block(tftp_cur_block + 1 + ahead, src, len))
+		return -1;
+	tftp_ooo_held |= bit;
+	if (len < tftp_block_size)
+		tftp_ooo_last |= bit;
+
+	return 0;
+}
+
+/**
+ * absorb_held_blocks() - move past held blocks following the current one
+ *
+ * Return: true if the last block of the file was reached
+ */
+static bool absorb_held_blocks(void)
+{
+	bool last = false;
+
+	while (!last && (tftp_ooo_held & 1)) {
+		last = tftp_ooo_last & 1;
+		tftp_ooo_held >>= 1;
+		tftp_ooo_last >>= 1;
+		tftp_cur_block++;
+		tftp_cur_block %= TFTP_SEQUENCE_SIZE;
+		update_block_number();
+		tftp_prev_block = tftp_cur_block;
+	}
+	tftp_ooo_held >>= 1;
+	tftp_ooo_last >>= 1;
+
+	return last;
+}
+
+/**
+ * rtt_sample() - update the retransmission timeout from a round-trip time
+ *
+ * This follows RFC 6298, within the bounds of RTO_MIN and the timeout agreed
+ * with the server.
+ *
+ * @rtt:	Time between an ACK and the first block sent in reply, in ms
+ */
+static void rtt_sample(ulong rtt)
+{
+	long delta;
+
+	rtt = max(rtt, 1UL);
+	if (!tftp_srtt) {
+		tftp_srtt = rtt << 3;
+		tftp_rttvar = rtt << 1;
+	} else {
+		delta = rtt - (tftp_srtt >> 3);
+		tftp_srtt += delta;
+		if (delta < 0)
+			delta = -delta;
+		tftp_rttvar += delta - (tftp_rttvar >> 2);
+	}
+	tftp_rto = clamp((tftp_srtt >> 3) + tftp_rttvar, RTO_MIN, timeout_ms);
+}
+
+/*
+ * Adjust the window size asked for in the next transfer: shrink it after a
+ * transfer which lost blocks, grow it back towards the configured size after
+ * one which did not
+ */
+static void adapt_window_size(void)
+{
+	if (tftp_lost)
+		tftp_window_size_next = max(tftp_window_size_next / 2, 1);
+	else
+		tftp_window_size_next = min(tftp_window_size_next * 2,
+					    (int)tftp_window_size_option);
+	debug("TFTP windowsize for next transfer = %d\n",
+	      tftp_window_size_next);
+}
+
 /* The TFTP get or put is complete */
 static void tftp_complete(void)
 {
+	/* this also writes any block still waiting for its receive buffer */
+	if (tftp_place_stop()) {
+		puts("\nTFTP error: cannot take back the receive buffers\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
 #ifdef CONFIG_TFTP_TSIZE
 	/* Print hash marks for the last packet received */
 	while (tftp_tsize && tftp_tsize_num_hash < 49) {
@@ -299,10 +494,12 @@ static void tftp_complete(void)
 
 	led_activity_off();
 
-	if (!tftp_put_active)
+	if (!tftp_put_active) {
+		adapt_window_size();
 		efi_set_bootdev("Net", "", tftp_filename,
 				map_sysmem(tftp_load_addr, 0),
 				net_boot_file_size);
+	}
 	net_set_state(NETLOOP_SUCCESS);
 }
 
@@ -357,9 +554,9 @@ static void tftp_send(void)
 		 * Implemented only for tftp get.
 		 * Don't bother sending if it's 1
 		 */
-		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_next > 1)
 			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
-					0, tftp_window_size_option, 0);
+					0, tftp_window_size_next, 0);
 		len = pkt - xp;
 		break;
 
@@ -382,6 +579,11 @@ static void tftp_send(void)
 			tftp_put_final_block_sent = (loaded < toload);
 		}
 #endif
+		/* time the server's reply, unless already timing one */
+		if (!tftp_put_active && tftp_rtt_block < 0) {
+			tftp_rtt_block = (ushort)(tftp_cur_block + 1);
+			tftp_rtt_start = get_timer(0);
+		}
 		len = pkt - xp;
 		break;
 
@@ -456,6 +658,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	__be16 *s;
 	int i;
 	u16 timeout_val_rcvd;
+	ushort block, ahead;
+	uchar *data;
 
 	if (dest != tftp_our_port) {
 			return;
@@ -585,6 +789,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			tftp_cur_block++;
 		}
 #endif
+		if (tftp_state == STATE_OACK)
+			tftp_place_data();
 		tftp_send(); /* Send ACK or first data block */
 		break;
 	case TFTP_DATA:
@@ -592,18 +798,46 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			return;
 		len -= 2;
 
-		if (ntohs(*(__be16 *)pkt) != (ushort)(tftp_cur_block + 1)) {
+		block = ntohs(*(__be16 *)pkt);
+		if (block == tftp_rtt_block) {
+			rtt_sample(get_timer(tftp_rtt_start));
+			tftp_rtt_block = -1;
+		}
+
+		ahead = block - (ushort)(tftp_cur_block + 1);
+		data = net_rx_payload(pkt + 2);
+		if (ahead < TFTP_SEQUENCE_SIZE / 2 &&
+		    !net_rx_place_claim(tftp_next_block() + ahead)) {
+			/*
+			 * Its place is still set up as a receive buffer, so it
+			 * is written there once that buffer is back
+			 */
+			if (!net_rx_place_defer(tftp_next_block() + ahead, data,
+						len))
+				break;
+			data = NULL;
+		}
+		if (ahead) {
 			debug("Received unexpected block: %d, expected: %d\n",
-			      ntohs(*(__be16 *)pkt),
-			      (ushort)(tftp_cur_block + 1));
+			      block, (ushort)(tftp_cur_block + 1));
 			/*
 			 * Only ACK if the block count received is greater than
 			 * the expected block count, otherwise skip ACK.
 			 * (required to properly handle the server retransmitting
 			 *  the window)
 			 */
-			if ((ushort)(tftp_cur_block + 1) - (short)(ntohs(*(__be16 *)pkt)) > 0)
+			if (ahead >= TFTP_SEQUENCE_SIZE / 2)
 				break;
+			tftp_lost = true;
+			if (tftp_state == STATE_DATA) {
+				net_set_timeout_handler(tftp_rto,
+							tftp_timeout_handler);
+				if (hold_block(ahead, data, len)) {
+					eth_halt_state_only();
+					net_set_state(NETLOOP_FAIL);
+					break;
+				}
+			}
 			/*
 			 * If one packet is dropped most likely
 			 * all other buffers in the window
@@ -652,16 +886,16 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		update_block_number();
 		tftp_prev_block = tftp_cur_block;
 		timeout_count_max = tftp_timeout_count_max;
-		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		net_set_timeout_handler(tftp_rto, tftp_timeout_handler);
 
-		if (store_block(tftp_cur_block, pkt + 2, len)) {
+		if (store_block(tftp_cur_block, data, len)) {
 			eth_halt_state_only();
 			net_set_state(NETLOOP_FAIL);
 			break;
 		}
 		timeout_count = 0;
 
-		if (len < tftp_block_size) {
+		if (len < tftp_block_size || absorb_held_blocks()) {
 			tftp_send();
 			tftp_complete();
 			break;
@@ -669,11 +903,12 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 		/*
 		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
+		 *	the remote for the next one. Held blocks may have taken
+		 *	us past the end of the window.
 		 */
-		if (tftp_cur_block == tftp_next_ack) {
+		if ((short)((ushort)tftp_cur_block - tftp_next_ack) >= 0) {
 			tftp_send();
-			tftp_next_ack += tftp_windowsize;
+			tftp_next_ack = tftp_cur_block + tftp_windowsize;
 		}
 		break;
 
@@ -704,13 +939,23 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 static void tftp_timeout_handler(void)
 {
+	ulong delay = timeout_ms;
+
 	if (++timeout_count > timeout_count_max) {
 		restart("Retry count exceeded");
 	} else {
 		puts("T ");
-		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		if (tftp_state == STATE_DATA && !tftp_put_active) {
+			/* back off, in case the estimate is too short */
+			tftp_rto = min(tftp_rto * 2, timeout_ms);
+			delay = tftp_rto;
+			tftp_lost = true;
+		}
+		net_set_timeout_handler(delay, tftp_timeout_handler);
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
+		/* the reply to a retransmission says nothing about the RTT */
+		tftp_rtt_block = -1;
 	}
 }
 
@@ -806,6 +1051,12 @@ void tftp_start(enum proto_t protocol)
 
 	sanitize_tftp_block_size_option(protocol);
 
+	/* start again from the configured size whenever that changes */
+	if (tftp_window_size_next_opt != tftp_window_size_option) {
+		tftp_window_size_next = tftp_window_size_option;
+		tftp_window_size_next_opt = tftp_window_size_option;
+	}
+
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
 	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
 
@@ -937,6 +1188,10 @@ void tftp_start(enum proto_t protocol)
 	tftp_cur_block = 0;
 	tftp_windowsize = 1;
 	tftp_last_nack = 0;
+	tftp_lost = false;
+	tftp_srtt = 0;
+	tftp_rto = timeout_ms;
+	tftp_rtt_block = -1;
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
 	/* Revert tftp_block_size to dflt */
@@ -945,6 +1200,11 @@ void tftp_start(enum proto_t protocol)
 	tftp_tsize = 0;
 	tftp_tsize_num_hash = 0;
 #endif
+	if (tftp_place_stop()) {
+		puts("\nTFTP error: cannot take back the receive buffers\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
 
 	tftp_send();
 }
@@ -977,6 +1237,10 @@ void tftp_start_server(void)
 	tftp_our_port = WELL_KNOWN_PORT;
 	tftp_windowsize = 1;
 	tftp_next_ack = tftp_windowsize;
+	tftp_lost = false;
+	tftp_srtt = 0;
+	tftp_rto = timeout_ms;
+	tftp_rtt_block = -1;
 
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
@@ -16,6 +16,7 @@
 #include <net/tcp.h>
 #include <net/wget.h>
 #include <stdlib.h>
+#include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -28,11 +29,16 @@ DECLARE_GLOBAL_DATA_PTR;
 
 #define HTTP_STATUS_BAD		0
 #define HTTP_STATUS_OK		200
+#define HTTP_STATUS_PARTIAL	206
+
+/* Parts smaller than this are not worth a connection of their own */
+#define WGET_RANGE_MIN		SZ_64K
 
 static const char http_proto[] = "HTTP/1.0";
 static const char http_eom[] = "\r\n\r\n";
 static const char content_len[] = "Content-Length:";
 static const char linefeed[] = "\r\n";
+static const char accept_ranges[] = "Accept-Ranges: bytes";
 static struct in_addr web_server_ip;
 static unsigned int server_port;
 static unsigned long content_length;
@@ -42,6 +48,36 @@ static int wget_tsize_num_hash;
 static char *image_url;
 static enum net_loop_state wget_loop_state;
 
+/**
+ * struct wget_range - part of the file fetched over a connection of its own
+ *
+ * @tcp:	Connection, NULL once it is closed
+ * @start:	Offset of the part in the file
+ * @len:	Length of the part
+ * @rx_len:	Bytes of the part received in order
+ * @hdr_size:	Size of the HTTP header, 0 until it has been parsed
+ * @hdr_pos:	End of the data received before the header was parsed
+ * @hdr:	HTTP header, followed by the data received along with it
+ */
+struct wget_range {
+	struct tcp_stream *tcp;
+	ulong start;
+	ulong len;
+	ulong rx_len;
+	u32 hdr_size;
+	u32 hdr_pos;
+	char hdr[HTTP_MAX_HDR_LEN + 1];
+};
+
+static struct wget_range wget_ranges[CONFIG_WGET_CONNECTIONS];
+static int wget_nranges;
+/* Part which the connection being opened fetches */
+static struct wget_range *wget_new_range;
+static u32 wget_rx_packets;
+/* A HEAD request is sent first, to learn whether to fetch the file in parts */
+static bool wget_probing;
+static bool wget_can_range;
+
 /**
  * store_block() - store block in memory
  * @src: source of data
@@ -98,23 +134,22 @@ static void show_block_marker(u32 packets)
 	}
 }
 
-static void tcp_stream_on_closed(struct tcp_stream *tcp)
-{
-	if (tcp->status != TCP_ERR_OK)
-		wget_loop_state = NETLOOP_FAIL;
+static void wget_get(void);
 
+static void wget_finish(enum tcp_status status, u32 rx_packets)
+{
 	net_set_state(wget_loop_state);
 	if (wget_loop_state != NETLOOP_SUCCESS) {
 		net_boot_file_size = 0;
 		if (!wget_info->silent)
 			printf("\nwget: Transfer Fail, TCP status - %d\n",
-			       tcp->status);
+			       status);
 		return;
 	}
 
 	if (!wget_info->silent)
 		printf("\nPackets received %d, Transfer Successful\n",
-		       tcp->rx_packets);
+		       rx_packets);
 	wget_info->file_size = net_boot_file_size;
 	if (wget_info->method == WGET_HTTP_METHOD_GET && wget_info->set_bootdev) {
 		efi_set_bootdev("Http", NULL, image_url,
@@ -124,6 +159,21 @@ static void tcp_stream_on_closed(struct tcp_stream *tcp)
 	}
 }
 
+static void tcp_stream_on_closed(struct tcp_stream *tcp)
+{
+	if (tcp->status != TCP_ERR_OK)
+		wget_loop_state = NETLOOP_FAIL;
+
+	if (wget_probing && tcp->status == TCP_ERR_OK) {
+		/* fetch the file once this stream is out of the way */
+		wget_probing = false;
+		net_set_timeout_handler(1, wget_get);
+		return;
+	}
+
+	wget_finish(tcp->status, tcp->rx_packets);
+}
+
 static void tcp_stream_on_rcv_nxt_update(struct tcp_stream *tcp, u32 rx_bytes)
 {
 	char	*pos, *tail;
@@ -226,6 +276,9 @@ static void tcp_stream_on_rcv_nxt_update(struct tcp_stream *tcp, u32 rx_bytes)
 
 	}
 
+	wget_can_range = wget_probing && content_length != -1 &&
+			 strstr((char *)ptr, accept_ranges);
+
 	net_boot_file_size = rx_bytes - http_hdr_size;
 	memmove(ptr, ptr + http_hdr_size, max_rx_pos + 1 - http_hdr_size);
 	wget_loop_state = NETLOOP_SUCCESS;
@@ -246,15 +299,167 @@ static int tcp_stream_rx(struct tcp_stream *tcp, u32 rx_offs, void *buf, int len
 	return len;
 }
 
+/* Return the status code of an HTTP reply, HTTP_STATUS_BAD if there is none */
+static u32 http_status_code(const char *hdr)
+{
+	const char *pos;
+
+	if (strncasecmp(hdr, "HTTP/", 5))
+		return HTTP_STATUS_BAD;
+	pos = strchr(hdr, ' ');
+	if (!pos)
+		return HTTP_STATUS_BAD;
+
+	return simple_strtoul(pos + 1, NULL, 10);
+}
+
+/* Close the connections fetching the other parts, after one of them failed */
+static void wget_ranges_abort(void)
+{
+	struct tcp_stream *tcp;
+	int i;
+
+	for (i = 0; i < wget_nranges; i++) {
+		tcp = wget_ranges[i].tcp;
+		wget_ranges[i].tcp = NULL;
+		if (tcp) {
+			tcp_stream_reset(tcp);
+			tcp_stream_put(tcp);
+		}
+	}
+	wget_loop_state = NETLOOP_FAIL;
+	net_boot_file_size = 0;
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_range_on_closed(struct tcp_stream *tcp)
+{
+	struct wget_range *range = tcp->priv;
+	int i;
+
+	/* already given up on */
+	if (!range->tcp)
+		return;
+
+	range->tcp = NULL;
+	if (tcp->status != TCP_ERR_OK || range->rx_len != range->len) {
+		if (!wget_info->silent)
+			printf("\nwget: Transfer Fail, TCP status - %d\n",
+			       tcp->status);
+		wget_ranges_abort();
+		return;
+	}
+
+	wget_rx_packets += tcp->rx_packets;
+	for (i = 0; i < wget_nranges; i++) {
+		if (wget_ranges[i].tcp)
+			return;
+	}
+
+	net_boot_file_size = content_length;
+	wget_loop_state = NETLOOP_SUCCESS;
+	wget_finish(tcp->status, wget_rx_packets);
+}
+
+static void wget_range_on_rcv_nxt_update(struct tcp_stream *tcp, u32 rx_bytes)
+{
+	struct wget_range *range = tcp->priv;
+	char *pos;
+	u32 len;
+	int i;
+
+	if (!range->hdr_size) {
+		range->hdr[rx_bytes] = '\0';
+		pos = strstr(range->hdr, http_eom);
+		if (!pos) {
+			if (rx_bytes < HTTP_MAX_HDR_LEN &&
+			    tcp->state == TCP_ESTABLISHED)
+				return;
+
+			if (!wget_info->silent)
+				printf("ERROR: missed HTTP header\n");
+			tcp_stream_reset(tcp);
+			return;
+		}
+
+		range->hdr_size = pos - range->hdr + strlen(http_eom);
+		*pos = '\0';
+		if (http_status_code(range->hdr) != HTTP_STATUS_PARTIAL) {
+			debug_cond(DEBUG_WGET,
+				   "wget: Bad reply to range request\n");
+			tcp_stream_reset(tcp);
+			return;
+		}
+
+		/* store the data which came along with the header */
+		len = range->hdr_pos > range->hdr_size ?
+		      range->hdr_pos - range->hdr_size : 0;
+		if (len > range->len ||
+		    store_block((uchar *)range->hdr + range->hdr_size,
+				range->start, len) < 0) {
+			tcp_stream_reset(tcp);
+			return;
+		}
+	}
+
+	range->rx_len = rx_bytes - range->hdr_size;
+	net_boot_file_size = 0;
+	for (i = 0; i < wget_nranges; i++)
+		net_boot_file_size += wget_ranges[i].rx_len;
+	show_block_marker(tcp->rx_packets);
+}
+
+static int wget_range_rx(struct tcp_stream *tcp, u32 rx_offs, void *buf,
+			 int len)
+{
+	struct wget_range *range = tcp->priv;
+	u32 skip = 0;
+
+	if (!range->hdr_size) {
+		/*
+		 * Keep the data in the header buffer until the header has
+		 * been parsed. Anything beyond it is left to be sent again.
+		 */
+		if (rx_offs >= HTTP_MAX_HDR_LEN)
+			return 0;
+
+		len = min_t(u32, len, HTTP_MAX_HDR_LEN - rx_offs);
+		memcpy(range->hdr + rx_offs, buf, len);
+		range->hdr_pos = max(range->hdr_pos, rx_offs + len);
+
+		return len;
+	}
+
+	/* the header may be sent again */
+	if (rx_offs + len <= range->hdr_size)
+		return len;
+	if (rx_offs < range->hdr_size)
+		skip = range->hdr_size - rx_offs;
+	if (rx_offs + len - range->hdr_size > range->len)
+		return -1;
+	if (store_block(buf + skip, range->start + rx_offs + skip -
+			range->hdr_size, len - skip) < 0)
+		return -1;
+
+	return len;
+}
+
 static int tcp_stream_tx(struct tcp_stream *tcp, u32 tx_offs, void *buf, int maxlen)
 {
+	struct wget_range *range = tcp->priv;
 	int ret;
 	const char *method;
 
 	if (tx_offs)
 		return 0;
 
-	switch (wget_info->method) {
+	if (range)
+		return snprintf(buf, maxlen,
+				"GET %s %s\r\nRange: bytes=%lu-%lu\r\n\r\n",
+				image_url, http_proto, range->start,
+				range->start + range->len - 1);
+
+	switch (wget_probing ? WGET_HTTP_METHOD_HEAD : wget_info->method) {
 	case WGET_HTTP_METHOD_HEAD:
 		method = "HEAD";
 		break;
@@ -278,20 +483,100 @@ static int tcp_stream_on_create(struct tcp_stream *tcp)
 
 	tcp->max_retry_count = WGET_RETRY_COUNT;
 	tcp->initial_timeout = WGET_TIMEOUT;
+	/*
+	 * Data is stored straight at its final offset, so the window only
+	 * needs to be bounded by the destination buffer.
+	 */
+	if (CONFIG_WGET_RCV_WND) {
+		tcp->rcv_wnd = CONFIG_WGET_RCV_WND;
+		if (wget_new_range)
+			tcp->rcv_wnd = min_t(ulong, tcp->rcv_wnd,
+					     wget_new_range->len +
+					     HTTP_MAX_HDR_LEN);
+		else if (wget_info->buffer_size)
+			tcp->rcv_wnd = min_t(ulong, tcp->rcv_wnd,
+					     wget_info->buffer_size +
+					     HTTP_MAX_HDR_LEN);
+	}
+	tcp->tx = tcp_stream_tx;
+	if (wget_new_range) {
+		tcp->priv = wget_new_range;
+		wget_new_range->tcp = tcp;
+		tcp->on_closed = wget_range_on_closed;
+		tcp->on_rcv_nxt_update = wget_range_on_rcv_nxt_update;
+		tcp->rx = wget_range_rx;
+		return 1;
+	}
 	tcp->on_closed = tcp_stream_on_closed;
 	tcp->on_rcv_nxt_update = tcp_stream_on_rcv_nxt_update;
 	tcp->rx = tcp_stream_rx;
-	tcp->tx = tcp_stream_tx;
 
 	return 1;
 }
 
+/* Open a connection to the server, to fetch @range or the whole file */
+static int wget_connect(struct wget_range *range)
+{
+	struct tcp_stream *tcp;
+
+	wget_new_range = range;
+	tcp = tcp_stream_connect(web_server_ip, server_port);
+	wget_new_range = NULL;
+	if (!tcp) {
+		if (!wget_info->silent)
+			printf("No free tcp streams\n");
+		net_set_state(NETLOOP_FAIL);
+		return -ENOSPC;
+	}
+	tcp_stream_put(tcp);
+
+	return 0;
+}
+
+/*
+ * Fetch the file after the HEAD request, split in parts which are fetched
+ * at the same time if the server accepts byte ranges
+ */
+static void wget_get(void)
+{
+	struct wget_range *range;
+	ulong part;
+	int i, n;
+
+	max_rx_pos = (u32)(-1);
+	net_boot_file_size = 0;
+	http_hdr_size = 0;
+	wget_loop_state = NETLOOP_FAIL;
+
+	/* each part needs a TCP stream of its own */
+	n = min(CONFIG_WGET_CONNECTIONS, CONFIG_PROT_TCP_STREAMS);
+	n = min_t(ulong, n, content_length / WGET_RANGE_MIN);
+	if (!wget_can_range || n < 2) {
+		wget_connect(NULL);
+		return;
+	}
+
+	debug_cond(DEBUG_WGET, "wget: Fetching %lu bytes in %d parts\n",
+		   content_length, n);
+	part = DIV_ROUND_UP(content_length, n);
+	memset(wget_ranges, '\0', sizeof(wget_ranges));
+	wget_nranges = n;
+	wget_rx_packets = 0;
+	for (i = 0; i < n; i++) {
+		range = &wget_ranges[i];
+		range->start = i * part;
+		range->len = min(part, content_length - range->start);
+		if (wget_connect(range)) {
+			wget_ranges_abort();
+			return;
+		}
+	}
+}
+
 #define BLOCKSIZE 512
 
 void wget_start(void)
 {
-	struct tcp_stream *tcp;
-
 	if (!wget_info)
 		wget_info = &default_wget_info;
 
@@ -345,6 +630,10 @@ void wget_start(void)
 	http_hdr_size = 0;
 	wget_tsize_num_hash = 0;
 	wget_loop_state = NETLOOP_FAIL;
+	wget_nranges = 0;
+	wget_can_range = false;
+	wget_probing = CONFIG_WGET_CONNECTIONS > 1 &&
+		       wget_info->method == WGET_HTTP_METHOD_GET;
 
 	wget_info->status_code = HTTP_STATUS_BAD;
 	wget_info->file_size = 0;
@@ -354,14 +643,7 @@ void wget_start(void)
 
 	server_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
 	tcp_stream_set_on_create_handler(tcp_stream_on_create);
-	tcp = tcp_stream_connect(web_server_ip, server_port);
-	if (!tcp) {
-		if (!wget_info->silent)
-			printf("No free tcp streams\n");
-		net_set_state(NETLOOP_FAIL);
-		return;
-	}
-	tcp_stream_put(tcp);
+	wget_connect(NULL);
 }
 
 int wget_do_request(ulong dst_addr, char *uri)
@@ -12,7 +12,10 @@
 #include <bootflow.h>
 #include <env.h>
 #include <mapmem.h>
+#include <net.h>
 #include <os.h>
+#include <sort.h>
+#include <dm/root.h>
 #include <test/ut.h>
 #include "bootstd_common.h"
 
@@ -557,6 +560,74 @@ static int bootdev_test_hunt_prio(struct unit_test_state *uts)
 }
 BOOTSTD_TEST(bootdev_test_hunt_prio, UTF_DM | UTF_SCAN_FDT | UTF_CONSOLE);
 
+/* Get the names of all bootdevs, sorted and separated by newlines */
+static int get_bootdev_names(struct unit_test_state *uts, char *buf, int size)
+{
+	const char *names[32];
+	struct udevice *dev;
+	struct uclass *uc;
+	int count, i, len;
+
+	count = 0;
+	uclass_id_foreach_dev(UCLASS_BOOTDEV, dev, uc) {
+		ut_assert(count < ARRAY_SIZE(names));
+		names[count++] = dev->name;
+	}
+	qsort(names, count, sizeof(*names), strcmp_compar);
+
+	*buf = '\0';
+	for (i = 0; i < count; i++) {
+		len = snprintf(buf, size, "%s\n", names[i]);
+		ut_assert(len < size);
+		buf += len;
+		size -= len;
+	}
+
+	return 0;
+}
+
+/* Check that hunting in parallel has the same result as hunting in turn */
+static int bootdev_test_hunt_parallel(struct unit_test_state *uts)
+{
+	char serial[512], parallel[512];
+	struct bootstd_priv *std;
+	uint used;
+
+	if (!CONFIG_IS_ENABLED(UTHREAD))
+		return -EAGAIN;
+
+	test_set_skip_delays(true);
+	bootstd_reset_usb();
+	ut_assertok(bootstd_get_priv(&std));
+	std->hunt_parallel = false;
+	ut_assertok(bootdev_hunt_upto(BOOTDEVP_5_SCAN_SLOW, false));
+	used = std->hunters_used;
+	ut_assertok(get_bootdev_names(uts, serial, sizeof(serial)));
+
+	/* everything except ethernet should have been hunted */
+	ut_asserteq(GENMASK(MAX_HUNTER, 1), used);
+
+	/* start again with a new driver model and run the hunters in threads */
+	ut_assertok(dm_uninit());
+	ut_assertok(dm_init(uts->of_live));
+	uts->root = dm_root();
+	eth_set_enable_bootdevs(false);
+	test_sf_set_enable_bootdevs(false);
+	ut_assertok(dm_extended_scan(false));
+	bootstd_reset_usb();
+
+	ut_assertok(bootstd_get_priv(&std));
+	ut_asserteq(0, std->hunters_used);
+	std->hunt_parallel = true;
+	ut_assertok(bootdev_hunt_upto(BOOTDEVP_5_SCAN_SLOW, false));
+	ut_asserteq(used, std->hunters_used);
+	ut_assertok(get_bootdev_names(uts, parallel, sizeof(parallel)));
+	ut_asserteq_str(serial, parallel);
+
+	return 0;
+}
+BOOTSTD_TEST(bootdev_test_hunt_parallel, UTF_DM | UTF_SCAN_FDT);
+
 /* Check hunting for bootdevs with a particular label */
 static int bootdev_test_hunt_label(struct unit_test_state *uts)
 {
@@ -12,6 +12,7 @@
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <net/tcp.h>
 #include <net/wget.h>
@@ -73,7 +74,7 @@ static int sb_syn_handler(struct udevice *dev, void *packet,
 	tcp_send->tcp_ack = htonl(priv->irs + 1);
 	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE));
 	tcp_send->tcp_flags = TCP_SYN | TCP_ACK;
-	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS);
 	tcp_send->tcp_xsum = 0;
 	tcp_send->tcp_ugr = 0;
 	tcp_send->tcp_xsum = tcp_set_pseudo_header((uchar *)tcp_send,
@@ -166,7 +167,7 @@ static int sb_ack_handler(struct udevice *dev, void *packet,
 	}
 
 	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE));
-	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS);
 	tcp_send->tcp_xsum = 0;
 	tcp_send->tcp_ugr = 0;
 	pkt_len = IP_TCP_HDR_SIZE + payload_len;
@@ -242,6 +243,345 @@ static int net_test_wget(struct unit_test_state *uts)
 }
 CMD_TEST(net_test_wget, UTF_CONSOLE);
 
+#define SB_HTTP_FILE_SIZE	(160 * 1024)
+#define SB_HTTP_SEG_SIZE	1024
+#define SB_HTTP_MAX_CONNS	4
+#define SB_HTTP_MAX_REQS	4
+
+/**
+ * struct sb_http_conn - connection to the sandbox HTTP server
+ *
+ * Offsets count the bytes of the reply, which is the HTTP header followed by
+ * the data.
+ *
+ * @port:	Port of the client
+ * @iss:	Initial send sequence number
+ * @rcv_nxt:	Next sequence number expected from the client
+ * @hdr:	HTTP header of the reply, empty until the request is received
+ * @hdr_len:	Length of @hdr
+ * @start:	Offset of the data in the file
+ * @len:	Length of the data
+ * @sent:	Bytes of the reply sent
+ * @acked:	Bytes of the reply acknowledged by the client
+ * @fin:	true once the FIN has been sent
+ */
+struct sb_http_conn {
+	u16 port;
+	u32 iss;
+	u32 rcv_nxt;
+	char hdr[256];
+	int hdr_len;
+	ulong start;
+	ulong len;
+	ulong sent;
+	ulong acked;
+	bool fin;
+};
+
+/**
+ * struct sb_http_server - HTTP server serving several connections
+ *
+ * @ranges:	true to accept byte ranges
+ * @client_mac:	MAC address of the client
+ * @client_ip:	IP address of the client
+ * @server_ip:	IP address of the server
+ * @server_port: Port of the server
+ * @conns:	Connections
+ * @nconns:	Number of connections in @conns
+ * @reqs:	Requests received, with the line breaks replaced by spaces
+ * @nreqs:	Number of requests in @reqs
+ */
+struct sb_http_server {
+	bool ranges;
+	u8 client_mac[ARP_HLEN];
+	struct in_addr client_ip;
+	struct in_addr server_ip;
+	u16 server_port;
+	struct sb_http_conn conns[SB_HTTP_MAX_CONNS];
+	int nconns;
+	char reqs[SB_HTTP_MAX_REQS][80];
+	int nreqs;
+};
+
+static struct sb_http_server sb_http;
+
+/* Content of the file served */
+static u8 sb_http_byte(ulong offs)
+{
+	return offs * 7 + (offs >> 10);
+}
+
+static void sb_http_send(struct udevice *dev, struct sb_http_conn *conn,
+			 ulong offs, u8 flags, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth_send;
+	struct ip_tcp_hdr *tcp_send;
+	u8 *data;
+	int pkt_len, i;
+
+	eth_send = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_send->et_dest, sb_http.client_mac, ARP_HLEN);
+	memcpy(eth_send->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_send->et_protlen = htons(PROT_IP);
+	tcp_send = (void *)eth_send + ETHER_HDR_SIZE;
+	tcp_send->tcp_src = htons(sb_http.server_port);
+	tcp_send->tcp_dst = htons(conn->port);
+	tcp_send->tcp_seq = htonl(conn->iss + (flags & TCP_SYN ? 0 : 1) + offs);
+	tcp_send->tcp_ack = htonl(conn->rcv_nxt);
+	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE));
+	tcp_send->tcp_flags = flags;
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS);
+	tcp_send->tcp_xsum = 0;
+	tcp_send->tcp_ugr = 0;
+
+	data = (void *)tcp_send + IP_TCP_HDR_SIZE;
+	for (i = 0; i < len; i++, offs++) {
+		if (offs < conn->hdr_len)
+			data[i] = conn->hdr[offs];
+		else
+			data[i] = sb_http_byte(conn->start + offs - conn->hdr_len);
+	}
+
+	pkt_len = IP_TCP_HDR_SIZE + len;
+	tcp_send->tcp_xsum = tcp_set_pseudo_header((uchar *)tcp_send,
+						   sb_http.server_ip,
+						   sb_http.client_ip,
+						   pkt_len - IP_HDR_SIZE,
+						   pkt_len);
+	net_set_ip_header((uchar *)tcp_send, sb_http.client_ip,
+			  sb_http.server_ip, pkt_len, IPPROTO_TCP);
+
+	priv->recv_packet_length[priv->recv_packets] = ETHER_HDR_SIZE + pkt_len;
+	++priv->recv_packets;
+}
+
+/* Send what the client has room for, on every connection */
+static void sb_http_fill(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_http_conn *conn;
+	ulong total;
+	int i, len;
+
+	for (i = 0; i < sb_http.nconns; i++) {
+		conn = &sb_http.conns[i];
+		if (!conn->hdr_len || conn->fin)
+			continue;
+
+		total = conn->hdr_len + conn->len;
+		while (conn->sent < total &&
+		       conn->sent < conn->acked + 2 * SB_HTTP_SEG_SIZE &&
+		       priv->recv_packets < PKTBUFSRX) {
+			len = min_t(ulong, SB_HTTP_SEG_SIZE, total - conn->sent);
+			sb_http_send(dev, conn, conn->sent, TCP_ACK, len);
+			conn->sent += len;
+		}
+		if (conn->acked == total && priv->recv_packets < PKTBUFSRX) {
+			sb_http_send(dev, conn, total, TCP_ACK | TCP_FIN, 0);
+			conn->fin = true;
+		}
+	}
+}
+
+/* Set up the reply to a request for a HEAD or GET of the file */
+static void sb_http_request(struct sb_http_conn *conn, const char *data,
+			    int len)
+{
+	char req[sizeof(sb_http.reqs[0])];
+	ulong first, last;
+	char *range, *out;
+	int i;
+
+	len = min_t(int, len, sizeof(req) - 1);
+	memcpy(req, data, len);
+	req[len] = '\0';
+
+	if (sb_http.nreqs < SB_HTTP_MAX_REQS) {
+		out = sb_http.reqs[sb_http.nreqs++];
+		for (i = 0; i < len; i++) {
+			if (req[i] != '\r')
+				*out++ = req[i] == '\n' ? ' ' : req[i];
+		}
+		while (out > sb_http.reqs[sb_http.nreqs - 1] && out[-1] == ' ')
+			out--;
+		*out = '\0';
+	}
+
+	range = strstr(req, "Range: bytes=");
+	if (range && sb_http.ranges) {
+		first = simple_strtoul(range + 13, &range, 10);
+		last = simple_strtoul(range + 1, NULL, 10);
+		conn->start = first;
+		conn->len = last + 1 - first;
+		conn->hdr_len = snprintf(conn->hdr, sizeof(conn->hdr),
+					 "HTTP/1.1 206 Partial Content\r\n"
+					 "Content-Range: bytes %lu-%lu/%u\r\n"
+					 "Content-Length: %lu\r\n\r\n",
+					 first, last, SB_HTTP_FILE_SIZE,
+					 conn->len);
+		return;
+	}
+
+	conn->start = 0;
+	conn->len = strncmp(req, "HEAD ", 5) ? SB_HTTP_FILE_SIZE : 0;
+	conn->hdr_len = snprintf(conn->hdr, sizeof(conn->hdr),
+				 "HTTP/1.1 200 OK\r\n%s"
+				 "Content-Length: %u\r\n\r\n",
+				 sb_http.ranges ? "Accept-Ranges: bytes\r\n" : "",
+				 SB_HTTP_FILE_SIZE);
+}
+
+static int sb_http_tcp_handler(struct udevice *dev, void *packet,
+			       unsigned int len)
+{
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_http_conn *conn = NULL;
+	int hdr_len, data_len, i;
+	ulong acked;
+	u16 port;
+
+	memcpy(sb_http.client_mac, eth->et_src, ARP_HLEN);
+	sb_http.client_ip = net_read_ip(&tcp->ip_src);
+	sb_http.server_ip = net_read_ip(&tcp->ip_dst);
+	sb_http.server_port = ntohs(tcp->tcp_dst);
+	hdr_len = GET_TCP_HDR_LEN_IN_BYTES(tcp->tcp_hlen);
+	data_len = ntohs(tcp->ip_len) - IP_HDR_SIZE - hdr_len;
+
+	port = ntohs(tcp->tcp_src);
+	for (i = 0; i < sb_http.nconns; i++) {
+		if (sb_http.conns[i].port == port)
+			conn = &sb_http.conns[i];
+	}
+
+	if (tcp->tcp_flags == TCP_SYN) {
+		if (!conn) {
+			if (sb_http.nconns == SB_HTTP_MAX_CONNS)
+				return 0;
+			conn = &sb_http.conns[sb_http.nconns++];
+		}
+		memset(conn, '\0', sizeof(*conn));
+		conn->port = port;
+		conn->rcv_nxt = ntohl(tcp->tcp_seq) + 1;
+		conn->iss = ~conn->rcv_nxt;
+		if (priv->recv_packets < PKTBUFSRX)
+			sb_http_send(dev, conn, 0, TCP_SYN | TCP_ACK, 0);
+		return 0;
+	}
+
+	if (!conn || !(tcp->tcp_flags & TCP_ACK))
+		return 0;
+
+	if (data_len > 0 && ntohl(tcp->tcp_seq) == conn->rcv_nxt) {
+		if (!conn->hdr_len)
+			sb_http_request(conn, (void *)tcp + IP_HDR_SIZE + hdr_len,
+					data_len);
+		conn->rcv_nxt += data_len;
+	}
+
+	acked = ntohl(tcp->tcp_ack) - conn->iss - 1;
+	if (acked > conn->acked && acked <= conn->sent)
+		conn->acked = acked;
+
+	if (tcp->tcp_flags & TCP_FIN) {
+		conn->rcv_nxt = ntohl(tcp->tcp_seq) + data_len + 1;
+		if (priv->recv_packets < PKTBUFSRX)
+			sb_http_send(dev, conn,
+				     conn->hdr_len + conn->len + 1, TCP_ACK, 0);
+		return 0;
+	}
+
+	sb_http_fill(dev);
+
+	return 0;
+}
+
+static int sb_http_server_handler(struct udevice *dev, void *packet,
+				  unsigned int len)
+{
+	struct ethernet_hdr *eth = packet;
+	struct ip_hdr *ip = packet + ETHER_HDR_SIZE;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		return sb_arp_handler(dev, packet, len);
+	if (ntohs(eth->et_protlen) == PROT_IP && ip->ip_p == IPPROTO_TCP)
+		return sb_http_tcp_handler(dev, packet, len);
+
+	return -EPROTONOSUPPORT;
+}
+
+/* Fetch the file from the server set up in sb_http and check it */
+static int sb_http_wget(struct unit_test_state *uts)
+{
+	char *prev_ethact = env_get("ethact");
+	char *prev_ethrotate = env_get("ethrotate");
+	u8 *ptr;
+	int i;
+
+	ptr = map_sysmem(0x20000, SB_HTTP_FILE_SIZE);
+	memset(ptr, '\0', SB_HTTP_FILE_SIZE);
+
+	sandbox_eth_set_tx_handler(0, sb_http_server_handler);
+	sandbox_eth_set_priv(0, uts);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	ut_assertok(run_command("wget 0x20000 1.1.2.2:/file.bin", 0));
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("ethact", prev_ethact);
+	env_set("ethrotate", prev_ethrotate);
+
+	ut_asserteq(SB_HTTP_FILE_SIZE, env_get_hex("filesize", 0));
+	for (i = 0; i < SB_HTTP_FILE_SIZE; i++)
+		ut_asserteq(sb_http_byte(i), ptr[i]);
+	unmap_sysmem(ptr);
+
+	return 0;
+}
+
+/* The server does not accept ranges, so the file is fetched in one go */
+static int net_test_wget_no_ranges(struct unit_test_state *uts)
+{
+	if (CONFIG_WGET_CONNECTIONS < 2)
+		return -EAGAIN;
+
+	memset(&sb_http, '\0', sizeof(sb_http));
+	ut_assertok(sb_http_wget(uts));
+	ut_asserteq(2, sb_http.nreqs);
+	ut_asserteq_str("HEAD /file.bin HTTP/1.0", sb_http.reqs[0]);
+	ut_asserteq_str("GET /file.bin HTTP/1.0", sb_http.reqs[1]);
+
+	return 0;
+}
+CMD_TEST(net_test_wget_no_ranges, 0);
+
+/* The file is split in two parts, fetched over connections of their own */
+static int net_test_wget_ranges(struct unit_test_state *uts)
+{
+	const char *part1 = "GET /file.bin HTTP/1.0 Range: bytes=0-81919";
+	const char *part2 = "GET /file.bin HTTP/1.0 Range: bytes=81920-163839";
+
+	if (CONFIG_WGET_CONNECTIONS < 2)
+		return -EAGAIN;
+
+	memset(&sb_http, '\0', sizeof(sb_http));
+	sb_http.ranges = true;
+	ut_assertok(sb_http_wget(uts));
+	ut_asserteq(3, sb_http.nreqs);
+	ut_asserteq_str("HEAD /file.bin HTTP/1.0", sb_http.reqs[0]);
+	/* the requests for the parts may be sent in either order */
+	ut_assert((!strcmp(part1, sb_http.reqs[1]) &&
+		   !strcmp(part2, sb_http.reqs[2])) ||
+		  (!strcmp(part2, sb_http.reqs[1]) &&
+		   !strcmp(part1, sb_http.reqs[2])));
+
+	return 0;
+}
+CMD_TEST(net_test_wget_ranges, 0);
+
 static int net_test_wget_uri_validate(struct unit_test_state *uts)
 {
 	ut_asserteq(true, wget_validate_uri("http://foo.com/bar.html"));
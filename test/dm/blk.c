@@ -11,6 +11,7 @@
 #include <asm/global_data.h>
 #include <asm/state.h>
 #include <dm/test.h>
+#include <linux/sizes.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -334,3 +335,144 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+/* Test the block cache: partial hits, LRU eviction and invalidation */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats;
+	struct blk_desc *desc;
+	char write[16 * 512], read[4 * 512];
+	int i;
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &desc));
+	ut_asserteq(512, desc->blksz);
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i ^ (i >> 9);
+	ut_asserteq(16, blk_dwrite(desc, 0, 16, write));
+
+	/* room for two entries of four blocks each */
+	blkcache_configure(4, 8 * 512);
+
+	ut_asserteq(4, blk_dread(desc, 0, 4, read));
+	ut_asserteq_mem(write, read, 4 * 512);
+	ut_asserteq(2, blk_dread(desc, 1, 2, read));
+	ut_asserteq_mem(&write[512], read, 2 * 512);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(1, stats.entries);
+	ut_asserteq(4 * 512, stats.size);
+
+	/* the third entry pushes out the least-recently used one */
+	ut_asserteq(4, blk_dread(desc, 4, 4, read));
+	ut_asserteq(1, blk_dread(desc, 3, 1, read));
+	ut_asserteq(4, blk_dread(desc, 8, 4, read));
+	ut_asserteq_mem(&write[8 * 512], read, 4 * 512);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(2, stats.misses);
+	ut_asserteq(1, stats.evictions);
+	ut_asserteq(2, stats.entries);
+	ut_asserteq(8 * 512, stats.size);
+
+	ut_asserteq(1, blk_dread(desc, 7, 1, read));
+	ut_asserteq_mem(&write[7 * 512], read, 512);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+	ut_asserteq(1, stats.misses);
+
+	/* a write drops everything cached for the device */
+	ut_asserteq(1, blk_dwrite(desc, 9, 1, write));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(1, blk_dread(desc, 9, 1, read));
+	ut_asserteq_mem(write, read, 512);
+
+	blkcache_configure(8, CONFIG_BLOCK_CACHE_SIZE);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+#endif
+
+/* Test asynchronous requests on a device which only supports sync I/O */
+static int dm_test_blk_async(struct unit_test_state *uts)
+{
+	char write[8 * 512], read[8 * 512];
+	struct blk_req wreq[2], rreq[3];
+	struct blk_desc *desc;
+	int i;
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &desc));
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i * 3 ^ (i >> 9);
+
+	/* two writes in flight at once */
+	ut_assertok(blk_submit_write(desc->bdev, 0, 4, write, &wreq[0]));
+	ut_assertok(blk_submit_write(desc->bdev, 4, 4, &write[4 * 512],
+				     &wreq[1]));
+	ut_asserteq(4, blk_wait(&wreq[1]));
+	ut_asserteq(4, blk_wait(&wreq[0]));
+
+	/* three reads, collected out of order */
+	memset(read, '\0', sizeof(read));
+	ut_assertok(blk_submit_read(desc->bdev, 0, 2, read, &rreq[0]));
+	ut_assertok(blk_submit_read(desc->bdev, 2, 5, &read[2 * 512],
+				    &rreq[1]));
+	ut_assertok(blk_submit_read(desc->bdev, 7, 1, &read[7 * 512],
+				    &rreq[2]));
+	ut_asserteq(1, blk_wait(&rreq[2]));
+	ut_assertok(blk_poll(&rreq[0]));
+	ut_asserteq(2, rreq[0].result);
+	ut_asserteq(5, blk_wait(&rreq[1]));
+	ut_asserteq_mem(write, read, sizeof(read));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+/* Test that sequential reads are served from the readahead windows */
+static int dm_test_blk_readahead(struct unit_test_state *uts)
+{
+	struct blk_readahead_stats stats;
+	char write[128 * 512], read[512];
+	struct blk_desc *desc;
+	ulong mem;
+	int i;
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &desc));
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i ^ (i >> 9);
+	ut_asserteq(128, blk_dwrite(desc, 0, 128, write));
+
+	blk_readahead_stats(&stats);
+	mem = ut_check_free();
+	blk_readahead_start(desc);
+
+	/* the windows are only allocated once they are filled */
+	ut_assert(ut_check_delta(mem) < SZ_4K);
+	for (i = 0; i < 128; i++) {
+		ut_asserteq(1, blk_dread(desc, i, 1, read));
+		ut_asserteq_mem(&write[i * 512], read, 512);
+	}
+
+	/* a 128KiB window and the following 256KiB one */
+	ut_assert(ut_check_delta(mem) < SZ_512K);
+	blk_readahead_stop(desc);
+	ut_assertnull(desc->ra);
+
+	/*
+	 * The first read is passed through, the second fills a window and
+	 * queues the next one, then the rest are merged
+	 */
+	blk_readahead_stats(&stats);
+	ut_asserteq(128, stats.requests);
+	ut_asserteq(126, stats.merged);
+	ut_asserteq(2, stats.reads);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_readahead, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+#endif
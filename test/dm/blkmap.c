@@ -8,6 +8,10 @@
 #include <blkmap.h>
 #include <dm.h>
 #include <env.h>
+#include <fat.h>
+#include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
 #include <asm/test.h>
 #include <dm/test.h>
 #include <test/test.h>
@@ -137,6 +141,187 @@ static int dm_test_blkmap_slicing(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_blkmap_slicing, 0);
 
+static int lazy_fills;
+
+static int lazy_fill(void *priv, u64 offset, ulong len, void *buf)
+{
+	int i;
+
+	/* Each block is filled with its own block number */
+	for (i = 0; i < len / BLKSZ; i++)
+		memset(buf + i * BLKSZ, (offset / BLKSZ) + i, BLKSZ);
+
+	lazy_fills++;
+	return 0;
+}
+
+static int dm_test_blkmap_lazy(struct unit_test_state *uts)
+{
+	struct udevice *dev, *blk;
+	int i;
+
+	ut_assertok(blkmap_create("lazytest", &dev));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+
+	ut_assertok(blkmap_map_zero(dev, 0, 4));
+	ut_assertok(blkmap_map_lazy(dev, 4, 4, lazy_fill, NULL, NULL));
+	lazy_fills = 0;
+
+	/* Nothing is fetched until the slice is read */
+	memset(buffer, 0xff, sizeof(buffer));
+	ut_asserteq(4, blk_read(blk, 0, 4, buffer));
+	ut_asserteq(0, lazy_fills);
+	for (i = 0; i < 4 * BLKSZ; i++)
+		ut_asserteq(0, buffer[i]);
+
+	/* A read spanning both slices */
+	ut_asserteq(4, blk_read(blk, 2, 4, buffer));
+	ut_asserteq(1, lazy_fills);
+	ut_asserteq(0, buffer[BLKSZ]);
+	ut_asserteq(0, buffer[2 * BLKSZ]);
+	ut_asserteq(1, buffer[3 * BLKSZ]);
+
+	/* Further reads are served from memory */
+	ut_asserteq(2, blk_read(blk, 6, 2, buffer));
+	ut_asserteq(1, lazy_fills);
+	ut_asserteq(2, buffer[0]);
+	ut_asserteq(3, buffer[BLKSZ]);
+
+	/* Neither slice can be written */
+	ut_asserteq(0, blk_write(blk, 0, 1, buffer));
+	ut_asserteq(0, blk_write(blk, 4, 1, buffer));
+
+	ut_assertok(blkmap_destroy(dev));
+	return 0;
+}
+DM_TEST(dm_test_blkmap_lazy, 0);
+
+/* Size of a filesystem made by mkfat() holding a file of @size bytes */
+#define FAT_SIZE(size)	((3 + DIV_ROUND_UP(size, BLKSZ)) * BLKSZ)
+
+/*
+ * Budget mkfs.fat, like create_fat() in test/image/spl_load_fs.c: FAT32 with
+ * one-sector clusters, a single one-sector FAT and a single file in the root
+ * directory, which starts at cluster 2. The second half of the file is stored
+ * before its first half, so that it takes two extents. The rest of its last
+ * cluster is filled with 0x55. @dst must be zeroed.
+ */
+static void mkfat(void *dst, const char *name, const void *data, size_t size)
+{
+	u32 clusters = DIV_ROUND_UP(size, BLKSZ);
+	u32 half = clusters / 2;
+	struct boot_sector *bs = dst;
+	struct volume_info *vi = (void *)(bs + 1);
+	__le32 *fat = dst + BLKSZ;
+	struct dir_entry *dirent = dst + 2 * BLKSZ;
+	u32 clust, first = 0, i;
+
+	bs->sector_size[0] = BLKSZ & 0xff;
+	bs->sector_size[1] = BLKSZ >> 8;
+	bs->cluster_size = 1;
+	bs->reserved = cpu_to_le16(1);
+	bs->fats = 1;
+	bs->media = 0xf8;
+	bs->total_sect = cpu_to_le32(3 + clusters);
+	bs->fat32_length = cpu_to_le32(1);
+	bs->root_cluster = cpu_to_le32(2);
+
+	vi->ext_boot_sign = 0x29;
+	memcpy(vi->fs_type, "FAT32   ", sizeof(vi->fs_type));
+	memcpy(dst + 0x1fe, "\x55\xAA", 2);
+
+	fat[0] = cpu_to_le32(0x0ffffff8);
+	fat[1] = cpu_to_le32(0x0fffffff);
+	fat[2] = cpu_to_le32(0x0ffffff8);
+	for (i = 0; i < clusters; i++) {
+		clust = 3 + (i < half ? clusters - half + i : i - half);
+		if (!i)
+			first = clust;
+		fat[clust] = cpu_to_le32(i + 1 < clusters ?
+					 (i + 1 < half ?
+					  clust + 1 : 3 + i + 1 - half) :
+					 0x0ffffff8);
+		memset(dst + clust * BLKSZ, 0x55, BLKSZ);
+		memcpy(dst + clust * BLKSZ, data + i * BLKSZ,
+		       min_t(size_t, BLKSZ, size - i * BLKSZ));
+	}
+
+	memcpy(dirent->nameext.name, name, sizeof(dirent->nameext.name));
+	memcpy(dirent->nameext.ext, name + sizeof(dirent->nameext.name),
+	       sizeof(dirent->nameext.ext));
+	dirent->start = cpu_to_le16(first);
+	dirent->size = cpu_to_le32(size);
+}
+
+#define HELLO_SIZE	1000
+#define IMAGE_SIZE	(FAT_SIZE(HELLO_SIZE) + 100)
+
+static int dm_test_blkmap_file(struct unit_test_state *uts)
+{
+	char *hello, *image, *disk, *data;
+	struct udevice *dev, *diskdev, *blk;
+	struct blk_desc *desc;
+	loff_t actread;
+	int i;
+
+	/*
+	 * A disk holding a file, which is itself the image of a filesystem
+	 * holding hello.txt, followed by some padding
+	 */
+	hello = malloc(HELLO_SIZE);
+	image = calloc(1, IMAGE_SIZE);
+	disk = calloc(1, FAT_SIZE(IMAGE_SIZE));
+	data = malloc(HELLO_SIZE);
+	ut_assertnonnull(hello);
+	ut_assertnonnull(image);
+	ut_assertnonnull(disk);
+	ut_assertnonnull(data);
+	for (i = 0; i < HELLO_SIZE; i++)
+		hello[i] = i;
+	mkfat(image, "HELLO   TXT", hello, HELLO_SIZE);
+	memset(image + FAT_SIZE(HELLO_SIZE), 0xaa, 100);
+	mkfat(disk, "IMAGE   BIN", image, IMAGE_SIZE);
+
+	ut_assertok(blkmap_create("disk", &diskdev));
+	ut_assertok(blkmap_map_mem(diskdev, 0, FAT_SIZE(IMAGE_SIZE) / BLKSZ,
+				   disk));
+	ut_assertok(blk_get_from_parent(diskdev, &blk));
+	desc = dev_get_uclass_plat(blk);
+
+	ut_assertok(blkmap_create("image", &dev));
+	ut_assertok(blkmap_map_file(dev, 0, 8, desc, 0, "/image.bin"));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+
+	/*
+	 * The filesystem in the file can be used while nothing of the file
+	 * has been read yet, since no other filesystem is needed to read it
+	 */
+	ut_assertok(fs_set_blk_dev_with_part(dev_get_uclass_plat(blk), 0));
+	ut_assertok(fs_read("/hello.txt", map_to_sysmem(data), 0, 0,
+			    &actread));
+	ut_asserteq(HELLO_SIZE, actread);
+	ut_asserteq_mem(hello, data, HELLO_SIZE);
+
+	/* The file is followed by zeroes, not by the rest of its cluster */
+	ut_asserteq(8, blk_read(blk, 0, 8, buffer));
+	ut_asserteq_mem(image, buffer, IMAGE_SIZE);
+	for (i = IMAGE_SIZE; i < 8 * BLKSZ; i++)
+		ut_asserteq(0, buffer[i]);
+
+	/* The file cannot be written through the mapping */
+	ut_asserteq(0, blk_write(blk, 0, 1, buffer));
+
+	ut_assertok(blkmap_destroy(dev));
+	ut_assertok(blkmap_destroy(diskdev));
+	free(data);
+	free(disk);
+	free(image);
+	free(hello);
+
+	return 0;
+}
+DM_TEST(dm_test_blkmap_file, 0);
+
 static int dm_test_blkmap_creation(struct unit_test_state *uts)
 {
 	struct udevice *first, *second;
@@ -12,6 +12,7 @@
 #include <dma.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include <linux/sizes.h>
 
 static int dm_test_dma_m2m(struct unit_test_state *uts)
 {
@@ -36,6 +37,50 @@ static int dm_test_dma_m2m(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_dma_m2m, UTF_SCAN_FDT);
 
+static int dm_test_dma_bulk_copy(struct unit_test_state *uts)
+{
+	size_t len = SZ_256K + 5;
+	u8 *src, *dst;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(DMA_BULK_COPY))
+		return -EAGAIN;
+
+	src = malloc(len + 3);
+	dst = malloc(len + 3);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	for (i = 0; i < len + 3; i++)
+		src[i] = i ^ (i >> 8);
+
+	/* equally misaligned, so the middle goes to the DMA engine */
+	memset(dst, '\0', len + 3);
+	ut_asserteq_ptr(dst + 3, dma_bulk_copy(dst + 3, src + 3, len));
+	ut_asserteq_mem(src + 3, dst + 3, len);
+	ut_asserteq(0, dst[0] | dst[1] | dst[2]);
+
+	/* differently aligned and short copies are left to the CPU */
+	memset(dst, '\0', len + 3);
+	ut_asserteq(-EINVAL, dma_bulk_copy_try(dst + 1, src, len));
+	ut_asserteq(-EINVAL, dma_bulk_copy_try(dst, src, 7));
+	ut_asserteq(0, dst[2] | dst[len]);
+	ut_asserteq_ptr(dst + 1, dma_bulk_copy(dst + 1, src, len));
+	ut_asserteq_mem(src, dst + 1, len);
+	ut_asserteq_ptr(dst, dma_bulk_copy(dst, src, 7));
+	ut_asserteq_mem(src, dst, 7);
+
+	/* overlapping areas are moved */
+	memcpy(dst, src, len);
+	ut_asserteq_ptr(dst + 2, dma_bulk_copy(dst + 2, dst, len));
+	ut_asserteq_mem(src, dst + 2, len);
+
+	free(dst);
+	free(src);
+
+	return 0;
+}
+DM_TEST(dm_test_dma_bulk_copy, UTF_SCAN_FDT);
+
 static int dm_test_dma(struct unit_test_state *uts)
 {
 	struct udevice *dev;
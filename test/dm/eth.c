@@ -14,6 +14,7 @@
 #include <net.h>
 #include <net6.h>
 #include <asm/eth.h>
+#include <asm/unaligned.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -623,6 +624,159 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 DM_TEST(dm_test_eth_async_ping_reply, UTF_SCAN_FDT);
 #endif
 
+#if IS_ENABLED(CONFIG_NET_RX_PLACE)
+#define RX_PLACE_PORT	4444
+#define RX_PLACE_LEN	64
+#define RX_PLACE_COUNT	8
+
+static u8 rx_place_home[RX_PLACE_COUNT * RX_PLACE_LEN];
+static ulong rx_place_next_seq;
+static int rx_place_placed;
+static int rx_place_copied;
+static int rx_place_deferred;
+
+static ulong rx_place_next(void)
+{
+	return rx_place_next_seq;
+}
+
+static void *rx_place_dest(ulong seq)
+{
+	if (!seq || seq > RX_PLACE_COUNT)
+		return NULL;
+
+	return rx_place_home + (seq - 1) * RX_PLACE_LEN;
+}
+
+static bool rx_place_check(struct ip_udp_hdr *ip, ulong seq)
+{
+	return get_unaligned_be32(ip + 1) == seq;
+}
+
+static const struct net_rx_place rx_place_test = {
+	.hdr_len	= 4,
+	.len		= RX_PLACE_LEN,
+	.port		= RX_PLACE_PORT,
+	.next		= rx_place_next,
+	.dest		= rx_place_dest,
+	.check		= rx_place_check,
+};
+
+static void rx_place_handler(uchar *pkt, unsigned int dport,
+			     struct in_addr sip, unsigned int sport,
+			     unsigned int len)
+{
+	ulong seq = get_unaligned_be32(pkt);
+	uchar *src = net_rx_payload(pkt + 4);
+
+	if (dport != RX_PLACE_PORT)
+		return;
+	if (!net_rx_place_claim(seq)) {
+		if (net_rx_place_defer(seq, src, len - 4))
+			rx_place_deferred++;
+		return;
+	}
+
+	if (src == rx_place_dest(seq)) {
+		rx_place_placed++;
+	} else {
+		memcpy(rx_place_dest(seq), src, len - 4);
+		rx_place_copied++;
+	}
+	if (seq == rx_place_next_seq)
+		rx_place_next_seq++;
+}
+
+/* Queue a packet carrying a block of data on the sandbox device */
+static void rx_place_inject(struct udevice *dev, ulong seq)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	uchar *pkt = priv->recv_packet_buffer[priv->recv_packets];
+	struct ethernet_hdr *et = (struct ethernet_hdr *)pkt;
+	uchar *data = pkt + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+
+	memcpy(et->et_dest, net_ethaddr, ARP_HLEN);
+	memcpy(et->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	et->et_protlen = htons(PROT_IP);
+	net_set_udp_header(pkt + ETHER_HDR_SIZE, net_ip, RX_PLACE_PORT, 69,
+			   4 + RX_PLACE_LEN);
+	put_unaligned_be32(seq, data);
+	memset(data + 4, seq, RX_PLACE_LEN);
+	priv->recv_packet_length[priv->recv_packets++] = ETHER_HDR_SIZE +
+		IP_UDP_HDR_SIZE + 4 + RX_PLACE_LEN;
+}
+
+static int dm_test_eth_rx_place(struct unit_test_state *uts)
+{
+	static const ulong order[] = { 1, 2, 4, 3 };
+	struct in_addr old_ip = net_ip;
+	u8 expect[RX_PLACE_LEN];
+	struct eth_rx_dest held;
+	struct udevice *dev, *other;
+	int i;
+
+	ut_assertok(net_init());
+	env_set("ethact", "eth@10002000");
+	ut_assertok(eth_init());
+	dev = eth_get_dev();
+	ut_assertnonnull(dev);
+
+	net_ip = string_to_ip("1.1.2.2");
+	memset(rx_place_home, '\0', sizeof(rx_place_home));
+	rx_place_next_seq = 1;
+	rx_place_placed = 0;
+	rx_place_copied = 0;
+	rx_place_deferred = 0;
+	net_set_udp_handler(rx_place_handler);
+	ut_assertok(net_set_rx_place(&rx_place_test));
+
+	/*
+	 * Blocks received in order go straight to their destination; the
+	 * others are put back together and copied by the handler
+	 */
+	for (i = 0; i < ARRAY_SIZE(order); i++)
+		rx_place_inject(dev, order[i]);
+	ut_assertok(eth_rx());
+	ut_asserteq(2, rx_place_placed);
+	ut_asserteq(2, rx_place_copied);
+	for (i = 1; i <= ARRAY_SIZE(order); i++) {
+		memset(expect, i, sizeof(expect));
+		ut_asserteq_mem(expect, rx_place_dest(i), RX_PLACE_LEN);
+	}
+
+	/* only the current device gets destinations */
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10003000",
+					      &other));
+	ut_asserteq(-ENOENT, eth_rx_place_get(other, 0, &held));
+
+	/*
+	 * A block arriving while its own destination is still set up in a
+	 * receive buffer is kept until that buffer comes back, here with a
+	 * frame which is dropped
+	 */
+	memset(rx_place_home, '\0', sizeof(rx_place_home));
+	rx_place_next_seq = 5;
+	ut_assertok(eth_rx_place_get(dev, 1, &held));
+	ut_asserteq(6, held.seq);
+	rx_place_inject(dev, 6);
+	ut_assertok(eth_rx());
+	ut_asserteq(1, rx_place_deferred);
+	memset(held.data, 0xff, RX_PLACE_LEN);
+	eth_rx_place_split(&held);
+	eth_rx_place_prepare();
+	memset(expect, 6, sizeof(expect));
+	ut_asserteq_mem(expect, rx_place_dest(6), RX_PLACE_LEN);
+
+	ut_assertok(net_set_rx_place(NULL));
+	net_set_udp_handler(NULL);
+	net_ip = old_ip;
+	eth_halt();
+
+	return 0;
+}
+DM_TEST(dm_test_eth_rx_place, UTF_SCAN_FDT);
+#endif
+
 #if IS_ENABLED(CONFIG_IPV6_ROUTER_DISCOVERY)
 
 static u8 ip6_ra_buf[] = {0x60, 0xf, 0xc5, 0x4a, 0x0, 0x38, 0x3a, 0xff, 0xfe,
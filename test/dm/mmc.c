@@ -3,12 +3,14 @@
  * Copyright (C) 2015 Google, Inc
  */
 
+#include <bloblist.h>
 #include <dm.h>
 #include <mmc.h>
 #include <part.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include "../../drivers/mmc/mmc_private.h"
 
 /*
  * Basic test of the mmc uclass. We could expand this by implementing an MMC
@@ -51,3 +53,64 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Initialise the card again, as a later boot phase would */
+static int mmc_test_reinit(struct unit_test_state *uts, struct mmc *mmc)
+{
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+
+	return 0;
+}
+
+/* Test reusing the bus settings recorded for a card */
+static int dm_test_mmc_tuning_cache(struct unit_test_state *uts)
+{
+	struct mmc_tuning_cache *cache;
+	struct mmc_tuning_entry *ent;
+	enum bus_mode best;
+	struct udevice *dev;
+	struct mmc *mmc;
+	uint caps;
+
+	if (!CONFIG_IS_ENABLED(MMC_TUNING_CACHE))
+		return -EAGAIN;
+	ut_assertok(uclass_get_device_by_seq(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertok(mmc_init(mmc));
+
+	/* miss: the full negotiation is done and its result recorded */
+	cache = bloblist_find(BLOBLISTT_U_BOOT_MMC_TUNING, sizeof(*cache));
+	if (cache)
+		memset(cache, '\0', sizeof(*cache));
+	ut_assertok(mmc_test_reinit(uts, mmc));
+	best = mmc->selected_mode;
+	ut_asserteq(4, mmc->bus_width);
+	cache = bloblist_find(BLOBLISTT_U_BOOT_MMC_TUNING, sizeof(*cache));
+	ut_assertnonnull(cache);
+	ent = &cache->entry[0];
+	ut_asserteq_mem(mmc->cid, ent->cid, sizeof(ent->cid));
+	ut_asserteq(best, ent->mode);
+	ut_asserteq(MMC_MODE_4BIT, ent->width);
+	caps = ent->caps;
+	ut_assert(caps & MMC_MODE_4BIT);
+
+	/* hit: the recorded settings are used, even if not the best */
+	ent->width = MMC_MODE_1BIT;
+	ut_assertok(mmc_test_reinit(uts, mmc));
+	ut_asserteq(best, mmc->selected_mode);
+	ut_asserteq(1, mmc->bus_width);
+	ut_asserteq(MMC_MODE_1BIT, ent->width);
+
+	/* stale: settings chosen from other capabilities are ignored */
+	ent->caps = caps ^ MMC_CAP(SD_HS);
+	ut_assertok(mmc_test_reinit(uts, mmc));
+	ut_asserteq(best, mmc->selected_mode);
+	ut_asserteq(4, mmc->bus_width);
+	ut_asserteq(caps, ent->caps);
+	ut_asserteq(best, ent->mode);
+	ut_asserteq(MMC_MODE_4BIT, ent->width);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_tuning_cache, UTF_SCAN_PDATA | UTF_SCAN_FDT);
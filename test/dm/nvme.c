@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the asynchronous I/O path of the NVMe driver
+ *
+ * There is no NVMe emulator for sandbox, so these set up an I/O queue in
+ * memory and complete its commands by hand.
+ */
+
+#include <blk.h>
+#include <dm.h>
+#include <malloc.h>
+#include <time.h>
+#include <asm/io.h>
+#include <asm/test.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include "../../drivers/nvme/nvme.h"
+
+#define QUEUE_DEPTH	4
+
+/* The I/O timeout of the driver, plus a little */
+#define TIMEOUT_MS	3100
+
+/**
+ * struct nvme_fake - an NVMe I/O queue with nothing behind it
+ *
+ * @dev: Device, with only the fields used by the I/O path set up
+ * @ns: Namespace with 512-byte blocks
+ * @queues: Queues of @dev, only the I/O queue is present
+ * @db: Doorbells of the I/O queue
+ * @cq_tail: Next completion queue entry to fill
+ * @cq_phase: Phase of the completion queue entries being filled
+ */
+struct nvme_fake {
+	struct nvme_dev dev;
+	struct nvme_ns ns;
+	struct nvme_queue *queues[NVME_Q_NUM];
+	u32 db[2];
+	u16 cq_tail;
+	bool cq_phase;
+};
+
+static int nvme_fake_init(struct unit_test_state *uts, struct nvme_fake *priv)
+{
+	struct nvme_queue *nvmeq;
+
+	memset(priv, '\0', sizeof(*priv));
+	priv->dev.queues = priv->queues;
+	priv->dev.page_size = 4096;
+	priv->dev.db_stride = 1;
+	/* 8 blocks per command */
+	priv->dev.max_transfer_shift = 12;
+	priv->ns.dev = &priv->dev;
+	priv->ns.ns_id = 1;
+	priv->ns.lba_shift = 9;
+	priv->cq_phase = true;
+
+	nvmeq = calloc(1, sizeof(*nvmeq));
+	ut_assertnonnull(nvmeq);
+	nvmeq->dev = &priv->dev;
+	nvmeq->q_depth = QUEUE_DEPTH;
+	nvmeq->q_db = priv->db;
+	nvmeq->cq_phase = 1;
+	nvmeq->cqes = calloc(QUEUE_DEPTH, sizeof(struct nvme_completion));
+	ut_assertnonnull(nvmeq->cqes);
+	nvmeq->sq_cmds = calloc(QUEUE_DEPTH, sizeof(struct nvme_command));
+	ut_assertnonnull(nvmeq->sq_cmds);
+	priv->queues[NVME_IO_Q] = nvmeq;
+
+	return 0;
+}
+
+static void nvme_fake_free(struct nvme_fake *priv)
+{
+	struct nvme_queue *nvmeq = priv->queues[NVME_IO_Q];
+
+	free(nvmeq->async);
+	free(nvmeq->cqes);
+	free(nvmeq->sq_cmds);
+	free(nvmeq);
+}
+
+/* Complete a command successfully, as the controller would */
+static void nvme_fake_complete(struct nvme_fake *priv, u16 cid)
+{
+	struct nvme_queue *nvmeq = priv->queues[NVME_IO_Q];
+	struct nvme_completion *cqe = &nvmeq->cqes[priv->cq_tail];
+
+	cqe->command_id = cid;
+	cqe->status = priv->cq_phase;
+	if (++priv->cq_tail == QUEUE_DEPTH) {
+		priv->cq_tail = 0;
+		priv->cq_phase = !priv->cq_phase;
+	}
+}
+
+/* Get the command ID of a command in the submission queue */
+static u16 nvme_fake_cid(struct nvme_fake *priv, int index)
+{
+	struct nvme_command *cmd = &priv->queues[NVME_IO_Q]->sq_cmds[index];
+
+	return le16_to_cpu(cmd->rw.command_id);
+}
+
+/* Test that the slots of timed-out commands are kept until they complete */
+static int dm_test_nvme_async_timeout(struct unit_test_state *uts)
+{
+	struct nvme_queue *nvmeq;
+	struct nvme_fake priv;
+	struct blk_req req1, req2;
+	char *buf;
+
+	buf = memalign(4096, 24 * 512);
+	ut_assertnonnull(buf);
+	ut_assertok(nvme_fake_init(uts, &priv));
+	nvmeq = priv.queues[NVME_IO_Q];
+	sandbox_set_enable_memio(true);
+
+	/* two commands, with only the first completing */
+	memset(&req1, '\0', sizeof(req1));
+	req1.blkcnt = 16;
+	req1.buffer = buf;
+	ut_assertok(nvme_async_submit(&priv.ns, &req1));
+	ut_asserteq(2, req1.pending);
+	ut_asserteq(0, nvme_fake_cid(&priv, 0));
+	ut_asserteq(1, nvme_fake_cid(&priv, 1));
+	nvme_fake_complete(&priv, 0);
+	ut_asserteq(-EBUSY, nvme_async_poll(&priv.ns, &req1));
+	ut_asserteq(1, req1.pending);
+
+	/* the second command may still be in flight, so its slot is kept */
+	timer_test_add_offset(TIMEOUT_MS);
+	ut_asserteq(-ETIMEDOUT, nvme_async_poll(&priv.ns, &req1));
+	ut_asserteq(1, nvmeq->async_count);
+
+	/* three commands are allowed in flight, so only two fit now */
+	memset(&req2, '\0', sizeof(req2));
+	req2.blkcnt = 24;
+	req2.buffer = buf;
+	ut_assertok(nvme_async_submit(&priv.ns, &req2));
+	ut_asserteq(2, req2.pending);
+	ut_asserteq(16, req2.issued);
+	ut_asserteq(0, nvme_fake_cid(&priv, 2));
+	ut_asserteq(2, nvme_fake_cid(&priv, 3));
+	ut_asserteq(-EBUSY, nvme_async_poll(&priv.ns, &req2));
+	ut_asserteq(2, req2.pending);
+
+	/* the late completion frees the slot without touching either request */
+	nvme_fake_complete(&priv, 1);
+	ut_asserteq(-EBUSY, nvme_async_poll(&priv.ns, &req2));
+	ut_asserteq(0, req1.pending);
+	ut_asserteq(3, req2.pending);
+	ut_asserteq(24, req2.issued);
+	ut_asserteq(1, nvme_fake_cid(&priv, 0));
+
+	nvme_fake_complete(&priv, 0);
+	nvme_fake_complete(&priv, 2);
+	nvme_fake_complete(&priv, 1);
+	ut_assertok(nvme_async_poll(&priv.ns, &req2));
+	ut_asserteq(24, req2.result);
+	ut_assertok(req2.err);
+	ut_asserteq(0, nvmeq->async_count);
+
+	sandbox_set_enable_memio(false);
+	nvme_fake_free(&priv);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_nvme_async_timeout, 0);
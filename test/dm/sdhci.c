@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the pre-defined block counts (CMD23) of the SDHCI driver
+ *
+ * There is no SDHCI emulator for sandbox, so these put a fake controller
+ * behind the register accessors of the driver. It completes each command
+ * at once and returns a counter as the data of reads.
+ */
+
+#include <dm.h>
+#include <mmc.h>
+#include <sdhci.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/**
+ * struct sdhci_fake_plat - configuration of the fake controller
+ *
+ * @cfg: MMC configuration
+ * @mmc: MMC device
+ */
+struct sdhci_fake_plat {
+	struct mmc_config cfg;
+	struct mmc mmc;
+};
+
+/**
+ * struct sdhci_fake_priv - state of the fake controller
+ *
+ * @host: SDHCI host, whose register accesses come here
+ * @regs: Registers which just keep what is written to them
+ * @int_status: Interrupt status, bits are cleared by writing 1 to them
+ * @blocks: Number of blocks of the current command still to be read
+ * @words: Number of words of the current block still to be read
+ * @data: Next word to return from the buffer
+ * @arg2: Last value written to SDHCI_ARGUMENT2
+ * @mode: Transfer mode of the last data command
+ * @cmds: Indexes of the commands sent, in order
+ * @count: Number of commands sent
+ */
+struct sdhci_fake_priv {
+	struct sdhci_host host;
+	u8 regs[0x100];
+	u32 int_status;
+	uint blocks;
+	uint words;
+	u32 data;
+	u32 arg2;
+	u16 mode;
+	u8 cmds[8];
+	int count;
+};
+
+static struct sdhci_fake_priv *sdhci_fake_priv(struct sdhci_host *host)
+{
+	return container_of(host, struct sdhci_fake_priv, host);
+}
+
+static u32 sdhci_fake_read_l(struct sdhci_host *host, int reg)
+{
+	struct sdhci_fake_priv *priv = sdhci_fake_priv(host);
+
+	switch (reg) {
+	case SDHCI_INT_STATUS:
+		/* the next block arrives once the last one is read */
+		if (priv->blocks && !priv->words) {
+			priv->words = (*(u16 *)&priv->regs[SDHCI_BLOCK_SIZE] &
+				       0xfff) / 4;
+			priv->int_status |= SDHCI_INT_DATA_AVAIL;
+		}
+		return priv->int_status;
+	case SDHCI_PRESENT_STATE:
+		return priv->words ? SDHCI_DATA_AVAILABLE : 0;
+	case SDHCI_BUFFER:
+		if (priv->words && !--priv->words && !--priv->blocks)
+			priv->int_status |= SDHCI_INT_DATA_END;
+		return priv->data++;
+	}
+
+	return *(u32 *)&priv->regs[reg];
+}
+
+static u16 sdhci_fake_read_w(struct sdhci_host *host, int reg)
+{
+	return *(u16 *)&sdhci_fake_priv(host)->regs[reg];
+}
+
+static u8 sdhci_fake_read_b(struct sdhci_host *host, int reg)
+{
+	return sdhci_fake_priv(host)->regs[reg];
+}
+
+static void sdhci_fake_write_l(struct sdhci_host *host, u32 val, int reg)
+{
+	struct sdhci_fake_priv *priv = sdhci_fake_priv(host);
+
+	if (reg == SDHCI_INT_STATUS) {
+		priv->int_status &= ~val;
+		return;
+	}
+	if (reg == SDHCI_ARGUMENT2)
+		priv->arg2 = val;
+	*(u32 *)&priv->regs[reg] = val;
+}
+
+static void sdhci_fake_write_w(struct sdhci_host *host, u16 val, int reg)
+{
+	struct sdhci_fake_priv *priv = sdhci_fake_priv(host);
+
+	if (reg == SDHCI_COMMAND) {
+		if (priv->count < ARRAY_SIZE(priv->cmds))
+			priv->cmds[priv->count++] = SDHCI_GET_CMD(val);
+		priv->int_status |= SDHCI_INT_RESPONSE;
+		if (val & SDHCI_CMD_DATA) {
+			priv->blocks = *(u16 *)&priv->regs[SDHCI_BLOCK_COUNT];
+			priv->mode = *(u16 *)&priv->regs[SDHCI_TRANSFER_MODE];
+		}
+	}
+	*(u16 *)&priv->regs[reg] = val;
+}
+
+static void sdhci_fake_write_b(struct sdhci_host *host, u8 val, int reg)
+{
+	/* resets complete at once */
+	if (reg == SDHCI_SOFTWARE_RESET)
+		val = 0;
+	sdhci_fake_priv(host)->regs[reg] = val;
+}
+
+static const struct sdhci_ops sdhci_fake_ops = {
+	.read_l		= sdhci_fake_read_l,
+	.read_w		= sdhci_fake_read_w,
+	.read_b		= sdhci_fake_read_b,
+	.write_l	= sdhci_fake_write_l,
+	.write_w	= sdhci_fake_write_w,
+	.write_b	= sdhci_fake_write_b,
+};
+
+/* Set up the host as a driver would, with the given quirks */
+static int sdhci_fake_setup(struct udevice *dev, uint quirks)
+{
+	struct sdhci_fake_plat *plat = dev_get_plat(dev);
+	struct sdhci_fake_priv *priv = dev_get_priv(dev);
+	struct sdhci_host *host = &priv->host;
+
+	host->quirks = quirks;
+	host->flags = 0;
+	plat->cfg.host_caps = 0;
+
+	return sdhci_setup_cfg(&plat->cfg, host, 0, 0);
+}
+
+static int sdhci_fake_probe(struct udevice *dev)
+{
+	struct mmc_uclass_priv *upriv = dev_get_uclass_priv(dev);
+	struct sdhci_fake_plat *plat = dev_get_plat(dev);
+	struct sdhci_fake_priv *priv = dev_get_priv(dev);
+	struct sdhci_host *host = &priv->host;
+
+	/* SDHCI 3.00 with a 50MHz base clock */
+	*(u16 *)&priv->regs[SDHCI_HOST_VERSION] = SDHCI_SPEC_300;
+	*(u32 *)&priv->regs[SDHCI_CAPABILITIES] = SDHCI_CAN_VDD_330 |
+		50 << SDHCI_CLOCK_BASE_SHIFT;
+
+	host->name = dev->name;
+	host->ops = &sdhci_fake_ops;
+	host->mmc = &plat->mmc;
+	host->mmc->dev = dev;
+	host->mmc->priv = host;
+	upriv->mmc = host->mmc;
+
+	return sdhci_fake_setup(dev, 0);
+}
+
+static int sdhci_fake_bind(struct udevice *dev)
+{
+	struct sdhci_fake_plat *plat = dev_get_plat(dev);
+
+	return sdhci_bind(dev, &plat->mmc, &plat->cfg);
+}
+
+U_BOOT_DRIVER(sdhci_fake) = {
+	.name		= "sdhci_fake",
+	.id		= UCLASS_MMC,
+	.bind		= sdhci_fake_bind,
+	.probe		= sdhci_fake_probe,
+	.ops		= &sdhci_ops,
+	.priv_auto	= sizeof(struct sdhci_fake_priv),
+	.plat_auto	= sizeof(struct sdhci_fake_plat),
+};
+
+/* Read @blocks blocks with a pre-defined block count sent by the host */
+static int sdhci_fake_read(struct udevice *dev, u32 *buf, uint blocks)
+{
+	struct mmc_cmd cmd;
+	struct mmc_data data;
+
+	cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
+	cmd.cmdarg = 0;
+	cmd.resp_type = MMC_RSP_R1;
+	data.dest = (char *)buf;
+	data.blocks = blocks;
+	data.blocksize = 512;
+	data.flags = MMC_DATA_READ;
+
+	return mmc_send_cmd_sbc(mmc_get_mmc_dev(dev), &cmd, &data);
+}
+
+/* Test the CMD23 support announced for each of the quirks */
+static int dm_test_sdhci_cmd23_caps(struct unit_test_state *uts)
+{
+	struct sdhci_fake_plat *plat;
+	struct sdhci_fake_priv *priv;
+	struct udevice *dev;
+
+	ut_assertok(device_bind(dm_root(), DM_DRIVER_GET(sdhci_fake),
+				"sdhci-fake", NULL, ofnode_null(), &dev));
+	ut_assertok(device_probe(dev));
+	plat = dev_get_plat(dev);
+	priv = dev_get_priv(dev);
+
+	ut_assert(plat->cfg.host_caps & MMC_CAP_CMD23);
+	ut_assert(priv->host.flags & USE_AUTO_CMD23);
+
+	ut_assertok(sdhci_fake_setup(dev, SDHCI_QUIRK_BROKEN_AUTO_CMD23));
+	ut_assert(plat->cfg.host_caps & MMC_CAP_CMD23);
+	ut_assert(!(priv->host.flags & USE_AUTO_CMD23));
+
+	ut_assertok(sdhci_fake_setup(dev, SDHCI_QUIRK_NO_CMD23));
+	ut_assert(!(plat->cfg.host_caps & MMC_CAP_CMD23));
+	ut_assert(!(priv->host.flags & USE_AUTO_CMD23));
+
+	/* hosts before SDHCI 3.00 have no auto-CMD23 */
+	*(u16 *)&priv->regs[SDHCI_HOST_VERSION] = SDHCI_SPEC_200;
+	ut_assertok(sdhci_fake_setup(dev, 0));
+	ut_assert(plat->cfg.host_caps & MMC_CAP_CMD23);
+	ut_assert(!(priv->host.flags & USE_AUTO_CMD23));
+
+	return 0;
+}
+DM_TEST(dm_test_sdhci_cmd23_caps, 0);
+
+/* Test that auto-CMD23 takes its block count from SDHCI_ARGUMENT2 */
+static int dm_test_sdhci_auto_cmd23(struct unit_test_state *uts)
+{
+	struct sdhci_fake_priv *priv;
+	struct udevice *dev;
+	u32 buf[4 * 512 / 4];
+	int i;
+
+	ut_assertok(device_bind(dm_root(), DM_DRIVER_GET(sdhci_fake),
+				"sdhci-fake", NULL, ofnode_null(), &dev));
+	ut_assertok(device_probe(dev));
+	priv = dev_get_priv(dev);
+
+	/* a single command, with the block count set for the host to send */
+	ut_assertok(sdhci_fake_read(dev, buf, 4));
+	ut_asserteq(1, priv->count);
+	ut_asserteq(MMC_CMD_READ_MULTIPLE_BLOCK, priv->cmds[0]);
+	ut_asserteq(4, priv->arg2);
+	ut_asserteq(SDHCI_TRNS_AUTO_CMD23 | SDHCI_TRNS_MULTI |
+		    SDHCI_TRNS_BLK_CNT_EN | SDHCI_TRNS_READ, priv->mode);
+	for (i = 0; i < ARRAY_SIZE(buf); i++)
+		ut_asserteq(i, buf[i]);
+
+	/* with auto-CMD23 broken the core has to send CMD23 itself */
+	ut_assertok(sdhci_fake_setup(dev, SDHCI_QUIRK_BROKEN_AUTO_CMD23));
+	ut_asserteq(-ENOSYS, sdhci_fake_read(dev, buf, 4));
+	ut_asserteq(1, priv->count);
+
+	return 0;
+}
+DM_TEST(dm_test_sdhci_auto_cmd23, 0);
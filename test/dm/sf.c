@@ -74,6 +74,53 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_spi_flash, UTF_SCAN_PDATA | UTF_SCAN_FDT);
 
+/* Test reads through a direct mapping which covers only part of the flash */
+static int dm_test_spi_flash_dirmap(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	int full_size = 0x200000;
+	uint reads, fallbacks;
+	u8 *src, *dst;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(SPI_DIRMAP))
+		return -EAGAIN;
+
+	src = map_sysmem(0x20000, full_size);
+	for (i = 0; i < full_size; i++)
+		src[i] = i * 7 + (i >> 12);
+	ut_assertok(os_write_file("spi.bin", src, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	dst = map_sysmem(0x20000 + full_size, full_size);
+
+	/* the sandbox bus maps the first 1MiB; a read stops at its end */
+	ut_assertok(spi_flash_read_dm(dev, 0xfff00, 0x200, dst));
+	ut_asserteq_mem(src + 0xfff00, dst, 0x200);
+	sandbox_spi_get_dirmap_stats(dev_get_parent(dev), &reads, &fallbacks);
+	ut_asserteq(1, reads);
+	ut_asserteq(1, fallbacks);
+
+	/* beyond the window the flash is read as usual */
+	ut_assertok(spi_flash_read_dm(dev, 0x180000, 0x1000, dst));
+	ut_asserteq_mem(src + 0x180000, dst, 0x1000);
+	sandbox_spi_get_dirmap_stats(dev_get_parent(dev), &reads, &fallbacks);
+	ut_asserteq(1, reads);
+	ut_asserteq(2, fallbacks);
+
+	/* the whole flash */
+	ut_assertok(spi_flash_read_dm(dev, 0, full_size, dst));
+	ut_asserteq_mem(src, dst, full_size);
+
+	/*
+	 * Since we are about to destroy all devices, we must tell sandbox
+	 * to forget the emulation device
+	 */
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_dirmap, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
 /* Functional test that sandbox SPI flash works correctly */
 static int dm_test_spi_flash_func(struct unit_test_state *uts)
 {
@@ -134,6 +134,7 @@ static int dm_test_virtio_ring(struct unit_test_state *uts)
 	struct virtio_sg *sgs[2];
 	unsigned int len;
 	u8 buffer[2][32];
+	ulong mem;
 
 	/* check probe success */
 	ut_assertok(uclass_first_device_err(UCLASS_VIRTIO, &bus));
@@ -192,6 +193,32 @@ static int dm_test_virtio_ring(struct unit_test_state *uts)
 	ut_asserteq(6, len);
 	ut_assertok(virtio_del_vqs(dev));
 
+	/* a chain takes a single slot when indirect descriptors are used */
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	vq->indirect = true;
+	ut_assertok(virtqueue_add(vq, sgs, 1, 1));
+	ut_asserteq(virtqueue_get_vring_size(vq) - 1, vq->num_free);
+	ut_asserteq(VRING_DESC_F_INDIRECT,
+		    virtio16_to_cpu(dev, vq->vring.desc[0].flags));
+	ut_asserteq(2 * sizeof(struct vring_desc),
+		    virtio32_to_cpu(dev, vq->vring.desc[0].len));
+	vq->vring.used->idx = 1;
+	vq->vring.used->ring[0].id = 0;
+	vq->vring.used->ring[0].len = 32;
+	ut_asserteq_ptr(buffer, virtqueue_get_buf(vq, &len));
+	ut_asserteq(virtqueue_get_vring_size(vq), vq->num_free);
+	ut_assertok(virtio_del_vqs(dev));
+
+	/* a full ring refuses a chain without leaking an indirect table */
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	vq->indirect = true;
+	vq->num_free = 0;
+	mem = ut_check_delta(0);
+	ut_asserteq(-ENOSPC, virtqueue_add(vq, sgs, 1, 1));
+	ut_asserteq(0, ut_check_delta(mem));
+	vq->num_free = virtqueue_get_vring_size(vq);
+	ut_assertok(virtio_del_vqs(dev));
+
 	return 0;
 }
 DM_TEST(dm_test_virtio_ring, UTF_SCAN_PDATA | UTF_SCAN_FDT);